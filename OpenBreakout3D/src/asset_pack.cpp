@@ -0,0 +1,243 @@
+#include "asset_pack.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OB3D
+{
+	static std::string_view EntryName(const PackEntry& entry)
+	{
+		return std::string_view(entry.name, strnlen(entry.name, PACK_NAME_SIZE));
+	}
+
+	bool AssetPack::Open(const char* path)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER file_size = {};
+		GetFileSizeEx(file, &file_size);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!view)
+		{
+			fmt::println("Failed to map asset pack {:s}", path);
+			if (mapping)
+			{
+				CloseHandle(mapping);
+			}
+			CloseHandle(file);
+			return false;
+		}
+
+		file_handle = file;
+		mapping_handle = mapping;
+		base = static_cast<const uint8_t*>(view);
+		size = size_t(file_size.QuadPart);
+#else
+		int fd = open(path, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat file_stat = {};
+		fstat(fd, &file_stat);
+
+		void* view = file_stat.st_size > 0 ? mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		if (view == MAP_FAILED)
+		{
+			fmt::println("Failed to map asset pack {:s}", path);
+			close(fd);
+			return false;
+		}
+
+		// Start reading the whole pack ahead, startup only waits on the disk from here on
+		posix_madvise(view, size_t(file_stat.st_size), POSIX_MADV_WILLNEED);
+
+		file_descriptor = fd;
+		base = static_cast<const uint8_t*>(view);
+		size = size_t(file_stat.st_size);
+#endif
+
+		// Only the header and table of contents are validated, blobs are checked on demand
+		const PackHeader* header = reinterpret_cast<const PackHeader*>(base);
+		bool is_valid = size >= sizeof(PackHeader)
+						&& header->magic == PACK_MAGIC
+						&& header->version == PACK_VERSION
+						&& header->file_size == size
+						&& header->toc_offset % alignof(PackEntry) == 0
+						&& header->toc_offset <= size
+						&& uint64_t(header->entry_count) * sizeof(PackEntry) <= size - header->toc_offset;
+
+		if (is_valid)
+		{
+			entries = std::span<const PackEntry>(reinterpret_cast<const PackEntry*>(base + header->toc_offset), header->entry_count);
+			is_valid = PackChecksum(reinterpret_cast<const uint8_t*>(entries.data()), entries.size_bytes()) == header->toc_checksum;
+		}
+
+		for (size_t i = 0; is_valid && i < entries.size(); i++)
+		{
+			// Offset and size come from the file, their sum could wrap around
+			is_valid = entries[i].offset % PACK_BLOB_ALIGNMENT == 0 && entries[i].offset <= size && entries[i].size <= size - entries[i].offset;
+		}
+
+		if (!is_valid)
+		{
+			fmt::println("Asset pack {:s} is corrupt or from another version", path);
+			Close();
+			return false;
+		}
+
+		OB3D_LOG("Mapped asset pack {:s}: {} entries, {} KiB", path, entries.size(), size / 1024);
+		return true;
+	}
+
+	void AssetPack::Close()
+	{
+#ifdef _WIN32
+		if (base)
+		{
+			UnmapViewOfFile(base);
+		}
+		if (mapping_handle)
+		{
+			CloseHandle(mapping_handle);
+		}
+		if (file_handle)
+		{
+			CloseHandle(file_handle);
+		}
+		mapping_handle = nullptr;
+		file_handle = nullptr;
+#else
+		if (base)
+		{
+			munmap(const_cast<uint8_t*>(base), size);
+		}
+		if (file_descriptor >= 0)
+		{
+			close(file_descriptor);
+		}
+		file_descriptor = -1;
+#endif
+		base = nullptr;
+		size = 0;
+		entries = {};
+	}
+
+	const PackEntry* AssetPack::Find(std::string_view name, PackEntryType type) const
+	{
+		auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const PackEntry& entry, std::string_view value)
+			{
+				return EntryName(entry) < value;
+			});
+
+		// Names are unique per type, different types may share one
+		for (; it != entries.end() && EntryName(*it) == name; ++it)
+		{
+			if (it->type == type)
+			{
+				return &*it;
+			}
+		}
+		return nullptr;
+	}
+
+	std::span<const uint8_t> AssetPack::GetBlob(const PackEntry& entry) const
+	{
+		return std::span<const uint8_t>(base + entry.offset, size_t(entry.size));
+	}
+
+	bool AssetPack::VerifyChecksum(const PackEntry& entry) const
+	{
+		std::span<const uint8_t> blob = GetBlob(entry);
+		return PackChecksum(blob.data(), blob.size()) == entry.checksum;
+	}
+
+	bool AssetPack::VerifyAll() const
+	{
+		bool is_valid = true;
+		for (const PackEntry& entry : entries)
+		{
+			if (!VerifyChecksum(entry))
+			{
+				fmt::println("Asset pack entry {:s} failed its checksum", EntryName(entry));
+				is_valid = false;
+			}
+		}
+		return is_valid;
+	}
+
+	bool AssetPack::GetLevel(std::string_view name, PackLevel& out_level) const
+	{
+		const PackEntry* entry = Find(name, PackEntryType::PACK_LEVEL);
+		if (!entry || entry->size < sizeof(PackLevelHeader))
+		{
+			return false;
+		}
+
+		std::span<const uint8_t> blob = GetBlob(*entry);
+		out_level.header = reinterpret_cast<const PackLevelHeader*>(blob.data());
+
+		uint64_t brick_count = uint64_t(out_level.header->columns) * out_level.header->rows;
+		if (sizeof(PackLevelHeader) + brick_count > blob.size())
+		{
+			return false;
+		}
+
+		out_level.hit_points = blob.subspan(sizeof(PackLevelHeader), size_t(brick_count));
+		return true;
+	}
+
+	bool AssetPack::GetMesh(std::string_view name, PackMesh& out_mesh) const
+	{
+		const PackEntry* entry = Find(name, PackEntryType::PACK_MESH);
+		if (!entry || entry->size < sizeof(PackMeshHeader))
+		{
+			return false;
+		}
+
+		std::span<const uint8_t> blob = GetBlob(*entry);
+		out_mesh.header = reinterpret_cast<const PackMeshHeader*>(blob.data());
+
+		uint64_t vertex_bytes = uint64_t(out_mesh.header->vertex_count) * out_mesh.header->vertex_stride;
+		uint64_t index_bytes = uint64_t(out_mesh.header->index_count) * sizeof(uint32_t);
+		if (sizeof(PackMeshHeader) + vertex_bytes > out_mesh.header->index_offset
+			|| out_mesh.header->index_offset + index_bytes > blob.size())
+		{
+			return false;
+		}
+
+		out_mesh.vertex_data = blob.subspan(sizeof(PackMeshHeader), size_t(vertex_bytes));
+		out_mesh.index_data = blob.subspan(out_mesh.header->index_offset, size_t(index_bytes));
+		return true;
+	}
+
+	std::span<const uint32_t> AssetPack::GetShader(std::string_view name) const
+	{
+		const PackEntry* entry = Find(name, PackEntryType::PACK_SHADER);
+		if (!entry)
+		{
+			return {};
+		}
+
+		// Blob alignment makes the mapped bytes valid SPIR-V words as is
+		std::span<const uint8_t> blob = GetBlob(*entry);
+		return std::span<const uint32_t>(reinterpret_cast<const uint32_t*>(blob.data()), blob.size() / sizeof(uint32_t));
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "util.h"
+#include "asset_pack_format.h"
+
+namespace OB3D
+{
+	// Views straight into the mapped file, valid until the pack is closed
+	struct PackLevel
+	{
+		const PackLevelHeader* header;
+		std::span<const uint8_t> hit_points;
+	};
+
+	struct PackMesh
+	{
+		const PackMeshHeader* header;
+		// Vertices followed by the indices, laid out exactly as the GPU buffers expect them
+		std::span<const uint8_t> vertex_data;
+		std::span<const uint8_t> index_data;
+	};
+
+	// Read only memory mapping of an asset pack, nothing is parsed or copied on open
+	// the OS pages blobs in when they are first touched
+	struct AssetPack
+	{
+		bool Open(const char* path);
+		void Close();
+		bool IsOpen() const { return base != nullptr; }
+
+		// Binary search over the table of contents, nullptr when missing
+		const PackEntry* Find(std::string_view name, PackEntryType type) const;
+		std::span<const uint8_t> GetBlob(const PackEntry& entry) const;
+		// Touches every page of the blob
+		bool VerifyChecksum(const PackEntry& entry) const;
+		bool VerifyAll() const;
+
+		bool GetLevel(std::string_view name, PackLevel& out_level) const;
+		bool GetMesh(std::string_view name, PackMesh& out_mesh) const;
+		std::span<const uint32_t> GetShader(std::string_view name) const;
+
+		std::span<const PackEntry> entries;
+		const uint8_t* base = nullptr;
+		size_t size = 0;
+
+	private:
+#ifdef _WIN32
+		void* file_handle = nullptr;
+		void* mapping_handle = nullptr;
+#else
+		int file_descriptor = -1;
+#endif
+	};
+}
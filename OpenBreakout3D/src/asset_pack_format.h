@@ -0,0 +1,89 @@
+#pragma once
+// Shared with Tools/AssetPacker, keep this header free of engine and Vulkan includes
+#include <cstdint>
+#include <cstddef>
+
+namespace OB3D
+{
+	constexpr uint32_t PACK_MAGIC = 0x5033424F; // "OB3P"
+	constexpr uint32_t PACK_VERSION = 1;
+	// Every blob starts on this boundary so mapped data can be handed out as typed arrays
+	constexpr uint64_t PACK_BLOB_ALIGNMENT = 64;
+	constexpr size_t PACK_NAME_SIZE = 48;
+
+	// File layout, little endian:
+	//  PackHeader
+	//  PackEntry[entry_count] at toc_offset, sorted by name
+	//  blobs, each aligned to PACK_BLOB_ALIGNMENT
+	struct PackHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entry_count;
+		// Checksum of the table of contents
+		uint32_t toc_checksum;
+		uint64_t toc_offset;
+		uint64_t file_size;
+	};
+	static_assert(sizeof(PackHeader) == 32);
+
+	enum class PackEntryType : uint32_t
+	{
+		// PackLevelHeader followed by columns * rows hit points, row 0 at the top
+		PACK_LEVEL,
+		// PackMeshHeader followed by the vertices and then the uint32_t indices
+		PACK_MESH,
+		// SPIR-V words
+		PACK_SHADER
+	};
+
+	struct PackEntry
+	{
+		// Null terminated
+		char name[PACK_NAME_SIZE];
+		PackEntryType type;
+		// Checksum of the blob
+		uint32_t checksum;
+		uint64_t offset;
+		uint64_t size;
+	};
+	static_assert(sizeof(PackEntry) == 72);
+
+	struct PackLevelHeader
+	{
+		uint32_t columns;
+		uint32_t rows;
+	};
+
+	struct PackVertex
+	{
+		float position[3];
+		float normal[3];
+	};
+
+	struct PackMeshHeader
+	{
+		uint32_t vertex_count;
+		uint32_t index_count;
+		uint32_t vertex_stride;
+		// Byte offset of the indices from the start of the blob
+		uint32_t index_offset;
+	};
+	static_assert(sizeof(PackMeshHeader) % 4 == 0);
+
+	// FNV-1a, cheap enough to run over a whole pack at load time
+	constexpr uint32_t PackChecksum(const uint8_t* data, size_t size, uint32_t hash = 2166136261u)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	constexpr uint64_t PackAlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
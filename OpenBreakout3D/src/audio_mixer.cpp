@@ -0,0 +1,205 @@
+#include "audio_mixer.h"
+
+// The SIMD kernels are compiled for x86-64 only, every other target mixes with the scalar path
+#if defined(__x86_64__) || defined(_M_X64)
+#define OB3D_MIXER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles AVX2 intrinsics anywhere, GCC and Clang only in functions built for it.
+// The rest of the executable keeps the baseline instruction set and the path is picked at runtime
+#if defined(OB3D_MIXER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define OB3D_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define OB3D_TARGET_AVX2
+#endif
+
+namespace OB3D
+{
+	static void MixVoiceScalar(const float* src, uint32_t frame_count, float gain_left, float gain_right, float* left, float* right)
+	{
+		for (uint32_t i = 0; i < frame_count; i++)
+		{
+			left[i] += src[i] * gain_left;
+			right[i] += src[i] * gain_right;
+		}
+	}
+
+	static void InterleaveScalar(const float* left, const float* right, uint32_t frame_count, float gain, int16_t* out)
+	{
+		for (uint32_t i = 0; i < frame_count; i++)
+		{
+			out[i * 2] = int16_t(std::lrint(std::clamp(left[i] * gain, -1.0f, 1.0f) * 32767.0f));
+			out[i * 2 + 1] = int16_t(std::lrint(std::clamp(right[i] * gain, -1.0f, 1.0f) * 32767.0f));
+		}
+	}
+
+#ifdef OB3D_MIXER_X86
+	static bool CpuHasAvx2()
+	{
+#ifdef _MSC_VER
+		std::array<int, 4> info = {};
+		__cpuid(info.data(), 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// FMA, OSXSAVE and AVX, then whether the OS saves the YMM registers
+		__cpuid(info.data(), 1);
+		constexpr int required_ecx = (1 << 12) | (1 << 27) | (1 << 28);
+		if ((info[2] & required_ecx) != required_ecx || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+
+		__cpuidex(info.data(), 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+	}
+
+	static void MixVoiceSse(const float* src, uint32_t frame_count, float gain_left, float gain_right, float* left, float* right)
+	{
+		__m128 gains_left = _mm_set1_ps(gain_left);
+		__m128 gains_right = _mm_set1_ps(gain_right);
+
+		uint32_t i = 0;
+		for (; i + 4 <= frame_count; i += 4)
+		{
+			// Voices play from anywhere in their sound, only the accumulators are aligned
+			__m128 samples = _mm_loadu_ps(src + i);
+			_mm_store_ps(left + i, _mm_add_ps(_mm_load_ps(left + i), _mm_mul_ps(samples, gains_left)));
+			_mm_store_ps(right + i, _mm_add_ps(_mm_load_ps(right + i), _mm_mul_ps(samples, gains_right)));
+		}
+		MixVoiceScalar(src + i, frame_count - i, gain_left, gain_right, left + i, right + i);
+	}
+
+	static void InterleaveSse(const float* left, const float* right, uint32_t frame_count, float gain, int16_t* out)
+	{
+		__m128 scale = _mm_set1_ps(gain);
+		__m128 full_scale = _mm_set1_ps(32767.0f);
+		__m128 max_value = _mm_set1_ps(1.0f);
+		__m128 min_value = _mm_set1_ps(-1.0f);
+
+		uint32_t i = 0;
+		for (; i + 4 <= frame_count; i += 4)
+		{
+			__m128 l = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_load_ps(left + i), scale), min_value), max_value);
+			__m128 r = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_load_ps(right + i), scale), min_value), max_value);
+
+			// L0 R0 L1 R1 and L2 R2 L3 R3, packed into 8 interleaved samples
+			__m128i low = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpacklo_ps(l, r), full_scale));
+			__m128i high = _mm_cvtps_epi32(_mm_mul_ps(_mm_unpackhi_ps(l, r), full_scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2), _mm_packs_epi32(low, high));
+		}
+		InterleaveScalar(left + i, right + i, frame_count - i, gain, out + i * 2);
+	}
+
+	OB3D_TARGET_AVX2 static void MixVoiceAvx2(const float* src, uint32_t frame_count, float gain_left, float gain_right, float* left, float* right)
+	{
+		__m256 gains_left = _mm256_set1_ps(gain_left);
+		__m256 gains_right = _mm256_set1_ps(gain_right);
+
+		uint32_t i = 0;
+		for (; i + 8 <= frame_count; i += 8)
+		{
+			__m256 samples = _mm256_loadu_ps(src + i);
+			_mm256_store_ps(left + i, _mm256_fmadd_ps(samples, gains_left, _mm256_load_ps(left + i)));
+			_mm256_store_ps(right + i, _mm256_fmadd_ps(samples, gains_right, _mm256_load_ps(right + i)));
+		}
+		MixVoiceScalar(src + i, frame_count - i, gain_left, gain_right, left + i, right + i);
+	}
+
+	OB3D_TARGET_AVX2 static void InterleaveAvx2(const float* left, const float* right, uint32_t frame_count, float gain, int16_t* out)
+	{
+		__m256 scale = _mm256_set1_ps(gain);
+		__m256 full_scale = _mm256_set1_ps(32767.0f);
+		__m256 max_value = _mm256_set1_ps(1.0f);
+		__m256 min_value = _mm256_set1_ps(-1.0f);
+
+		uint32_t i = 0;
+		for (; i + 8 <= frame_count; i += 8)
+		{
+			__m256 l = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_load_ps(left + i), scale), min_value), max_value);
+			__m256 r = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_load_ps(right + i), scale), min_value), max_value);
+
+			// Unpacking and packing both stay within 128 bit lanes, which cancels out:
+			// lane 0 ends up with frames 0 to 3 and lane 1 with frames 4 to 7
+			__m256i low = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_unpacklo_ps(l, r), full_scale));
+			__m256i high = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_unpackhi_ps(l, r), full_scale));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i * 2), _mm256_packs_epi32(low, high));
+		}
+		InterleaveScalar(left + i, right + i, frame_count - i, gain, out + i * 2);
+	}
+#endif
+
+	namespace Mixer
+	{
+		MixPath BestPath()
+		{
+#ifdef OB3D_MIXER_X86
+			return CpuHasAvx2() ? MixPath::MIX_AVX2 : MixPath::MIX_SSE;
+#else
+			return MixPath::MIX_SCALAR;
+#endif
+		}
+
+		void MixVoice(MixPath path, const float* src, uint32_t frame_count, float gain_left, float gain_right, float* left, float* right)
+		{
+			switch (path)
+			{
+#ifdef OB3D_MIXER_X86
+				case MixPath::MIX_AVX2:
+				{
+					MixVoiceAvx2(src, frame_count, gain_left, gain_right, left, right);
+					break;
+				}
+
+				case MixPath::MIX_SSE:
+				{
+					MixVoiceSse(src, frame_count, gain_left, gain_right, left, right);
+					break;
+				}
+#endif
+
+				default:
+				{
+					MixVoiceScalar(src, frame_count, gain_left, gain_right, left, right);
+					break;
+				}
+			}
+		}
+
+		void Interleave(MixPath path, const float* left, const float* right, uint32_t frame_count, float gain, int16_t* out)
+		{
+			switch (path)
+			{
+#ifdef OB3D_MIXER_X86
+				case MixPath::MIX_AVX2:
+				{
+					InterleaveAvx2(left, right, frame_count, gain, out);
+					break;
+				}
+
+				case MixPath::MIX_SSE:
+				{
+					InterleaveSse(left, right, frame_count, gain, out);
+					break;
+				}
+#endif
+
+				default:
+				{
+					InterleaveScalar(left, right, frame_count, gain, out);
+					break;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// Instruction sets the mixer kernels come in, picked once at startup from what the CPU supports
+	enum class MixPath : uint32_t
+	{
+		MIX_SCALAR,
+		// 4 frames at a time, SSE2 is part of every x86-64 CPU
+		MIX_SSE,
+		// 8 frames at a time with fused multiply adds
+		MIX_AVX2
+	};
+
+	constexpr std::array<std::string_view, 3> MIX_PATH_NAMES = { "scalar", "SSE", "AVX2" };
+
+	namespace Mixer
+	{
+		// Widest path this CPU runs, always MIX_SCALAR off x86-64
+		MixPath BestPath();
+
+		// Adds frame_count mono samples into the left and right accumulators, scaled by the voice's gains
+		// The accumulators are 32 byte aligned and start at the block's first frame
+		void MixVoice(MixPath path, const float* src, uint32_t frame_count, float gain_left, float gain_right, float* left, float* right);
+		// Scales the accumulators by gain, clamps them to full scale and interleaves them into 16 bit stereo
+		void Interleave(MixPath path, const float* left, const float* right, uint32_t frame_count, float gain, int16_t* out);
+	}
+}
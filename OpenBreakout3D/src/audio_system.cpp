@@ -0,0 +1,545 @@
+#include "audio_system.h"
+#include <cstdio>
+#include <limits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace OB3D
+{
+	// Sounds are a tone gliding from start_hz to end_hz under an exponential decay, mixed with some noise
+	struct SoundRecipe
+	{
+		float start_hz;
+		float end_hz;
+		float duration_sec;
+		float decay_per_sec;
+		// 0 is a pure tone, 1 pure noise
+		float noise;
+	};
+
+	// Indexed by SoundId
+	constexpr std::array<SoundRecipe, size_t(SoundId::SOUND_COUNT)> SOUND_RECIPES = { {
+		// Brick destroyed, a crunch
+		{ 660.0f, 520.0f, 0.18f, 22.0f, 0.35f },
+		// Brick hit, a short ping
+		{ 880.0f, 880.0f, 0.07f, 45.0f, 0.05f },
+		// Paddle hit
+		{ 330.0f, 300.0f, 0.09f, 35.0f, 0.0f },
+		// Wall hit, a dull knock
+		{ 220.0f, 220.0f, 0.05f, 60.0f, 0.1f },
+		// Ball lost, a falling tone
+		{ 440.0f, 110.0f, 0.6f, 4.0f, 0.0f }
+	} };
+	// Ramps at both ends of every sound, starting or ending on a non zero sample clicks
+	constexpr float SOUND_ATTACK_SEC = 0.002f;
+	constexpr float SOUND_RELEASE_SEC = 0.005f;
+
+	// Headroom for many voices at once, the mix is clamped to full scale after this
+	constexpr float AUDIO_MASTER_GAIN = 0.5f;
+
+	constexpr size_t WAV_HEADER_SIZE = 44;
+	// Large enough that the mixer thread only hands data to the OS every few seconds of audio
+	constexpr size_t WAV_WRITE_BUFFER_SIZE = 1 << 20;
+
+	// Benchmark load, enough blocks for the pool to be full and stay full
+	constexpr uint32_t AUDIO_BENCH_WARMUP_BLOCKS = 64;
+	constexpr uint32_t AUDIO_BENCH_BLOCKS = 4096;
+
+	void SoundBank::Build()
+	{
+		samples.clear();
+
+		// Fixed seed, the sounds are the same on every run
+		SimRng rng = {};
+		rng.Seed(1);
+
+		for (size_t sound_idx = 0; sound_idx < SOUND_RECIPES.size(); sound_idx++)
+		{
+			const SoundRecipe& recipe = SOUND_RECIPES[sound_idx];
+			uint32_t length = uint32_t(recipe.duration_sec * AUDIO_SAMPLE_RATE);
+			offsets[sound_idx] = uint32_t(samples.size());
+			lengths[sound_idx] = length;
+
+			float phase = 0.0f;
+			for (uint32_t i = 0; i < length; i++)
+			{
+				float t = float(i) / AUDIO_SAMPLE_RATE;
+				float hz = recipe.start_hz + (recipe.end_hz - recipe.start_hz) * (float(i) / float(length));
+				phase = std::fmod(phase + 6.2831853f * hz / AUDIO_SAMPLE_RATE, 6.2831853f);
+
+				float envelope = std::exp(-recipe.decay_per_sec * t);
+				envelope *= std::min(t / SOUND_ATTACK_SEC, 1.0f);
+				envelope *= std::min((recipe.duration_sec - t) / SOUND_RELEASE_SEC, 1.0f);
+
+				float tone = std::sin(phase) * (1.0f - recipe.noise) + rng.NextRange(-1.0f, 1.0f) * recipe.noise;
+				samples.push_back(tone * envelope);
+			}
+		}
+	}
+
+	static void WriteWavHeader(FILE* file, uint32_t frame_count)
+	{
+		std::array<uint8_t, WAV_HEADER_SIZE> header = {};
+		size_t pos = 0;
+		auto put_tag = [&](const char* tag)
+		{
+			std::memcpy(header.data() + pos, tag, 4);
+			pos += 4;
+		};
+		// WAV is little endian
+		auto put_uint = [&](uint32_t value, uint32_t byte_count)
+		{
+			for (uint32_t i = 0; i < byte_count; i++)
+			{
+				header[pos++] = uint8_t(value >> (i * 8));
+			}
+		};
+
+		uint32_t data_size = frame_count * 2 * sizeof(int16_t);
+		put_tag("RIFF");
+		put_uint(uint32_t(WAV_HEADER_SIZE) - 8 + data_size, 4);
+		put_tag("WAVE");
+		put_tag("fmt ");
+		put_uint(16, 4);
+		// PCM, 2 channels
+		put_uint(1, 2);
+		put_uint(2, 2);
+		put_uint(AUDIO_SAMPLE_RATE, 4);
+		put_uint(AUDIO_SAMPLE_RATE * 2 * sizeof(int16_t), 4);
+		put_uint(2 * sizeof(int16_t), 2);
+		put_uint(16, 2);
+		put_tag("data");
+		put_uint(data_size, 4);
+
+		std::fwrite(header.data(), 1, header.size(), file);
+	}
+
+	bool AudioSink::Open(AudioBackend sink_backend, const std::string& wav_path)
+	{
+		backend = sink_backend;
+		written_frames = 0;
+		audible_frames = 0;
+		if (backend != AudioBackend::AUDIO_WAV)
+		{
+			return true;
+		}
+
+		wav_file = std::fopen(wav_path.c_str(), "wb");
+		if (wav_file == nullptr)
+		{
+			fmt::println("Failed to write audio to {:s}", wav_path);
+			return false;
+		}
+
+		std::setvbuf(wav_file, nullptr, _IOFBF, WAV_WRITE_BUFFER_SIZE);
+		// Sizes are filled in on Close
+		WriteWavHeader(wav_file, 0);
+		return true;
+	}
+
+	void AudioSink::Write(std::span<const int16_t> samples)
+	{
+		if (wav_file != nullptr)
+		{
+			// Samples are already in the file's little endian order on every platform the engine runs on
+			std::fwrite(samples.data(), sizeof(int16_t), samples.size(), wav_file);
+		}
+		written_frames += uint32_t(samples.size() / 2);
+
+		for (size_t i = 0; i < samples.size(); i += 2)
+		{
+			audible_frames += samples[i] != 0 || samples[i + 1] != 0 ? 1 : 0;
+		}
+	}
+
+	void AudioSink::Close()
+	{
+		if (wav_file != nullptr)
+		{
+			std::fseek(wav_file, 0, SEEK_SET);
+			WriteWavHeader(wav_file, written_frames);
+			std::fclose(wav_file);
+			wav_file = nullptr;
+		}
+		backend = AudioBackend::AUDIO_OFF;
+	}
+
+	// Needs privileges on Linux, without them the mixer keeps the default priority and just has less slack
+	static bool RaiseThreadPriority()
+	{
+#ifdef _WIN32
+		return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) != 0;
+#else
+		sched_param param = {};
+		param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+		return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+#endif
+	}
+
+	void AudioSystem::Init(uint32_t voice_count, MixPath path)
+	{
+		bank.Build();
+		voices = {};
+		voice_limit = std::clamp(voice_count, 1u, MAX_AUDIO_VOICES);
+		mix_path = path;
+	}
+
+	void AudioSystem::Start(const EngineConfig& config)
+	{
+		if (config.audio_backend == AudioBackend::AUDIO_OFF)
+		{
+			return;
+		}
+
+		Init(config.audio_voices, Mixer::BestPath());
+		if (!sink.Open(config.audio_backend, config.audio_wav_path))
+		{
+			return;
+		}
+
+		is_active = true;
+		is_running = true;
+		is_writing = sink.wav_file != nullptr;
+		if (is_writing)
+		{
+			writer = std::thread(&AudioSystem::WriteLoop, this);
+		}
+		mixer = std::thread(&AudioSystem::MixLoop, this);
+		OB3D_LOG("Audio mixer: {:s}, {} voices, {} frame blocks", MIX_PATH_NAMES[uint32_t(mix_path)], voice_limit, AUDIO_BLOCK_FRAMES);
+	}
+
+	void AudioSystem::Stop()
+	{
+		if (!is_active)
+		{
+			return;
+		}
+
+		is_running = false;
+		mixer.join();
+		if (writer.joinable())
+		{
+			is_writing.store(false, std::memory_order_release);
+			writer.join();
+		}
+		sink.Close();
+		is_active = false;
+
+		double budget_us = std::chrono::duration<double, std::micro>(AudioBlocks(1)).count();
+		OB3D_LOG("Audio: {} blocks, mix avg {:.1f} us, max {:.1f} us of {:.0f} us, {} missed deadlines",
+			block_count, block_count == 0 ? 0.0 : mix_sum_us / double(block_count), mix_max_us, budget_us, missed_deadlines);
+		OB3D_LOG("Audio: peak {} voices, {} stolen, {} starts skipped, {} commands dropped, {} blocks dropped",
+			peak_voices, stolen_voices, skipped_starts, dropped_commands, dropped_blocks);
+	}
+
+	void AudioSystem::Play(SoundId sound, float gain, float pan)
+	{
+		if (!commands.TryPush({ sound, gain, pan }))
+		{
+			dropped_commands++;
+			return;
+		}
+		played_commands++;
+	}
+
+	void AudioSystem::AddSimEvents(const World& world)
+	{
+		for (uint32_t i = 0; i < world.event_count; i++)
+		{
+			const SimEvent& event = world.events[i];
+			// Sounds sit where they happened along the field
+			float pan = std::clamp(event.pos.x / FIELD_WIDTH * 2.0f - 1.0f, -1.0f, 1.0f);
+			switch (event.type)
+			{
+				case SimEventType::SIM_BRICK_DESTROYED:
+				{
+					Play(SoundId::SOUND_BRICK_DESTROYED, 0.6f, pan);
+					break;
+				}
+
+				case SimEventType::SIM_BRICK_HIT:
+				{
+					Play(SoundId::SOUND_BRICK_HIT, 0.4f, pan);
+					break;
+				}
+
+				case SimEventType::SIM_PADDLE_HIT:
+				{
+					Play(SoundId::SOUND_PADDLE_HIT, 0.5f, pan);
+					break;
+				}
+
+				case SimEventType::SIM_WALL_HIT:
+				{
+					Play(SoundId::SOUND_WALL_HIT, 0.3f, pan);
+					break;
+				}
+
+				case SimEventType::SIM_BALL_LOST:
+				{
+					Play(SoundId::SOUND_BALL_LOST, 0.8f, 0.0f);
+					break;
+				}
+			}
+		}
+	}
+
+	void AudioSystem::StartVoice(const AudioCommand& command)
+	{
+		// A free voice if there is one, otherwise the one with the least sound left in it
+		uint32_t voice_idx = 0;
+		float lowest_loudness = std::numeric_limits<float>::max();
+		bool is_stealing = true;
+		for (uint32_t i = 0; i < voice_limit; i++)
+		{
+			const AudioVoice& voice = voices[i];
+			if (voice.remaining == 0)
+			{
+				voice_idx = i;
+				is_stealing = false;
+				break;
+			}
+
+			float loudness = (voice.gain_left + voice.gain_right) * float(voice.remaining);
+			if (loudness < lowest_loudness)
+			{
+				lowest_loudness = loudness;
+				voice_idx = i;
+			}
+		}
+		stolen_voices += is_stealing ? 1 : 0;
+
+		// Constant power panning, the sound is as loud in the middle as at either side
+		float angle = (std::clamp(command.pan, -1.0f, 1.0f) + 1.0f) * 0.25f * 3.14159265f;
+		uint32_t sound_idx = uint32_t(command.sound);
+
+		AudioVoice& voice = voices[voice_idx];
+		voice.samples = bank.samples.data() + bank.offsets[sound_idx];
+		voice.remaining = bank.lengths[sound_idx];
+		voice.gain_left = command.gain * std::cos(angle);
+		voice.gain_right = command.gain * std::sin(angle);
+	}
+
+	bool AudioSystem::HasActiveVoices() const
+	{
+		for (uint32_t i = 0; i < voice_limit; i++)
+		{
+			if (voices[i].remaining != 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void AudioSystem::MixBlock()
+	{
+		// Sounds start on block boundaries, up to 5.3 ms late, which nobody hears
+		uint32_t start_count = 0;
+		AudioCommand command;
+		while (commands.TryPop(command))
+		{
+			if (start_count == MAX_AUDIO_STARTS_PER_BLOCK)
+			{
+				skipped_starts++;
+				continue;
+			}
+			StartVoice(command);
+			start_count++;
+		}
+
+		mix_left.fill(0.0f);
+		mix_right.fill(0.0f);
+
+		uint32_t active_count = 0;
+		for (uint32_t i = 0; i < voice_limit; i++)
+		{
+			AudioVoice& voice = voices[i];
+			if (voice.remaining == 0)
+			{
+				continue;
+			}
+
+			uint32_t frame_count = std::min(voice.remaining, AUDIO_BLOCK_FRAMES);
+			Mixer::MixVoice(mix_path, voice.samples, frame_count, voice.gain_left, voice.gain_right, mix_left.data(), mix_right.data());
+			voice.samples += frame_count;
+			voice.remaining -= frame_count;
+			active_count++;
+		}
+		peak_voices = std::max(peak_voices, active_count);
+
+		Mixer::Interleave(mix_path, mix_left.data(), mix_right.data(), AUDIO_BLOCK_FRAMES, AUDIO_MASTER_GAIN, output.data());
+	}
+
+	void AudioSystem::MixLoop()
+	{
+		if (!RaiseThreadPriority())
+		{
+			OB3D_LOG("Audio mixer runs at normal priority");
+		}
+
+		// Neither sink has a device clock, the loop keeps the pace a device would ask for blocks at
+		auto schedule_start = std::chrono::steady_clock::now();
+		int64_t block_idx = 0;
+		while (is_running.load(std::memory_order_relaxed))
+		{
+			auto mix_start = std::chrono::steady_clock::now();
+			MixBlock();
+			if (!is_writing.load(std::memory_order_relaxed))
+			{
+				// Nothing to write, the sink only counts frames
+				sink.Write(output);
+			}
+			else if (!finished_blocks.TryPush(output))
+			{
+				// File I/O never runs on this thread, a stalled disk costs blocks instead of deadlines
+				dropped_blocks++;
+			}
+			auto mix_end = std::chrono::steady_clock::now();
+
+			std::chrono::duration<double, std::micro> mix_time = mix_end - mix_start;
+			mix_sum_us += mix_time.count();
+			mix_max_us = std::max(mix_max_us, mix_time.count());
+			block_count++;
+
+			// Each block has to be ready before the previous one has finished playing
+			block_idx++;
+			auto deadline = schedule_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(AudioBlocks(block_idx));
+			if (mix_end > deadline)
+			{
+				// A device would have played a gap, carry on from here instead of rushing to catch up
+				missed_deadlines++;
+				schedule_start = mix_end;
+				block_idx = 0;
+				continue;
+			}
+			std::this_thread::sleep_until(deadline);
+		}
+
+		// Nobody listens to a file in real time, the sounds still queued or playing are mixed to their end
+		// as fast as the writer takes them instead of being cut off
+		if (is_writing.load(std::memory_order_relaxed))
+		{
+			do
+			{
+				MixBlock();
+				while (!finished_blocks.TryPush(output))
+				{
+					std::this_thread::yield();
+				}
+				block_count++;
+			} while (HasActiveVoices());
+		}
+	}
+
+	void AudioSystem::WriteLoop()
+	{
+		AudioBlock block = {};
+		while (true)
+		{
+			// Read before draining, so the last pass still sees every block the joined mixer pushed
+			bool is_last_pass = !is_writing.load(std::memory_order_acquire);
+			while (finished_blocks.TryPop(block))
+			{
+				sink.Write(block);
+			}
+			if (is_last_pass)
+			{
+				return;
+			}
+
+			// Blocks arrive at playback pace, a few at a time is plenty
+			std::this_thread::sleep_for(AudioBlocks(4));
+		}
+	}
+
+	struct MixTimings
+	{
+		double avg_us;
+		double max_us;
+	};
+
+	static MixTimings BenchmarkMixPath(MixPath path, AudioSink* sink)
+	{
+		AudioSystem audio;
+		audio.Init(MAX_AUDIO_VOICES, path);
+
+		SimRng rng = {};
+		rng.Seed(1);
+
+		MixTimings timings = {};
+		for (uint32_t block = 0; block < AUDIO_BENCH_WARMUP_BLOCKS + AUDIO_BENCH_BLOCKS; block++)
+		{
+			for (uint32_t i = 0; i < MAX_AUDIO_STARTS_PER_BLOCK; i++)
+			{
+				SoundId sound = SoundId(rng.Next() % uint32_t(SoundId::SOUND_COUNT));
+				audio.Play(sound, rng.NextRange(0.05f, 0.2f), rng.NextRange(-1.0f, 1.0f));
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			audio.MixBlock();
+			std::chrono::duration<double, std::micro> mix_time = std::chrono::steady_clock::now() - start;
+
+			if (block >= AUDIO_BENCH_WARMUP_BLOCKS)
+			{
+				timings.avg_us += mix_time.count() / AUDIO_BENCH_BLOCKS;
+				timings.max_us = std::max(timings.max_us, mix_time.count());
+			}
+			if (sink != nullptr)
+			{
+				sink->Write(audio.output);
+			}
+		}
+		return timings;
+	}
+
+	namespace Audio
+	{
+		int RunBenchmark(const EngineConfig& config)
+		{
+			double budget_us = std::chrono::duration<double, std::micro>(AudioBlocks(1)).count();
+			MixPath best_path = Mixer::BestPath();
+
+			fmt::println("{} voices, {} new sounds per block, {:.0f} us to mix each {} frame block",
+				MAX_AUDIO_VOICES, MAX_AUDIO_STARTS_PER_BLOCK, budget_us, AUDIO_BLOCK_FRAMES);
+			fmt::println("{:>8s} {:>12s} {:>12s} {:>10s}", "path", "avg us", "max us", "max load");
+
+			bool is_over_budget = false;
+			for (uint32_t path_idx = 0; path_idx <= uint32_t(best_path); path_idx++)
+			{
+				// The path the engine would mix with is the one worth listening to
+				AudioSink sink = {};
+				bool has_sink = path_idx == uint32_t(best_path) && config.audio_backend == AudioBackend::AUDIO_WAV
+								&& sink.Open(config.audio_backend, config.audio_wav_path);
+
+				MixTimings timings = BenchmarkMixPath(MixPath(path_idx), has_sink ? &sink : nullptr);
+				if (has_sink)
+				{
+					sink.Close();
+				}
+
+				fmt::println("{:>8s} {:>12.2f} {:>12.2f} {:>9.1f}%", MIX_PATH_NAMES[path_idx], timings.avg_us, timings.max_us,
+					timings.max_us / budget_us * 100.0);
+				is_over_budget = is_over_budget || timings.max_us > budget_us;
+			}
+
+			if (is_over_budget)
+			{
+				fmt::println("A block took longer to mix than it plays for");
+			}
+			return is_over_budget ? 1 : 0;
+		}
+
+		double TimeMixBlock()
+		{
+			return BenchmarkMixPath(Mixer::BestPath(), nullptr).avg_us;
+		}
+	}
+}
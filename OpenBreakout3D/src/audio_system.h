@@ -0,0 +1,154 @@
+#pragma once
+#include "util.h"
+#include "engine_config.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+#include "audio_mixer.h"
+
+namespace OB3D
+{
+	constexpr uint32_t AUDIO_SAMPLE_RATE = 48000;
+	// Frames mixed per block, the mixer has 5.3 ms to finish each one
+	constexpr uint32_t AUDIO_BLOCK_FRAMES = 256;
+	// Size of the voice pool, --audio-voices picks how much of it is used
+	constexpr uint32_t MAX_AUDIO_VOICES = 256;
+	// Sounds started per block at most, a burst beyond that is dropped rather than spent searching for voices
+	constexpr uint32_t MAX_AUDIO_STARTS_PER_BLOCK = 64;
+	constexpr uint32_t AUDIO_COMMAND_CAPACITY = 1024;
+	// Mixed blocks waiting for the sink's writer thread, 64 blocks are 340 ms of stalled disk writes
+	constexpr uint32_t AUDIO_SINK_QUEUE_BLOCKS = 64;
+
+	// Interleaved 16 bit stereo, one block of it
+	using AudioBlock = std::array<int16_t, AUDIO_BLOCK_FRAMES * 2>;
+
+	// Wall clock length of a number of blocks. Converted to nanoseconds with the reduced ratio, which takes
+	// centuries of blocks to overflow where multiplying the count out by hand took days
+	using AudioBlocks = std::chrono::duration<int64_t, std::ratio<AUDIO_BLOCK_FRAMES, AUDIO_SAMPLE_RATE>>;
+
+	// Synthesized on startup, one per SimEventType that makes a sound
+	enum class SoundId : uint8_t
+	{
+		SOUND_BRICK_DESTROYED,
+		SOUND_BRICK_HIT,
+		SOUND_PADDLE_HIT,
+		SOUND_WALL_HIT,
+		SOUND_BALL_LOST,
+		SOUND_COUNT
+	};
+
+	// Sent from the simulation to the mixer thread
+	struct AudioCommand
+	{
+		SoundId sound;
+		float gain;
+		// -1 is fully left, 1 fully right
+		float pan;
+	};
+
+	// Mono samples of every sound back to back, built once and only read afterwards
+	struct SoundBank
+	{
+		std::vector<float> samples;
+		std::array<uint32_t, size_t(SoundId::SOUND_COUNT)> offsets = {};
+		std::array<uint32_t, size_t(SoundId::SOUND_COUNT)> lengths = {};
+
+		void Build();
+	};
+
+	struct AudioVoice
+	{
+		// Next sample to play
+		const float* samples;
+		// Free once it reaches 0
+		uint32_t remaining;
+		float gain_left;
+		float gain_right;
+	};
+
+	// Where mixed blocks go. A device backend would be another AudioBackend with its own branch here
+	struct AudioSink
+	{
+		bool Open(AudioBackend sink_backend, const std::string& wav_path);
+		// Interleaved 16 bit stereo at AUDIO_SAMPLE_RATE
+		void Write(std::span<const int16_t> samples);
+		void Close();
+
+		AudioBackend backend = AudioBackend::AUDIO_OFF;
+		FILE* wav_file = nullptr;
+		uint32_t written_frames = 0;
+		// Frames with any sample other than 0
+		uint32_t audible_frames = 0;
+	};
+
+	// Collision sounds, mixed block by block on a thread of their own. The simulation only pushes commands
+	// into a lock free queue, and the mixer never allocates or locks, so neither side can hold up the other.
+	// A sink that writes a file gets a writer thread at normal priority, the mixer hands it blocks through another queue
+	struct AudioSystem
+	{
+		// Starts the mixer thread, does nothing when the audio backend is off
+		void Start(const EngineConfig& config);
+		// Joins the mixer thread, closes the sink and prints how the mixer kept up
+		// A sink that writes a file gets the sounds still playing to their end first
+		void Stop();
+		bool IsActive() const { return is_active; }
+		// Read once stopped
+		uint32_t AudibleFrames() const { return sink.audible_frames; }
+
+		// Simulation thread, drops the sound when the queue is full
+		void Play(SoundId sound, float gain, float pan);
+		void AddSimEvents(const World& world);
+
+		// Everything the mixer thread does without a thread, for benchmarks
+		void Init(uint32_t voice_count, MixPath path);
+		// Starts the queued sounds and mixes the next AUDIO_BLOCK_FRAMES frames into output
+		void MixBlock();
+
+		alignas(32) AudioBlock output = {};
+
+		// Simulation thread
+		uint32_t played_commands = 0;
+		uint32_t dropped_commands = 0;
+		// Mixer thread, read once it has been joined
+		uint64_t block_count = 0;
+		uint32_t missed_deadlines = 0;
+		uint32_t stolen_voices = 0;
+		uint32_t skipped_starts = 0;
+		uint32_t peak_voices = 0;
+		// Blocks lost because the writer thread fell behind
+		uint32_t dropped_blocks = 0;
+		double mix_sum_us = 0.0;
+		double mix_max_us = 0.0;
+
+	private:
+		void MixLoop();
+		void WriteLoop();
+		void StartVoice(const AudioCommand& command);
+		bool HasActiveVoices() const;
+
+		bool is_active = false;
+		std::atomic<bool> is_running = false;
+		std::thread mixer;
+		AudioSink sink;
+		// Only cleared once the mixer has been joined, the writer then drains what's left and exits
+		std::atomic<bool> is_writing = false;
+		std::thread writer;
+		SpscQueue<AudioBlock, AUDIO_SINK_QUEUE_BLOCKS> finished_blocks;
+
+		SpscQueue<AudioCommand, AUDIO_COMMAND_CAPACITY> commands;
+		SoundBank bank;
+		MixPath mix_path = MixPath::MIX_SCALAR;
+		uint32_t voice_limit = 0;
+		std::array<AudioVoice, MAX_AUDIO_VOICES> voices = {};
+		alignas(32) std::array<float, AUDIO_BLOCK_FRAMES> mix_left = {};
+		alignas(32) std::array<float, AUDIO_BLOCK_FRAMES> mix_right = {};
+	};
+
+	namespace Audio
+	{
+		// Mixes every voice of the pool with a full burst of new sounds each block, so every start steals a voice,
+		// once per SIMD path the CPU has. Fails when a block took longer than it plays for
+		int RunBenchmark(const EngineConfig& config);
+		// Average microseconds per block of that load on the best path, for the performance suite
+		double TimeMixBlock();
+	}
+}
@@ -0,0 +1,66 @@
+#include "command_cache.h"
+
+namespace OB3D
+{
+	void CommandBufferCache::Init(VkDevice device_handle, uint32_t queue_family_idx)
+	{
+		device = device_handle;
+
+		// Buffers are reset one by one when they are recorded again
+		VkCommandPoolCreateInfo pool_info = VkConstructors::CommandPoolCreateInfo(queue_family_idx);
+		VkResult result = vkCreateCommandPool(device, &pool_info, nullptr, &command_pool);
+		OB3D_VK_CHECK(result, "Failed to create command cache pool");
+	}
+
+	void CommandBufferCache::Push(DestroyerQueue& queue)
+	{
+		Destroyable dstr_pool = {};
+		dstr_pool.cmd_pool = command_pool;
+		dstr_pool.type = DestroyableVkType::DESTROYABLE_COMMAND_POOL;
+		queue.Push(dstr_pool);
+	}
+
+	VkCommandBuffer CommandBufferCache::Get(uint32_t key, const std::function<void(VkCommandBuffer cmd)>& record)
+	{
+		auto it = entries.find(key);
+		if (it != entries.end() && it->second.generation == generation)
+		{
+			return it->second.cmd;
+		}
+
+		if (it == entries.end())
+		{
+			VkCommandBufferAllocateInfo allocate_info = VkConstructors::CommandBufferAllocateInfo(command_pool, 1);
+			allocate_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+			Entry entry = {};
+			VkResult result = vkAllocateCommandBuffers(device, &allocate_info, &entry.cmd);
+			OB3D_VK_CHECK(result, "Failed to allocate cached command buffer");
+			it = entries.emplace(key, entry).first;
+		}
+
+		// Outside of any render pass, nothing is inherited from the primary
+		VkCommandBufferInheritanceInfo inheritance_info = {};
+		inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+		// No ONE_TIME_SUBMIT, the recording is replayed until the next invalidation
+		VkCommandBufferBeginInfo begin_info = VkConstructors::CommandBufferBeginInfo(0);
+		begin_info.pInheritanceInfo = &inheritance_info;
+
+		Entry& entry = it->second;
+		VkResult result = vkBeginCommandBuffer(entry.cmd, &begin_info);
+		OB3D_VK_CHECK(result, "Failed to begin cached command buffer");
+		record(entry.cmd);
+		result = vkEndCommandBuffer(entry.cmd);
+		OB3D_VK_CHECK(result, "Failed to end cached command buffer");
+
+		entry.generation = generation;
+		record_count++;
+		return entry.cmd;
+	}
+
+	void CommandBufferCache::Invalidate()
+	{
+		generation++;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "util.h"
+#include "vk_constructors.h"
+#include "destroyer_queue.h"
+
+#include <unordered_map>
+
+namespace OB3D
+{
+	// Secondary command buffers for the parts of a frame that come out the same every frame, e.g. the background
+	// dispatch or the present pass into one swapchain image. Recorded on first use and replayed with
+	// vkCmdExecuteCommands until the owner invalidates them, which it does whenever targets or pipelines change
+	// A buffer is only ever replayed by one frame in flight at a time, keys have to include the frame slot
+	// when the recording differs per slot or the same key is used by consecutive frames
+	struct CommandBufferCache
+	{
+		void Init(VkDevice device, uint32_t queue_family_idx);
+		// Hands the pool and with it every buffer to the queue
+		void Push(DestroyerQueue& queue);
+
+		// Buffer recorded for the key, records it with the function first when it is missing or stale
+		VkCommandBuffer Get(uint32_t key, const std::function<void(VkCommandBuffer cmd)>& record);
+		// Every buffer is recorded again on its next use
+		// The caller makes sure the GPU is done with them, re-recording resets a buffer
+		void Invalidate();
+
+		struct Entry
+		{
+			VkCommandBuffer cmd;
+			// Recorded while generation had this value
+			uint64_t generation;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkCommandPool command_pool = VK_NULL_HANDLE;
+		std::unordered_map<uint32_t, Entry> entries;
+		uint64_t generation = 1;
+		// Recordings since startup, keeps growing when something invalidates the cache every frame
+		uint32_t record_count = 0;
+	};
+}
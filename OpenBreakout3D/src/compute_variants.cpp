@@ -0,0 +1,245 @@
+#include "compute_variants.h"
+#include <cstdio>
+
+namespace OB3D
+{
+	// Shapes worth timing, wide rows first since the kernels walk images row by row
+	constexpr std::array<std::array<uint32_t, 2>, 8> CANDIDATE_SIZES = { {
+		{ 8, 4 }, { 8, 8 }, { 16, 4 }, { 16, 8 }, { 32, 4 }, { 64, 2 }, { 16, 16 }, { 32, 8 }
+	} };
+
+	constexpr const char* TUNING_FILE_HEADER = "# vendor device driver kernel x y subgroup_size, written by the kernel auto tuner\n";
+
+	VkPipeline ComputeVariantCache::Find(uint64_t key) const
+	{
+		auto it = pipelines.find(key);
+		return it == pipelines.end() ? VK_NULL_HANDLE : it->second;
+	}
+
+	void ComputeVariantCache::Insert(uint64_t key, VkPipeline pipeline)
+	{
+		pipelines[key] = pipeline;
+	}
+
+	void ComputeVariantCache::Release(DestroyerQueue& queue)
+	{
+		for (const auto& [key, pipeline] : pipelines)
+		{
+			Destroyable dstr_pipeline = {};
+			dstr_pipeline.pipeline = pipeline;
+			dstr_pipeline.type = DestroyableVkType::DESTROYABLE_PIPELINE;
+			queue.Push(dstr_pipeline);
+		}
+		pipelines.clear();
+	}
+
+	namespace ComputeVariants
+	{
+		ComputeDeviceInfo QueryDevice(VkPhysicalDevice physical, const VkPhysicalDeviceSubgroupProperties& subgroup_props,
+									  const VkPhysicalDeviceVulkan13Properties& props13)
+		{
+			VkPhysicalDeviceProperties device_props = {};
+			vkGetPhysicalDeviceProperties(physical, &device_props);
+
+			ComputeDeviceInfo device = {};
+			device.type = device_props.deviceType;
+			device.vendor_id = device_props.vendorID;
+			device.device_id = device_props.deviceID;
+			device.driver_version = device_props.driverVersion;
+			device.subgroup_size = std::max(subgroup_props.subgroupSize, 1u);
+			device.max_invocations = device_props.limits.maxComputeWorkGroupInvocations;
+			device.max_size_x = device_props.limits.maxComputeWorkGroupSize[0];
+			device.max_size_y = device_props.limits.maxComputeWorkGroupSize[1];
+
+			device.can_pin_subgroup_size = props13.requiredSubgroupSizeStages & VK_SHADER_STAGE_COMPUTE_BIT;
+			device.min_subgroup_size = device.can_pin_subgroup_size ? props13.minSubgroupSize : device.subgroup_size;
+			device.max_subgroup_size = device.can_pin_subgroup_size ? props13.maxSubgroupSize : device.subgroup_size;
+			device.max_workgroup_subgroups = props13.maxComputeWorkgroupSubgroups;
+
+			return device;
+		}
+
+		static bool FitsDevice(const ComputeDeviceInfo& device, uint32_t x, uint32_t y)
+		{
+			return x <= device.max_size_x && y <= device.max_size_y && x * y <= device.max_invocations;
+		}
+
+		// A pinned subgroup size has to be one the device can pin compute shaders to, with few enough subgroups per workgroup
+		static bool FitsSubgroupSize(const ComputeDeviceInfo& device, uint32_t x, uint32_t y, uint32_t subgroup_size)
+		{
+			if (subgroup_size == 0)
+			{
+				return true;
+			}
+
+			bool is_pinnable = device.can_pin_subgroup_size && (subgroup_size & (subgroup_size - 1)) == 0
+							   && subgroup_size >= device.min_subgroup_size && subgroup_size <= device.max_subgroup_size;
+			return is_pinnable && x * y <= subgroup_size * device.max_workgroup_subgroups;
+		}
+
+		WorkgroupShape DefaultShape(const ComputeDeviceInfo& device)
+		{
+			// CPU implementations run a workgroup per task, bigger ones spread the per task overhead
+			// GPUs get two subgroups per workgroup but never fewer than 64 invocations
+			uint32_t invocations = device.type == VK_PHYSICAL_DEVICE_TYPE_CPU
+								   ? 256
+								   : std::max(64u, device.subgroup_size * 2);
+
+			WorkgroupShape shape = {};
+			shape.x = invocations >= 128 ? 16 : 8;
+			shape.y = invocations / shape.x;
+
+			while (!FitsDevice(device, shape.x, shape.y) && shape.x * shape.y > 1)
+			{
+				if (shape.x >= shape.y)
+				{
+					shape.x /= 2;
+				}
+				else
+				{
+					shape.y /= 2;
+				}
+			}
+			return shape;
+		}
+
+		std::vector<WorkgroupShape> CandidateShapes(const ComputeDeviceInfo& device)
+		{
+			// Pinning the subgroup size picks e.g. wave32 or wave64 on AMD and SIMD8 or SIMD32 on Intel
+			std::vector<uint32_t> subgroup_sizes = { 0 };
+			if (device.min_subgroup_size != device.max_subgroup_size)
+			{
+				subgroup_sizes.push_back(device.min_subgroup_size);
+				subgroup_sizes.push_back(device.max_subgroup_size);
+			}
+
+			std::vector<WorkgroupShape> candidates;
+			for (const std::array<uint32_t, 2>& size : CANDIDATE_SIZES)
+			{
+				for (uint32_t subgroup_size : subgroup_sizes)
+				{
+					// A workgroup smaller than a subgroup leaves lanes idle
+					uint32_t invocations = size[0] * size[1];
+					uint32_t min_invocations = subgroup_size == 0 ? device.subgroup_size : subgroup_size;
+					if (FitsDevice(device, size[0], size[1]) && FitsSubgroupSize(device, size[0], size[1], subgroup_size)
+						&& invocations >= min_invocations)
+					{
+						candidates.push_back({ size[0], size[1], subgroup_size });
+					}
+				}
+			}
+
+			if (candidates.empty())
+			{
+				candidates.push_back(DefaultShape(device));
+			}
+			return candidates;
+		}
+
+		struct TuningLine
+		{
+			uint32_t vendor_id;
+			uint32_t device_id;
+			uint32_t driver_version;
+			std::string kernel;
+			WorkgroupShape shape;
+		};
+
+		static std::vector<TuningLine> ReadTuningFile(const char* path)
+		{
+			std::vector<TuningLine> lines;
+			FILE* file = std::fopen(path, "r");
+			if (file == nullptr)
+			{
+				return lines;
+			}
+
+			std::array<char, 256> text = {};
+			while (std::fgets(text.data(), int(text.size()), file) != nullptr)
+			{
+				std::array<char, 64> kernel = {};
+				TuningLine line = {};
+				int fields = std::sscanf(text.data(), "%u %u %u %63s %u %u %u",
+										 &line.vendor_id, &line.device_id, &line.driver_version, kernel.data(),
+										 &line.shape.x, &line.shape.y, &line.shape.subgroup_size);
+				// Comments and anything malformed are skipped
+				if (text[0] == '#' || fields != 7 || line.shape.x == 0 || line.shape.y == 0)
+				{
+					continue;
+				}
+
+				line.kernel = kernel.data();
+				lines.push_back(line);
+			}
+
+			std::fclose(file);
+			return lines;
+		}
+
+		static bool IsSameDevice(const TuningLine& line, const ComputeDeviceInfo& device)
+		{
+			return line.vendor_id == device.vendor_id && line.device_id == device.device_id && line.driver_version == device.driver_version;
+		}
+
+		uint32_t LoadTuning(const char* path, const ComputeDeviceInfo& device, std::array<WorkgroupShape, KERNEL_COUNT>& shapes)
+		{
+			uint32_t found_mask = 0;
+			for (const TuningLine& line : ReadTuningFile(path))
+			{
+				for (uint32_t kernel = 0; kernel < KERNEL_COUNT && IsSameDevice(line, device); kernel++)
+				{
+					// A driver update may have lowered the limits, or the file was edited by hand, such a line is ignored
+					if (line.kernel == KERNEL_SHADER_NAMES[kernel] && FitsDevice(device, line.shape.x, line.shape.y)
+						&& FitsSubgroupSize(device, line.shape.x, line.shape.y, line.shape.subgroup_size))
+					{
+						shapes[kernel] = line.shape;
+						found_mask |= 1u << kernel;
+					}
+				}
+			}
+			return found_mask;
+		}
+
+		bool SaveTuning(const char* path, const ComputeDeviceInfo& device, const std::array<WorkgroupShape, KERNEL_COUNT>& shapes,
+						uint32_t kernel_mask)
+		{
+			std::vector<TuningLine> lines = ReadTuningFile(path);
+			std::erase_if(lines, [&](const TuningLine& line)
+			{
+				for (uint32_t kernel = 0; kernel < KERNEL_COUNT; kernel++)
+				{
+					if ((kernel_mask & (1u << kernel)) && line.kernel == KERNEL_SHADER_NAMES[kernel])
+					{
+						return IsSameDevice(line, device);
+					}
+				}
+				return false;
+			});
+
+			for (uint32_t kernel = 0; kernel < KERNEL_COUNT; kernel++)
+			{
+				if (kernel_mask & (1u << kernel))
+				{
+					lines.push_back({ device.vendor_id, device.device_id, device.driver_version, std::string(KERNEL_SHADER_NAMES[kernel]), shapes[kernel] });
+				}
+			}
+
+			FILE* file = std::fopen(path, "w");
+			if (file == nullptr)
+			{
+				fmt::println("Failed to write kernel tuning {:s}", path);
+				return false;
+			}
+
+			bool is_written = std::fputs(TUNING_FILE_HEADER, file) >= 0;
+			for (const TuningLine& line : lines)
+			{
+				std::string text = fmt::format("{} {} {} {:s} {} {} {}\n", line.vendor_id, line.device_id, line.driver_version,
+											   line.kernel, line.shape.x, line.shape.y, line.shape.subgroup_size);
+				is_written = is_written && std::fputs(text.c_str(), file) >= 0;
+			}
+			std::fclose(file);
+			return is_written;
+		}
+	}
+}
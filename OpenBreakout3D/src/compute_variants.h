@@ -0,0 +1,106 @@
+#pragma once
+#include "util.h"
+#include "destroyer_queue.h"
+
+#include <unordered_map>
+
+namespace OB3D
+{
+	// 2D image kernels whose workgroup shape is picked per device
+	enum ComputeKernel : uint32_t
+	{
+		KERNEL_BACKGROUND,
+		KERNEL_BLOOM_UPSAMPLE,
+		KERNEL_PRESENT,
+		KERNEL_COUNT
+	};
+
+	// Shader of each kernel, also the kernel's name in the tuning file
+	constexpr std::array<std::string_view, KERNEL_COUNT> KERNEL_SHADER_NAMES = { "gradient", "bloom_upsample", "present" };
+
+	// Specialization constant ids shared by every kernel, see Shaders/kernel_variant.glsl
+	enum KernelSpecConstant : uint32_t
+	{
+		SPEC_WORKGROUP_X,
+		SPEC_WORKGROUP_Y,
+		SPEC_SUBGROUP_SIZE,
+		SPEC_FEATURES
+	};
+
+	// Feature bits of KERNEL_PRESENT
+	constexpr uint32_t PRESENT_FEATURE_AGX = 1u << 0;
+	// The draw image is display referred (RGBA8), exposure and tonemapping are skipped
+	constexpr uint32_t PRESENT_FEATURE_LDR = 1u << 1;
+
+	struct WorkgroupShape
+	{
+		uint32_t x = 8;
+		uint32_t y = 8;
+		// Required subgroup size the pipeline is created with, 0 leaves the choice to the driver
+		uint32_t subgroup_size = 0;
+
+		bool operator==(const WorkgroupShape&) const = default;
+	};
+
+	// Everything a pipeline variant is specialized on packed into one integer
+	// kernel 8 bits | x 12 bits | y 12 bits | subgroup size 8 bits | features 24 bits
+	constexpr uint64_t ComputeVariantKey(ComputeKernel kernel, WorkgroupShape shape, uint32_t features)
+	{
+		return uint64_t(kernel)
+			   | uint64_t(shape.x & 0xFFF) << 8
+			   | uint64_t(shape.y & 0xFFF) << 20
+			   | uint64_t(shape.subgroup_size & 0xFF) << 32
+			   | uint64_t(features & 0xFFFFFF) << 40;
+	}
+	static_assert(ComputeVariantKey(KERNEL_PRESENT, { 8, 8, 0 }, 0) != ComputeVariantKey(KERNEL_PRESENT, { 8, 8, 32 }, 0));
+	static_assert(ComputeVariantKey(KERNEL_PRESENT, { 16, 8, 0 }, 0) != ComputeVariantKey(KERNEL_PRESENT, { 8, 16, 0 }, 0));
+
+	// What the shapes are derived from, filled from the physical device's properties
+	struct ComputeDeviceInfo
+	{
+		VkPhysicalDeviceType type;
+		// Identify the device and driver in the tuning file
+		uint32_t vendor_id;
+		uint32_t device_id;
+		uint32_t driver_version;
+		uint32_t subgroup_size;
+		// Whether compute pipelines can require a subgroup size
+		bool can_pin_subgroup_size;
+		// Range the subgroup size can be pinned to, min == max when it can't
+		uint32_t min_subgroup_size;
+		uint32_t max_subgroup_size;
+		// Subgroups a workgroup may have at a pinned size
+		uint32_t max_workgroup_subgroups;
+		uint32_t max_invocations;
+		uint32_t max_size_x;
+		uint32_t max_size_y;
+	};
+
+	// Pipelines by variant key, created on first use and kept until released
+	struct ComputeVariantCache
+	{
+		VkPipeline Find(uint64_t key) const;
+		void Insert(uint64_t key, VkPipeline pipeline);
+		// Hands every pipeline to the queue and empties the cache
+		void Release(DestroyerQueue& queue);
+
+		std::unordered_map<uint64_t, VkPipeline> pipelines;
+	};
+
+	namespace ComputeVariants
+	{
+		ComputeDeviceInfo QueryDevice(VkPhysicalDevice physical, const VkPhysicalDeviceSubgroupProperties& subgroup_props,
+									  const VkPhysicalDeviceVulkan13Properties& props13);
+		// Used until the kernel has been tuned on this device
+		WorkgroupShape DefaultShape(const ComputeDeviceInfo& device);
+		// Shapes the auto tuner times, all within the device's limits
+		std::vector<WorkgroupShape> CandidateShapes(const ComputeDeviceInfo& device);
+
+		// Tuning file: one "vendor device driver kernel x y subgroup_size" line per device and kernel
+		// Overwrites the shapes found for this device, returns a bit per kernel that was found
+		uint32_t LoadTuning(const char* path, const ComputeDeviceInfo& device, std::array<WorkgroupShape, KERNEL_COUNT>& shapes);
+		// Writes the kernels in kernel_mask, lines of other devices and kernels are kept
+		bool SaveTuning(const char* path, const ComputeDeviceInfo& device, const std::array<WorkgroupShape, KERNEL_COUNT>& shapes,
+						uint32_t kernel_mask);
+	}
+}
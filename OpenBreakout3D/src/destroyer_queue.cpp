@@ -12,6 +12,8 @@ namespace OB3D
 
 	void DestroyerQueue::Push(const Destroyable& destroyable)
 	{
+		std::lock_guard lock(push_mutex);
+
 		// Check for handles that need to be held onto for deletion of other handles
 		if (destroyable.type == DestroyableVkType::DESTROYABLE_INSTANCE
 			&& inst_handle == nullptr
@@ -54,7 +56,7 @@ namespace OB3D
 			{
 				vkDestroyInstance(destroyable.inst, nullptr);
 				inst_handle = nullptr;
-				fmt::println("Instance Destroyed Successfully");
+				OB3D_LOG("Instance Destroyed Successfully");
 				break;
 			}
 
@@ -62,35 +64,54 @@ namespace OB3D
 			{
 				vkDestroyDevice(destroyable.device, nullptr);
 				device_handle = nullptr;
-				fmt::println("Logical Device Destroyed Successfully");
+				OB3D_LOG("Logical Device Destroyed Successfully");
 				break;
 			}
 
 			case DestroyableVkType::DESTROYABLE_SURFACE:
 			{
 				vkDestroySurfaceKHR(inst_handle, destroyable.surface, nullptr);
-				fmt::println("SurfaceKHR Destroyed Successfully");
+				OB3D_LOG("SurfaceKHR Destroyed Successfully");
 				break;
 			}
 
 			case DestroyableVkType::DESTROYABLE_IMG_VIEW:
 			{
 				vkDestroyImageView(device_handle, destroyable.img_view, nullptr);
-				fmt::println("Img View Destroyed Successfully");
+				OB3D_LOG("Img View Destroyed Successfully");
 				break;
 			}
 			
 			case DestroyableVkType::DESTROYABLE_IMG:
 			{
 				vmaDestroyImage(alloc_handle, destroyable.img, destroyable.allocation);
-				fmt::println("Img Destroyed Successfully");
+				OB3D_LOG("Img Destroyed Successfully");
 				break;
 			}
 		
+			case DestroyableVkType::DESTROYABLE_BUFFER:
+			{
+				vmaDestroyBuffer(alloc_handle, destroyable.buffer, destroyable.allocation);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_RAW_IMG:
+			{
+				// Image bound to memory it doesn't own, the memory is freed on its own
+				vkDestroyImage(device_handle, destroyable.img, nullptr);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_MEMORY:
+			{
+				vmaFreeMemory(alloc_handle, destroyable.allocation);
+				break;
+			}
+
 			case DestroyableVkType::DESTROYABLE_SWAPCHAIN:
 			{
 				vkDestroySwapchainKHR(device_handle, destroyable.swapchain, nullptr);
-				fmt::println("SwapchainKHR Destroyed Successfully");
+				OB3D_LOG("SwapchainKHR Destroyed Successfully");
 				break;
 			}
 
@@ -115,7 +136,7 @@ namespace OB3D
 			case DestroyableVkType::DESTROYABLE_DBG_MESSENGER:
 			{
 				vkb::destroy_debug_utils_messenger(inst_handle, destroyable.dbg_msg);
-				fmt::println("Dbg Messenger Function Destroyed Successfully");
+				OB3D_LOG("Dbg Messenger Function Destroyed Successfully");
 				break;
 			}
 
@@ -123,7 +144,7 @@ namespace OB3D
 			{
 				vmaDestroyAllocator(destroyable.alloc);
 				alloc_handle = nullptr;
-				fmt::println("VMA Destroyed Successfully");
+				OB3D_LOG("VMA Destroyed Successfully");
 				break;
 			}
 
@@ -131,7 +152,38 @@ namespace OB3D
 			{
 				descr_allocator.DestroyPool(device_handle);
 				vkDestroyDescriptorSetLayout(device_handle, destroyable.set_layout, nullptr);
-				fmt::println("Descriptor Set Destroyed Successfully");
+				OB3D_LOG("Descriptor Set Destroyed Successfully");
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_PIPELINE:
+			{
+				vkDestroyPipeline(device_handle, destroyable.pipeline, nullptr);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT:
+			{
+				vkDestroyPipelineLayout(device_handle, destroyable.pipeline_layout, nullptr);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_DESCR_LAYOUT:
+			{
+				// Layouts other than the draw image one, the pool is destroyed with DESTROYABLE_DESCR_SET
+				vkDestroyDescriptorSetLayout(device_handle, destroyable.set_layout, nullptr);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_QUERY_POOL:
+			{
+				vkDestroyQueryPool(device_handle, destroyable.query_pool, nullptr);
+				break;
+			}
+
+			case DestroyableVkType::DESTROYABLE_SAMPLER:
+			{
+				vkDestroySampler(device_handle, destroyable.sampler, nullptr);
 				break;
 			}
 
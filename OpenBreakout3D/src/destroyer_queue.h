@@ -18,7 +18,15 @@ namespace OB3D
 		DESTROYABLE_DBG_MESSENGER,
 		DESTROYABLE_VMA,
 		DESTROYABLE_DESCR_SET,
-		DESTROYABLE_DESCR_ALLOC
+		DESTROYABLE_DESCR_ALLOC,
+		DESTROYABLE_BUFFER,
+		DESTROYABLE_RAW_IMG,
+		DESTROYABLE_MEMORY,
+		DESTROYABLE_PIPELINE,
+		DESTROYABLE_PIPELINE_LAYOUT,
+		DESTROYABLE_DESCR_LAYOUT,
+		DESTROYABLE_QUERY_POOL,
+		DESTROYABLE_SAMPLER
 	};
 
 	struct Destroyable
@@ -30,6 +38,7 @@ namespace OB3D
 			VkSurfaceKHR surface;
 			VkImageView img_view;
 			VkImage img;
+			VkBuffer buffer;
 			VkSwapchainKHR swapchain;
 			VkSemaphore semaphore;
 			VkFence fence;
@@ -37,6 +46,10 @@ namespace OB3D
 			VkDebugUtilsMessengerEXT dbg_msg;
 			VmaAllocator alloc;
 			VkDescriptorSetLayout set_layout;
+			VkPipeline pipeline;
+			VkPipelineLayout pipeline_layout;
+			VkQueryPool query_pool;
+			VkSampler sampler;
 			uint64_t unknown;
 		};
 		VmaAllocation allocation;
@@ -46,6 +59,8 @@ namespace OB3D
 	struct DestroyerQueue
 	{
 		std::vector<Destroyable> destroyables;
+		// Startup steps push from several threads
+		std::mutex push_mutex;
 
 	public:
 		void Push(const Destroyable& destroyable);
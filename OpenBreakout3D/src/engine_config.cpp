@@ -0,0 +1,339 @@
+#include "engine_config.h"
+
+namespace OB3D
+{
+	static void PrintUsage(const char* exe_name)
+	{
+		fmt::println("Usage: {:s} [options]", exe_name);
+		fmt::println("  --mem-stats <frames>        Print memory statistics every <frames> frames");
+		fmt::println("  --mem-stats-json            Print memory statistics as JSON lines");
+		fmt::println("  --budget-pressure <ratio>   Heap budget usage that triggers memory pressure (default 0.9)");
+		fmt::println("  --draw-format <format>      Draw image format: rgba16f, r11g11b10 or rgba8 (LDR) (default rgba16f)");
+		fmt::println("  --present-mode <mode>       Swapchain present mode: fifo, mailbox or immediate (default fifo)");
+		fmt::println("  --blit-present              Copy the draw image to the swapchain with vkCmdBlitImage2, without tonemapping or bloom");
+		fmt::println("  --sharpness <0-1>           Sharpening of the compute present pass when upscaling (default 0.5)");
+		fmt::println("  --tonemap <aces|agx>        Tonemapping curve of the compute present pass (default aces)");
+		fmt::println("  --bloom <intensity>         Bloom strength, 0 disables bloom (default 0.6)");
+		fmt::println("  --bloom-threshold <value>   Brightness where bloom starts (default 1.0)");
+		fmt::println("  --no-command-cache          Record the whole frame every frame");
+		fmt::println("  --capture <dir>             Write every frame's draw image to <dir> without stalling the render loop");
+		fmt::println("  --capture-format <ppm|png>  File format of captured frames (default ppm)");
+		fmt::println("  --golden <dir>              Compare every frame against <dir>/frame_NNNNN.ppm, fails on differences");
+		fmt::println("  --golden-tolerance <n>      Largest per channel difference to a golden frame that matches (default 2)");
+		fmt::println("  --low-latency               Sample input as late as possible before recording a frame");
+		fmt::println("  --fps-limit <fps>           Cap the frame rate, 0 disables the cap (default 0)");
+		fmt::println("  --gpu-pacing                Start each frame just before the GPU is predicted to be free");
+		fmt::println("  --stats <frames>            Print frame statistics every <frames> frames");
+		fmt::println("  --audio <off|null|wav>      Audio output, null mixes without playing anything (default off)");
+		fmt::println("  --audio-wav <file>          Mix audio into <file>, implies --audio wav (default audio.wav)");
+		fmt::println("  --audio-voices <n>          Sounds playing at once before the quietest is cut off (default 64)");
+		fmt::println("  --audio-bench               Time the audio mixer at its worst case load and exit");
+		fmt::println("  --serial-init               Initialize on a single thread");
+		fmt::println("  --headless                  Render without a window");
+		fmt::println("  --frames <n>                Exit after <n> frames");
+		fmt::println("  --pack <file>               Asset pack to load (default Assets/breakout.ob3pak next to the executable)");
+		fmt::println("  --level <name>              Level to start on (default level0)");
+		fmt::println("  --verify-pack               Check every asset checksum on startup");
+		fmt::println("  --shader-dir <dir>          Load <name>.spv from <dir> over the embedded shaders, F5 reloads them");
+		fmt::println("  --tuning <file>             Workgroup shapes of the compute kernels per device (default kernel_tuning.txt next to the executable)");
+		fmt::println("  --no-tuning                 Use the device's default workgroup shapes, never time or save them");
+		fmt::println("  --autotune                  Time the compute kernels' workgroup shapes again and save the fastest");
+		fmt::println("  --shadow-map <size>         Resolution of each shadow cascade, 0 disables shadows (default 2048)");
+		fmt::println("  --depth-prepass             Draw the scene's depth before shading it");
+		fmt::println("  --particles <n>             Particle pool capacity, 0 disables particles (default 65536)");
+		fmt::println("  --particle-bench            Time the GPU particle passes from 10k to 1M particles and exit");
+		fmt::println("  --perf-suite <file>         Run the performance suite headless, write the results to <file> and exit");
+		fmt::println("  --perf-baseline <file>      Fail the performance suite when it is slower than these results");
+		fmt::println("  --perf-tolerance <ratio>    Slowdown over the baseline that passes (default 0.15)");
+		fmt::println("  --perf-update-baseline      Store the performance suite's results as the baseline");
+		fmt::println("  --seed <n>                  Seed of the simulation");
+		fmt::println("  --record <file>             Record the session to a replay file");
+		fmt::println("  --replay <file>             Play back a replay headless at full speed and verify it");
+		fmt::println("  --replay-sim-only           Only run the simulation during --replay");
+	}
+
+	bool ParseEngineConfig(int argc, char** argv, EngineConfig& config)
+	{
+		// Kept next to the executable, paths given on the command line are taken as they are
+		config.pack_path = ExecutableRelativePath(config.pack_path);
+		config.tuning_path = ExecutableRelativePath(config.tuning_path);
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string_view arg = argv[i];
+			bool has_value = i + 1 < argc;
+
+			if (arg == "--mem-stats" && has_value)
+			{
+				config.mem_stats_interval = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--mem-stats-json")
+			{
+				config.mem_stats_json = true;
+			}
+			else if (arg == "--budget-pressure" && has_value)
+			{
+				config.budget_pressure_ratio = std::strtof(argv[++i], nullptr);
+			}
+			else if (arg == "--draw-format" && has_value)
+			{
+				std::string_view name = argv[++i];
+				if (name == "rgba16f")
+				{
+					config.draw_format = DrawFormat::DRAW_FORMAT_RGBA16F;
+				}
+				else if (name == "r11g11b10")
+				{
+					config.draw_format = DrawFormat::DRAW_FORMAT_R11G11B10F;
+				}
+				else if (name == "rgba8")
+				{
+					config.draw_format = DrawFormat::DRAW_FORMAT_RGBA8;
+				}
+				else
+				{
+					fmt::println("Unknown draw format: {:s}", name);
+					PrintUsage(argv[0]);
+					return false;
+				}
+			}
+			else if (arg == "--present-mode" && has_value)
+			{
+				std::string_view name = argv[++i];
+				if (name == "fifo")
+				{
+					config.present_mode = PresentMode::PRESENT_FIFO;
+				}
+				else if (name == "mailbox")
+				{
+					config.present_mode = PresentMode::PRESENT_MAILBOX;
+				}
+				else if (name == "immediate")
+				{
+					config.present_mode = PresentMode::PRESENT_IMMEDIATE;
+				}
+				else
+				{
+					fmt::println("Unknown present mode: {:s}", name);
+					PrintUsage(argv[0]);
+					return false;
+				}
+			}
+			else if (arg == "--blit-present")
+			{
+				config.compute_present = false;
+			}
+			else if (arg == "--sharpness" && has_value)
+			{
+				config.present_sharpness = std::clamp(std::strtof(argv[++i], nullptr), 0.0f, 1.0f);
+			}
+			else if (arg == "--tonemap" && has_value)
+			{
+				std::string_view name = argv[++i];
+				if (name == "aces")
+				{
+					config.tonemapper = Tonemapper::TONEMAPPER_ACES;
+				}
+				else if (name == "agx")
+				{
+					config.tonemapper = Tonemapper::TONEMAPPER_AGX;
+				}
+				else
+				{
+					fmt::println("Unknown tonemapper: {:s}", name);
+					PrintUsage(argv[0]);
+					return false;
+				}
+			}
+			else if (arg == "--bloom" && has_value)
+			{
+				config.bloom_intensity = std::max(std::strtof(argv[++i], nullptr), 0.0f);
+			}
+			else if (arg == "--bloom-threshold" && has_value)
+			{
+				config.bloom_threshold = std::max(std::strtof(argv[++i], nullptr), 0.0f);
+			}
+			else if (arg == "--no-command-cache")
+			{
+				config.command_cache = false;
+			}
+			else if (arg == "--capture" && has_value)
+			{
+				config.capture_dir = argv[++i];
+			}
+			else if (arg == "--capture-format" && has_value)
+			{
+				std::string_view name = argv[++i];
+				if (name == "ppm")
+				{
+					config.capture_format = CaptureFormat::CAPTURE_PPM;
+				}
+				else if (name == "png")
+				{
+					config.capture_format = CaptureFormat::CAPTURE_PNG;
+				}
+				else
+				{
+					fmt::println("Unknown capture format: {:s}", name);
+					PrintUsage(argv[0]);
+					return false;
+				}
+			}
+			else if (arg == "--golden" && has_value)
+			{
+				config.golden_dir = argv[++i];
+			}
+			else if (arg == "--golden-tolerance" && has_value)
+			{
+				config.golden_tolerance = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--low-latency")
+			{
+				config.low_latency = true;
+			}
+			else if (arg == "--fps-limit" && has_value)
+			{
+				config.target_fps = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--gpu-pacing")
+			{
+				config.gpu_pacing = true;
+			}
+			else if (arg == "--stats" && has_value)
+			{
+				config.stats_interval = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--audio" && has_value)
+			{
+				std::string_view name = argv[++i];
+				if (name == "off")
+				{
+					config.audio_backend = AudioBackend::AUDIO_OFF;
+				}
+				else if (name == "null")
+				{
+					config.audio_backend = AudioBackend::AUDIO_NULL;
+				}
+				else if (name == "wav")
+				{
+					config.audio_backend = AudioBackend::AUDIO_WAV;
+				}
+				else
+				{
+					fmt::println("Unknown audio backend: {:s}", name);
+					PrintUsage(argv[0]);
+					return false;
+				}
+			}
+			else if (arg == "--audio-wav" && has_value)
+			{
+				config.audio_backend = AudioBackend::AUDIO_WAV;
+				config.audio_wav_path = argv[++i];
+			}
+			else if (arg == "--audio-voices" && has_value)
+			{
+				config.audio_voices = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--audio-bench")
+			{
+				config.audio_bench = true;
+			}
+			else if (arg == "--serial-init")
+			{
+				config.serial_init = true;
+			}
+			else if (arg == "--headless")
+			{
+				config.headless = true;
+			}
+			else if (arg == "--frames" && has_value)
+			{
+				config.frame_limit = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--pack" && has_value)
+			{
+				config.pack_path = argv[++i];
+			}
+			else if (arg == "--level" && has_value)
+			{
+				config.level_name = argv[++i];
+			}
+			else if (arg == "--verify-pack")
+			{
+				config.verify_pack = true;
+			}
+			else if (arg == "--shader-dir" && has_value)
+			{
+				config.shader_dir = argv[++i];
+			}
+			else if (arg == "--tuning" && has_value)
+			{
+				config.tuning_path = argv[++i];
+			}
+			else if (arg == "--no-tuning")
+			{
+				config.tuning_path.clear();
+			}
+			else if (arg == "--autotune")
+			{
+				config.autotune = true;
+			}
+			else if (arg == "--shadow-map" && has_value)
+			{
+				config.shadow_map_size = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--depth-prepass")
+			{
+				config.depth_prepass = true;
+			}
+			else if (arg == "--particles" && has_value)
+			{
+				config.particle_capacity = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--particle-bench")
+			{
+				config.particle_bench = true;
+			}
+			else if (arg == "--perf-suite" && has_value)
+			{
+				config.perf_output = argv[++i];
+			}
+			else if (arg == "--perf-baseline" && has_value)
+			{
+				config.perf_baseline = argv[++i];
+			}
+			else if (arg == "--perf-tolerance" && has_value)
+			{
+				config.perf_tolerance = std::max(std::strtod(argv[++i], nullptr), 0.0);
+			}
+			else if (arg == "--perf-update-baseline")
+			{
+				config.perf_update_baseline = true;
+			}
+			else if (arg == "--seed" && has_value)
+			{
+				config.seed = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--record" && has_value)
+			{
+				config.record_path = argv[++i];
+			}
+			else if (arg == "--replay" && has_value)
+			{
+				config.replay_path = argv[++i];
+			}
+			else if (arg == "--replay-sim-only")
+			{
+				config.replay_sim_only = true;
+			}
+			else
+			{
+				fmt::println("Unknown or incomplete option: {:s}", arg);
+				PrintUsage(argv[0]);
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// Curve mapping the HDR draw image to the display, specialized into the present kernel (PRESENT_FEATURE_AGX)
+	enum class Tonemapper : uint32_t
+	{
+		TONEMAPPER_ACES,
+		TONEMAPPER_AGX
+	};
+
+	// Format of the offscreen draw image every pass renders into before presenting
+	enum class DrawFormat : uint32_t
+	{
+		// 8 bytes per pixel, HDR with alpha
+		DRAW_FORMAT_RGBA16F,
+		// B10G11R11_UFLOAT_PACK32, 4 bytes per pixel, HDR without alpha or negative values
+		DRAW_FORMAT_R11G11B10F,
+		// R8G8B8A8_UNORM, 4 bytes per pixel, clamps to 1 so HDR, bloom and tonemapping are off
+		DRAW_FORMAT_RGBA8
+	};
+
+	// How the swapchain hands finished images to the display
+	enum class PresentMode : uint32_t
+	{
+		// Waits for vertical blank, always supported
+		PRESENT_FIFO,
+		// Waits for vertical blank, newer images replace queued ones instead of blocking
+		PRESENT_MAILBOX,
+		// Never waits, may tear
+		PRESENT_IMMEDIATE
+	};
+
+	// Files captured frames are written as
+	enum class CaptureFormat : uint32_t
+	{
+		// Binary PPM, also what golden images are read as
+		CAPTURE_PPM,
+		// Uncompressed PNG
+		CAPTURE_PNG
+	};
+
+	// Where the mixed audio goes
+	enum class AudioBackend : uint32_t
+	{
+		// No mixer thread at all
+		AUDIO_OFF,
+		// Mixes in real time and throws the result away, for measuring the mixer
+		AUDIO_NULL,
+		// Mixes in real time into a 16 bit stereo WAV file
+		AUDIO_WAV
+	};
+
+	// Runtime options, filled from the command line in main
+	struct EngineConfig
+	{
+		// Memory
+		//  Dump VMA statistics every N frames, 0 turns the dump off
+		uint32_t mem_stats_interval = 0;
+		bool mem_stats_json = false;
+		//  Share of a heap's budget in use before the engine starts giving memory back
+		float budget_pressure_ratio = 0.9f;
+
+		// Presentation
+		//  Falls back to RGBA16F when the device can't use the format for every pass
+		DrawFormat draw_format = DrawFormat::DRAW_FORMAT_RGBA16F;
+		//  Falls back to FIFO when the surface doesn't support the mode
+		PresentMode present_mode = PresentMode::PRESENT_FIFO;
+		//  Write the swapchain from a compute pass instead of blitting when the device allows it
+		bool compute_present = true;
+		//  Sharpening applied by the compute present pass when upscaling, 0 to 1
+		float present_sharpness = 0.5f;
+		Tonemapper tonemapper = Tonemapper::TONEMAPPER_ACES;
+		//  Strength of the bloom added before tonemapping, 0 turns bloom off
+		float bloom_intensity = 0.6f;
+		//  Brightness above which the draw image starts to bloom
+		float bloom_threshold = 1.0f;
+
+		//  Replay the parts of the frame that don't change from cached command buffers instead of recording them every frame
+		bool command_cache = true;
+
+		// Input
+		//  Drain the input queue after the fence wait and image acquire, right before recording,
+		//  instead of at the start of the frame
+		bool low_latency = false;
+
+		// Frame pacing
+		//  Cap on frames per second, 0 leaves the rate to the present mode
+		uint32_t target_fps = 0;
+		//  Hold each frame back until just before the GPU is predicted to finish the previous one,
+		//  from its timestamp queries, so input is sampled as late as the GPU allows
+		bool gpu_pacing = false;
+
+		// Print frame statistics (frame time, jitter and input latency) every N frames, 0 turns them off
+		uint32_t stats_interval = 0;
+
+		// Frame capture
+		//  Copy every frame's draw image back and write it to this directory as frame_NNNNN, empty captures nothing
+		std::string capture_dir;
+		CaptureFormat capture_format = CaptureFormat::CAPTURE_PPM;
+		//  Compare every frame against frame_NNNNN.ppm in this directory, the exit code reports mismatches.
+		//  Meant for headless replays, which render the same frames on every run
+		std::string golden_dir;
+		//  Largest difference per 8 bit channel that still matches
+		uint32_t golden_tolerance = 2;
+
+		// Audio
+		AudioBackend audio_backend = AudioBackend::AUDIO_OFF;
+		std::string audio_wav_path = "audio.wav";
+		//  Sounds playing at once before the quietest one is cut off for a new one, at most MAX_AUDIO_VOICES
+		uint32_t audio_voices = 64;
+		//  Mix a worst case load with every SIMD path the CPU has and exit, the wav backend also writes the result
+		bool audio_bench = false;
+
+		// Run the startup steps one after another on the main thread, for comparing startup timings
+		bool serial_init = false;
+
+		// Render without a window or swapchain, only into the draw image
+		bool headless = false;
+		// Stop after this many frames, 0 runs until the window is closed
+		uint32_t frame_limit = 0;
+
+		// Assets
+		//  Without a pack the engine falls back to the built in level and loose shader files
+		std::string pack_path = "Assets/breakout.ob3pak";
+		std::string level_name = "level0";
+		//  Checksum every blob on startup instead of trusting the table of contents
+		bool verify_pack = false;
+		//  Shaders are embedded in the executable, <name>.spv files in this directory take precedence
+		//  and are picked up again when shaders are reloaded (F5)
+		std::string shader_dir;
+
+		// Compute kernels
+		//  Fastest workgroup shapes per device, kernels missing from it are timed on startup and added.
+		//  Empty keeps the device's default shapes
+		std::string tuning_path = "kernel_tuning.txt";
+		//  Time every kernel again even when the tuning file has it
+		bool autotune = false;
+
+		// Scene
+		//  Resolution of each shadow cascade, 0 turns shadows off
+		uint32_t shadow_map_size = 2048;
+		//  Lay down the scene's depth first so the opaque pass shades every pixel once
+		bool depth_prepass = false;
+
+		// Particles
+		//  Size of each of the two particle pools, 0 turns the particle system off
+		uint32_t particle_capacity = 1 << 16;
+		//  Time the particle passes at PARTICLE_BENCH_COUNTS particles and exit
+		bool particle_bench = false;
+
+		// Performance suite
+		//  Run the fixed headless scenarios and microbenchmarks, write the results to this JSON file and exit
+		std::string perf_output;
+		//  Results to compare against, the suite fails when one got slower than the tolerance allows.
+		//  Without the file nothing is compared
+		std::string perf_baseline;
+		//  Slowdown over the baseline that still passes, 0.15 is 15%. Baseline entries can carry their own
+		double perf_tolerance = 0.15;
+		//  Write the results to the baseline file instead of comparing against it
+		bool perf_update_baseline = false;
+
+		// Simulation
+		//  0 picks a seed from the clock
+		uint64_t seed = 0;
+		//  Write every tick's input and state hash to this file on exit
+		std::string record_path;
+		//  Play a recording back headless at full speed and verify every tick
+		std::string replay_path;
+		//  Skip rendering during replay
+		bool replay_sim_only = false;
+	};
+
+	// Returns false when the arguments could not be parsed, usage has been printed in that case
+	bool ParseEngineConfig(int argc, char** argv, EngineConfig& config);
+}
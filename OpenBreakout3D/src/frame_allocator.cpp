@@ -0,0 +1,86 @@
+#include "frame_allocator.h"
+
+namespace OB3D
+{
+	static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		// alignment is always a power of two (alignof or a Vulkan limit)
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void LinearArena::Init(size_t size)
+	{
+		storage = std::make_unique<std::byte[]>(size);
+		capacity = size;
+		offset = 0;
+		high_water = 0;
+	}
+
+	void* LinearArena::Allocate(size_t size, size_t alignment)
+	{
+		size_t start = AlignUp(offset, alignment);
+		if (start + size > capacity)
+		{
+			fmt::println("Frame CPU arena exhausted: requested {} bytes with {} of {} in use", size, offset, capacity);
+			OB3D_ERROR_OUT("Frame CPU arena out of memory");
+		}
+
+		offset = start + size;
+		high_water = std::max(high_water, offset);
+		return storage.get() + start;
+	}
+
+	void LinearArena::Reset()
+	{
+		offset = 0;
+	}
+
+	void GpuLinearAllocator::Init(const AllocatedBuffer& ring, VkDeviceSize base, VkDeviceSize size, VkDeviceSize alignment)
+	{
+		if (ring.mapped == nullptr)
+		{
+			OB3D_ERROR_OUT("Frame ring buffer must be persistently mapped");
+		}
+
+		buffer = ring.buffer;
+		mapped_base = static_cast<std::byte*>(ring.mapped) + base;
+		base_addr = ring.device_addr + base;
+		base_offset = base;
+		capacity = size;
+		min_alignment = alignment;
+		offset = 0;
+		high_water = 0;
+	}
+
+	GpuAllocation GpuLinearAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		// Every sub allocation respects the device's offset limits so it can be bound as a descriptor too
+		VkDeviceSize start = AlignUp(offset, std::max(alignment, min_alignment));
+		if (start + size > capacity)
+		{
+			fmt::println("Frame GPU ring exhausted: requested {} bytes with {} of {} in use", size, offset, capacity);
+			OB3D_ERROR_OUT("Frame GPU ring out of memory");
+		}
+
+		offset = start + size;
+		high_water = std::max(high_water, offset);
+
+		GpuAllocation allocation = {};
+		allocation.cpu = mapped_base + start;
+		allocation.buffer = buffer;
+		allocation.offset = base_offset + start;
+		allocation.device_addr = base_addr + start;
+		return allocation;
+	}
+
+	void GpuLinearAllocator::Reset()
+	{
+		offset = 0;
+	}
+
+	void FrameAllocator::Reset()
+	{
+		cpu.Reset();
+		gpu.Reset();
+	}
+}
\ No newline at end of file
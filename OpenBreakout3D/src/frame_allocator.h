@@ -0,0 +1,70 @@
+#pragma once
+#include "util.h"
+#include "vk_types.h"
+
+namespace OB3D
+{
+	// Bump allocator over a fixed block of CPU memory
+	// Everything handed out is only valid until the owning frame comes around again
+	struct LinearArena
+	{
+		void Init(size_t size);
+		void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		void Reset();
+
+		template<typename T>
+		std::span<T> AllocateArray(size_t count)
+		{
+			T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			return std::span<T>(data, count);
+		}
+
+		std::unique_ptr<std::byte[]> storage;
+		size_t capacity = 0;
+		size_t offset = 0;
+		size_t high_water = 0;
+	};
+
+	struct GpuAllocation
+	{
+		// Write only, the memory may be uncached device memory
+		void* cpu;
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		VkDeviceAddress device_addr;
+	};
+
+	// Bump allocator over this frame's slice of the persistently mapped frame ring buffer
+	struct GpuLinearAllocator
+	{
+		void Init(const AllocatedBuffer& ring, VkDeviceSize base_offset, VkDeviceSize size, VkDeviceSize min_alignment);
+		GpuAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+		void Reset();
+
+		template<typename T>
+		GpuAllocation Upload(std::span<const T> data)
+		{
+			GpuAllocation allocation = Allocate(data.size_bytes(), alignof(T));
+			memcpy(allocation.cpu, data.data(), data.size_bytes());
+			return allocation;
+		}
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		std::byte* mapped_base = nullptr;
+		VkDeviceAddress base_addr = 0;
+		VkDeviceSize base_offset = 0;
+		VkDeviceSize capacity = 0;
+		VkDeviceSize min_alignment = 1;
+		VkDeviceSize offset = 0;
+		VkDeviceSize high_water = 0;
+	};
+
+	// Per frame transient memory, reset once the frame's fence has been waited on
+	struct FrameAllocator
+	{
+		LinearArena cpu;
+		GpuLinearAllocator gpu;
+
+		void Reset();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,444 @@
+#include "frame_capture.h"
+#include <cstdio>
+#include <filesystem>
+
+namespace OB3D
+{
+	// Entries of the linear to sRGB table, fine enough that neighbouring entries never differ by more than one 8 bit step
+	constexpr uint32_t SRGB_TABLE_SIZE = 4096;
+
+	// Stored deflate blocks hold at most this many bytes
+	constexpr size_t DEFLATE_STORED_BLOCK_SIZE = 65535;
+
+	constexpr std::array<uint32_t, 256> CRC32_TABLE = []()
+	{
+		std::array<uint32_t, 256> table = {};
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+			}
+			table[i] = crc;
+		}
+		return table;
+	}();
+
+	static const std::array<uint8_t, SRGB_TABLE_SIZE>& SrgbTable()
+	{
+		static const std::array<uint8_t, SRGB_TABLE_SIZE> table = []()
+		{
+			std::array<uint8_t, SRGB_TABLE_SIZE> entries = {};
+			for (uint32_t i = 0; i < SRGB_TABLE_SIZE; i++)
+			{
+				float linear = float(i) / float(SRGB_TABLE_SIZE - 1);
+				float encoded = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+				entries[i] = uint8_t(std::lround(encoded * 255.0f));
+			}
+			return entries;
+		}();
+		return table;
+	}
+
+	static uint8_t EncodeSrgb(float linear)
+	{
+		// Negative and NaN end up at 0
+		float clamped = linear > 0.0f ? std::min(linear, 1.0f) : 0.0f;
+		return SrgbTable()[uint32_t(clamped * float(SRGB_TABLE_SIZE - 1) + 0.5f)];
+	}
+
+	static float HalfToFloat(uint16_t half)
+	{
+		uint32_t exponent = (half >> 10) & 0x1F;
+		uint32_t mantissa = half & 0x3FF;
+
+		float value = 0.0f;
+		if (exponent == 0)
+		{
+			value = std::ldexp(float(mantissa), -24);
+		}
+		else if (exponent == 31)
+		{
+			// Infinity saturates, NaN goes black
+			value = mantissa == 0 ? 1.0f : 0.0f;
+		}
+		else
+		{
+			value = std::ldexp(float(mantissa | 0x400), int(exponent) - 25);
+		}
+		return (half & 0x8000) ? -value : value;
+	}
+
+	// The 11 and 10 bit channels of B10G11R11_UFLOAT_PACK32: 5 bit exponent, no sign
+	static float UnsignedSmallFloat(uint32_t bits, int mantissa_bits)
+	{
+		uint32_t exponent = bits >> mantissa_bits;
+		uint32_t mantissa = bits & ((1u << mantissa_bits) - 1);
+
+		if (exponent == 0)
+		{
+			return std::ldexp(float(mantissa), -14 - mantissa_bits);
+		}
+		if (exponent == 31)
+		{
+			return mantissa == 0 ? 1.0f : 0.0f;
+		}
+		return std::ldexp(float(mantissa | (1u << mantissa_bits)), int(exponent) - 15 - mantissa_bits);
+	}
+
+	static void PushU32BigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(uint8_t(value >> 24));
+		out.push_back(uint8_t(value >> 16));
+		out.push_back(uint8_t(value >> 8));
+		out.push_back(uint8_t(value));
+	}
+
+	static void PushPngChunk(std::vector<uint8_t>& out, const char* type, std::span<const uint8_t> data)
+	{
+		PushU32BigEndian(out, uint32_t(data.size()));
+
+		// The CRC covers the type and the data, not the length
+		size_t type_offset = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = type_offset; i < out.size(); i++)
+		{
+			crc = CRC32_TABLE[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+		}
+		PushU32BigEndian(out, crc ^ 0xFFFFFFFFu);
+	}
+
+	static bool WriteFile(const std::string& path, std::span<const uint8_t> data)
+	{
+		FILE* file = std::fopen(path.c_str(), "wb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		bool is_written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+		std::fclose(file);
+		return is_written;
+	}
+
+	namespace Capture
+	{
+		uint32_t BytesPerPixel(VkFormat format)
+		{
+			return format == VK_FORMAT_R16G16B16A16_SFLOAT ? 8 : 4;
+		}
+
+		void ConvertToRgb8(const CapturedFrame& frame, std::vector<uint8_t>& out_rgb)
+		{
+			size_t pixel_count = size_t(frame.width) * frame.height;
+			out_rgb.resize(pixel_count * 3);
+
+			switch (frame.format)
+			{
+				case VK_FORMAT_R16G16B16A16_SFLOAT:
+				{
+					const uint16_t* src = static_cast<const uint16_t*>(frame.pixels);
+					for (size_t i = 0; i < pixel_count; i++)
+					{
+						out_rgb[i * 3 + 0] = EncodeSrgb(HalfToFloat(src[i * 4 + 0]));
+						out_rgb[i * 3 + 1] = EncodeSrgb(HalfToFloat(src[i * 4 + 1]));
+						out_rgb[i * 3 + 2] = EncodeSrgb(HalfToFloat(src[i * 4 + 2]));
+					}
+					break;
+				}
+
+				case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+				{
+					const uint32_t* src = static_cast<const uint32_t*>(frame.pixels);
+					for (size_t i = 0; i < pixel_count; i++)
+					{
+						out_rgb[i * 3 + 0] = EncodeSrgb(UnsignedSmallFloat(src[i] & 0x7FF, 6));
+						out_rgb[i * 3 + 1] = EncodeSrgb(UnsignedSmallFloat((src[i] >> 11) & 0x7FF, 6));
+						out_rgb[i * 3 + 2] = EncodeSrgb(UnsignedSmallFloat(src[i] >> 22, 5));
+					}
+					break;
+				}
+
+				default:
+				{
+					// R8G8B8A8_UNORM, linear like the other formats
+					const uint8_t* src = static_cast<const uint8_t*>(frame.pixels);
+					for (size_t i = 0; i < pixel_count; i++)
+					{
+						out_rgb[i * 3 + 0] = EncodeSrgb(float(src[i * 4 + 0]) / 255.0f);
+						out_rgb[i * 3 + 1] = EncodeSrgb(float(src[i * 4 + 1]) / 255.0f);
+						out_rgb[i * 3 + 2] = EncodeSrgb(float(src[i * 4 + 2]) / 255.0f);
+					}
+					break;
+				}
+			}
+		}
+
+		void EncodePpm(std::span<const uint8_t> rgb, uint32_t width, uint32_t height, std::vector<uint8_t>& out_file)
+		{
+			std::string header = fmt::format("P6\n{} {}\n255\n", width, height);
+			out_file.assign(header.begin(), header.end());
+			out_file.insert(out_file.end(), rgb.begin(), rgb.end());
+		}
+
+		void EncodePng(std::span<const uint8_t> rgb, uint32_t width, uint32_t height, std::vector<uint8_t>& out_file)
+		{
+			constexpr std::array<uint8_t, 8> signature = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			out_file.assign(signature.begin(), signature.end());
+
+			std::vector<uint8_t> header;
+			PushU32BigEndian(header, width);
+			PushU32BigEndian(header, height);
+			// 8 bit depth, truecolor, deflate, adaptive filtering, no interlace
+			header.insert(header.end(), { 8, 2, 0, 0, 0 });
+			PushPngChunk(out_file, "IHDR", header);
+
+			// Every row starts with its filter type, 0 leaves the bytes as they are
+			size_t row_size = size_t(width) * 3;
+			std::vector<uint8_t> scanlines;
+			scanlines.reserve((row_size + 1) * height);
+			for (uint32_t y = 0; y < height; y++)
+			{
+				scanlines.push_back(0);
+				scanlines.insert(scanlines.end(), rgb.begin() + y * row_size, rgb.begin() + (y + 1) * row_size);
+			}
+
+			// zlib stream: header without a preset dictionary, stored blocks, Adler-32 of the scanlines
+			std::vector<uint8_t> zlib = { 0x78, 0x01 };
+			zlib.reserve(scanlines.size() + scanlines.size() / DEFLATE_STORED_BLOCK_SIZE * 5 + 16);
+			size_t offset = 0;
+			do
+			{
+				size_t block_size = std::min(scanlines.size() - offset, DEFLATE_STORED_BLOCK_SIZE);
+				bool is_last = offset + block_size == scanlines.size();
+				zlib.push_back(is_last ? 1 : 0);
+				zlib.push_back(uint8_t(block_size));
+				zlib.push_back(uint8_t(block_size >> 8));
+				zlib.push_back(uint8_t(~block_size));
+				zlib.push_back(uint8_t(~block_size >> 8));
+				zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+				offset += block_size;
+			} while (offset < scanlines.size());
+
+			uint32_t adler_a = 1;
+			uint32_t adler_b = 0;
+			for (uint8_t byte : scanlines)
+			{
+				adler_a = (adler_a + byte) % 65521;
+				adler_b = (adler_b + adler_a) % 65521;
+			}
+			PushU32BigEndian(zlib, adler_b << 16 | adler_a);
+
+			PushPngChunk(out_file, "IDAT", zlib);
+			PushPngChunk(out_file, "IEND", {});
+		}
+
+		bool ReadPpm(const char* path, uint32_t& out_width, uint32_t& out_height, std::vector<uint8_t>& out_rgb)
+		{
+			FILE* file = std::fopen(path, "rb");
+			if (file == nullptr)
+			{
+				return false;
+			}
+
+			// Headers as EncodePpm writes them, a single whitespace separates the header from the pixels
+			uint32_t max_value = 0;
+			bool is_valid = std::fscanf(file, "P6 %u %u %u", &out_width, &out_height, &max_value) == 3
+							&& max_value == 255 && std::fgetc(file) != EOF;
+			if (is_valid)
+			{
+				out_rgb.resize(size_t(out_width) * out_height * 3);
+				is_valid = std::fread(out_rgb.data(), 1, out_rgb.size(), file) == out_rgb.size();
+			}
+
+			std::fclose(file);
+			return is_valid;
+		}
+	}
+
+	void FrameCapture::Start(const EngineConfig& config)
+	{
+		capture_dir = config.capture_dir;
+		capture_format = config.capture_format;
+		golden_dir = config.golden_dir;
+		golden_tolerance = config.golden_tolerance;
+
+		is_active = !capture_dir.empty() || !golden_dir.empty();
+		if (!is_active)
+		{
+			return;
+		}
+
+		if (!capture_dir.empty())
+		{
+			std::error_code error;
+			std::filesystem::create_directories(capture_dir, error);
+		}
+
+		is_stopping = false;
+		worker = std::thread(&FrameCapture::WorkLoop, this);
+	}
+
+	bool FrameCapture::Stop()
+	{
+		if (!is_active)
+		{
+			return true;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			is_stopping = true;
+		}
+		frame_ready.notify_one();
+		worker.join();
+		is_active = false;
+
+		fmt::println("Frame capture: {} written, {} compared, {} differed, {} dropped",
+			written_count, compared_count, mismatch_count, dropped_count);
+
+		// A golden directory without a single matching frame name would otherwise pass without checking anything
+		bool is_golden_checked = golden_dir.empty() || compared_count > 0;
+		if (!is_golden_checked)
+		{
+			fmt::println("No frame had a golden image in {:s}", golden_dir);
+		}
+		// Plain captures drop frames rather than stall by design, only a golden run has to see all of them
+		bool is_complete = !IsComparing() || dropped_count == 0;
+		return mismatch_count == 0 && is_complete && is_golden_checked;
+	}
+
+	bool FrameCapture::IsSlotFree(uint32_t slot_idx) const
+	{
+		return !is_slot_busy[slot_idx].load(std::memory_order_acquire);
+	}
+
+	void FrameCapture::WaitForSlot(uint32_t slot_mask)
+	{
+		std::unique_lock lock(mutex);
+		slot_released.wait(lock, [this, slot_mask]()
+		{
+			for (uint32_t slot_idx = 0; slot_idx < CAPTURE_RING_SIZE; slot_idx++)
+			{
+				if ((slot_mask & (1u << slot_idx)) && IsSlotFree(slot_idx))
+				{
+					return true;
+				}
+			}
+			return false;
+		});
+	}
+
+	void FrameCapture::Submit(const CapturedFrame& frame)
+	{
+		is_slot_busy[frame.slot_idx].store(true, std::memory_order_relaxed);
+		{
+			std::lock_guard lock(mutex);
+			pending_frames.push_back(frame);
+		}
+		frame_ready.notify_one();
+	}
+
+	void FrameCapture::WorkLoop()
+	{
+		while (true)
+		{
+			CapturedFrame frame = {};
+			{
+				std::unique_lock lock(mutex);
+				frame_ready.wait(lock, [this]() { return is_stopping || !pending_frames.empty(); });
+				// Everything handed over before Stop() is still written
+				if (pending_frames.empty())
+				{
+					return;
+				}
+				frame = pending_frames.front();
+				pending_frames.pop_front();
+			}
+
+			Process(frame);
+		}
+	}
+
+	void FrameCapture::Process(const CapturedFrame& frame)
+	{
+		Capture::ConvertToRgb8(frame, rgb_pixels);
+		// The copy has been read, the render loop can reuse the slot while the file is written
+		is_slot_busy[frame.slot_idx].store(false, std::memory_order_release);
+		{
+			// Taken so the release can't slip in between WaitForSlot checking the slots and going to sleep
+			std::lock_guard lock(mutex);
+		}
+		slot_released.notify_one();
+
+		std::string name = fmt::format("frame_{:05}", frame.frame_idx);
+
+		if (!capture_dir.empty())
+		{
+			bool is_png = capture_format == CaptureFormat::CAPTURE_PNG;
+			if (is_png)
+			{
+				Capture::EncodePng(rgb_pixels, frame.width, frame.height, encoded);
+			}
+			else
+			{
+				Capture::EncodePpm(rgb_pixels, frame.width, frame.height, encoded);
+			}
+
+			std::string path = fmt::format("{:s}/{:s}.{:s}", capture_dir, name, is_png ? "png" : "ppm");
+			if (WriteFile(path, encoded))
+			{
+				written_count++;
+			}
+			else
+			{
+				fmt::println("Failed to write captured frame {:s}", path);
+			}
+		}
+
+		if (!golden_dir.empty())
+		{
+			// Frames without a golden image aren't part of the check
+			std::string path = fmt::format("{:s}/{:s}.ppm", golden_dir, name);
+			uint32_t golden_width = 0;
+			uint32_t golden_height = 0;
+			if (!Capture::ReadPpm(path.c_str(), golden_width, golden_height, golden_pixels))
+			{
+				return;
+			}
+
+			compared_count++;
+			if (golden_width != frame.width || golden_height != frame.height)
+			{
+				fmt::println("Frame {} is {}x{}, golden image {:s} is {}x{}", frame.frame_idx, frame.width, frame.height, path, golden_width, golden_height);
+				mismatch_count++;
+				return;
+			}
+
+			// Drivers round differently, small differences per channel are expected
+			uint32_t differing_pixels = 0;
+			uint32_t max_difference = 0;
+			for (size_t i = 0; i < rgb_pixels.size(); i += 3)
+			{
+				uint32_t pixel_difference = 0;
+				for (size_t channel = 0; channel < 3; channel++)
+				{
+					pixel_difference = std::max(pixel_difference, uint32_t(std::abs(int(rgb_pixels[i + channel]) - int(golden_pixels[i + channel]))));
+				}
+				differing_pixels += pixel_difference > golden_tolerance ? 1 : 0;
+				max_difference = std::max(max_difference, pixel_difference);
+			}
+
+			if (differing_pixels > 0)
+			{
+				fmt::println("Frame {} differs from {:s}: {} pixels off by more than {}, largest difference {}",
+					frame.frame_idx, path, differing_pixels, golden_tolerance, max_difference);
+				mismatch_count++;
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "util.h"
+#include "engine_config.h"
+
+namespace OB3D
+{
+	// Host buffers the draw image is copied into, FRAME_OVERLAP of them are waiting on the GPU at most
+	// and the rest give the worker time to write a frame before the render loop runs out of them
+	constexpr uint32_t CAPTURE_RING_SIZE = 4;
+
+	// Largest per channel difference to a golden frame that still counts as a match when none is configured
+	constexpr uint32_t DEFAULT_GOLDEN_TOLERANCE = 2;
+
+	// One draw image copy ready to be read by the worker
+	struct CapturedFrame
+	{
+		// Mapped buffer of ring slot slot_idx, tightly packed rows
+		const void* pixels;
+		uint32_t slot_idx;
+		uint32_t frame_idx;
+		uint32_t width;
+		uint32_t height;
+		VkFormat format;
+	};
+
+	// Writes or compares the captured frames on its own thread, so neither disk writes nor the
+	// pixel conversion ever hold up the render loop. Ring slots are handed to the worker and
+	// given back once it is done with them, slots are only ever reused after that
+	struct FrameCapture
+	{
+		// Starts the worker, does nothing when the config neither captures nor compares
+		void Start(const EngineConfig& config);
+		// Lets the worker finish every frame handed to it and joins it
+		// Returns false when a frame differed from its golden image, or a golden run dropped a frame or compared nothing
+		bool Stop();
+
+		bool IsActive() const { return is_active; }
+		// Golden runs have to see every frame, the render loop waits for slots instead of dropping frames
+		bool IsComparing() const { return !golden_dir.empty(); }
+		bool IsSlotFree(uint32_t slot_idx) const;
+		// Render thread, blocks until the worker has given back one of the slots in slot_mask
+		void WaitForSlot(uint32_t slot_mask);
+		// Render thread, the slot belongs to the worker until it has been written
+		void Submit(const CapturedFrame& frame);
+
+		// Frames the render loop had to skip because every slot was taken
+		uint32_t dropped_count = 0;
+
+	private:
+		void WorkLoop();
+		void Process(const CapturedFrame& frame);
+
+		bool is_active = false;
+		std::string capture_dir;
+		CaptureFormat capture_format = CaptureFormat::CAPTURE_PPM;
+		std::string golden_dir;
+		uint32_t golden_tolerance = DEFAULT_GOLDEN_TOLERANCE;
+
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable frame_ready;
+		std::condition_variable slot_released;
+		std::deque<CapturedFrame> pending_frames;
+		bool is_stopping = false;
+		std::array<std::atomic<bool>, CAPTURE_RING_SIZE> is_slot_busy = {};
+
+		// Only touched by the worker
+		std::vector<uint8_t> rgb_pixels;
+		std::vector<uint8_t> golden_pixels;
+		std::vector<uint8_t> encoded;
+		uint32_t written_count = 0;
+		uint32_t compared_count = 0;
+		uint32_t mismatch_count = 0;
+	};
+
+	namespace Capture
+	{
+		// Draw image formats the worker can convert, R16G16B16A16_SFLOAT, B10G11R11_UFLOAT_PACK32 and R8G8B8A8_UNORM
+		uint32_t BytesPerPixel(VkFormat format);
+		// Linear draw image values to 8 bit sRGB, 3 bytes per pixel. HDR values are clamped, not tonemapped
+		void ConvertToRgb8(const CapturedFrame& frame, std::vector<uint8_t>& out_rgb);
+
+		// Binary PPM (P6), what golden images are stored as
+		void EncodePpm(std::span<const uint8_t> rgb, uint32_t width, uint32_t height, std::vector<uint8_t>& out_file);
+		// 8 bit RGB PNG. Without zlib in the tree the image data goes into stored deflate blocks, uncompressed
+		void EncodePng(std::span<const uint8_t> rgb, uint32_t width, uint32_t height, std::vector<uint8_t>& out_file);
+		// False when the file is missing or isn't an 8 bit binary PPM
+		bool ReadPpm(const char* path, uint32_t& out_width, uint32_t& out_height, std::vector<uint8_t>& out_rgb);
+	}
+}
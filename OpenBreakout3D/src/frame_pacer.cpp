@@ -0,0 +1,95 @@
+#include "frame_pacer.h"
+#include "input.h"
+
+namespace OB3D
+{
+	// Bounds of the sleep slack, the upper one covers a coarse 1 ms scheduler tick with room to spare
+	constexpr int64_t MIN_SLEEP_SLACK_NS = 200000;
+	constexpr int64_t MAX_SLEEP_SLACK_NS = 4000000;
+	constexpr int64_t INITIAL_SLEEP_SLACK_NS = 1000000;
+	// Taken off the slack after every sleep that didn't overshoot it, one outlier doesn't keep the loop spinning
+	constexpr int64_t SLEEP_SLACK_DECAY_NS = 10000;
+
+	// Frames are submitted this much before the predicted GPU completion, so the GPU never runs dry
+	constexpr int64_t GPU_PACING_MARGIN_NS = 500000;
+	// A prediction further out than this is a stale or bogus timestamp, not worth stalling on
+	constexpr int64_t MAX_PACING_WAIT_NS = 100000000;
+	// Weight of the newest frame in the CPU frame time estimate
+	constexpr double CPU_FRAME_SMOOTHING = 0.1;
+
+	void FramePacer::Init(uint32_t target_fps, bool gpu_pacing)
+	{
+		*this = FramePacer();
+		period_ns = target_fps == 0 ? 0 : 1000000000 / int64_t(target_fps);
+		is_gpu_paced = gpu_pacing;
+		sleep_slack_ns = INITIAL_SLEEP_SLACK_NS;
+	}
+
+	int64_t FramePacer::WaitForNextFrame()
+	{
+		int64_t now_ns = Input::NowNs();
+		if (!IsActive())
+		{
+			frame_start_ns = now_ns;
+			return now_ns;
+		}
+
+		int64_t deadline_ns = period_ns != 0 ? next_start_ns : 0;
+		if (is_gpu_paced && gpu_free_ns != 0)
+		{
+			// Recording and submitting should end right as the GPU gets to the new frame
+			int64_t gpu_start_ns = gpu_free_ns - int64_t(cpu_frame_ns) - GPU_PACING_MARGIN_NS;
+			deadline_ns = std::max(deadline_ns, std::min(gpu_start_ns, now_ns + MAX_PACING_WAIT_NS));
+		}
+
+		WaitUntil(deadline_ns);
+		frame_start_ns = Input::NowNs();
+
+		if (period_ns != 0)
+		{
+			// A frame that starts more than a period late restarts the cadence instead of rushing the next ones
+			bool is_behind = frame_start_ns - next_start_ns > period_ns;
+			next_start_ns = (is_behind ? frame_start_ns : next_start_ns) + period_ns;
+		}
+		return frame_start_ns;
+	}
+
+	void FramePacer::EndFrame(int64_t end_ns, double gpu_frame_ms)
+	{
+		if (!is_gpu_paced)
+		{
+			return;
+		}
+
+		double frame_ns = double(end_ns - frame_start_ns);
+		cpu_frame_ns = cpu_frame_ns == 0.0 ? frame_ns : cpu_frame_ns + (frame_ns - cpu_frame_ns) * CPU_FRAME_SMOOTHING;
+
+		// The GPU starts on this frame once it is done with the earlier ones. With FIFO it also waits for
+		// the swapchain image, which the timestamps don't see, so the prediction errs on the early side
+		if (gpu_frame_ms > 0.0)
+		{
+			gpu_free_ns = std::max(gpu_free_ns, end_ns) + int64_t(gpu_frame_ms * 1e6);
+		}
+	}
+
+	void FramePacer::WaitUntil(int64_t deadline_ns)
+	{
+		int64_t now_ns = Input::NowNs();
+		while (deadline_ns - now_ns > sleep_slack_ns)
+		{
+			int64_t sleep_ns = deadline_ns - now_ns - sleep_slack_ns;
+			std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
+
+			int64_t woke_ns = Input::NowNs();
+			int64_t overshoot_ns = woke_ns - (now_ns + sleep_ns);
+			sleep_slack_ns = std::clamp(std::max(overshoot_ns, sleep_slack_ns - SLEEP_SLACK_DECAY_NS), MIN_SLEEP_SLACK_NS, MAX_SLEEP_SLACK_NS);
+			now_ns = woke_ns;
+		}
+
+		// What's left is shorter than the OS sleeps reliably
+		while (Input::NowNs() < deadline_ns)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// Decides when the render loop may start its next frame. Caps the frame rate, and with GPU pacing
+	// holds the frame back until just before the GPU is predicted to finish the work already queued,
+	// so the frame samples its input as late as possible without leaving the GPU idle
+	struct FramePacer
+	{
+		// 0 fps leaves the rate uncapped, the pacer does nothing when neither is set
+		void Init(uint32_t target_fps, bool gpu_pacing);
+
+		// Blocks until the next frame may start, returns its start time in steady_clock nanoseconds
+		int64_t WaitForNextFrame();
+		// After the frame was submitted and presented. gpu_frame_ms is the latest measured GPU time
+		// of a whole frame, 0 when there is none yet
+		void EndFrame(int64_t end_ns, double gpu_frame_ms);
+
+		// Sleeps most of the way to the deadline and spins the rest, sleeping alone overshoots by up to a scheduler tick
+		void WaitUntil(int64_t deadline_ns);
+
+		bool IsActive() const { return period_ns != 0 || is_gpu_paced; }
+
+	private:
+		int64_t period_ns = 0;
+		bool is_gpu_paced = false;
+
+		// Start the frame rate cap aims for, keeps a steady cadence when frames start a little late
+		int64_t next_start_ns = 0;
+		int64_t frame_start_ns = 0;
+		// When the GPU is predicted to be done with everything submitted so far
+		int64_t gpu_free_ns = 0;
+		// Smoothed time from a frame's start to its submit
+		double cpu_frame_ns = 0.0;
+		// How much earlier than the deadline sleeping stops, grows with every oversleep and slowly shrinks back
+		int64_t sleep_slack_ns = 0;
+	};
+}
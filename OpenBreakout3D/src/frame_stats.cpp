@@ -0,0 +1,51 @@
+#include "frame_stats.h"
+
+namespace OB3D
+{
+	void FrameStats::AddFrameTime(int64_t frame_ns)
+	{
+		double frame_ms = double(frame_ns) / 1e6;
+
+		frame_min_ms = frame_samples == 0 ? frame_ms : std::min(frame_min_ms, frame_ms);
+		frame_max_ms = std::max(frame_max_ms, frame_ms);
+		frame_sum_ms += frame_ms;
+		frame_sum_sq_ms += frame_ms * frame_ms;
+		frame_samples++;
+	}
+
+	void FrameStats::AddInputLatency(int64_t latency_ns)
+	{
+		double latency_ms = double(latency_ns) / 1e6;
+
+		latency_min_ms = latency_samples == 0 ? latency_ms : std::min(latency_min_ms, latency_ms);
+		latency_max_ms = std::max(latency_max_ms, latency_ms);
+		latency_sum_ms += latency_ms;
+		latency_samples++;
+	}
+
+	void FrameStats::Print(int frame) const
+	{
+		fmt::println("---- Frame stats (frame {}) ----", frame);
+		if (frame_samples != 0)
+		{
+			double avg_ms = frame_sum_ms / frame_samples;
+			double jitter_ms = std::sqrt(std::max(frame_sum_sq_ms / frame_samples - avg_ms * avg_ms, 0.0));
+			fmt::println("Frame time: avg {:.2f} ms, min {:.2f} ms, max {:.2f} ms, jitter {:.3f} ms over {} frames",
+				avg_ms, frame_min_ms, frame_max_ms, jitter_ms, frame_samples);
+		}
+
+		if (latency_samples == 0)
+		{
+			fmt::println("Input to present: no input");
+			return;
+		}
+
+		fmt::println("Input to present: avg {:.2f} ms, min {:.2f} ms, max {:.2f} ms over {} events",
+			latency_sum_ms / latency_samples, latency_min_ms, latency_max_ms, latency_samples);
+	}
+
+	void FrameStats::Reset()
+	{
+		*this = FrameStats();
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// Rolling per interval statistics of the render loop, printed and reset every stats interval
+	struct FrameStats
+	{
+		// Time between the presents of consecutive frames, jitter is its standard deviation
+		uint32_t frame_samples = 0;
+		double frame_sum_ms = 0.0;
+		double frame_sum_sq_ms = 0.0;
+		double frame_min_ms = 0.0;
+		double frame_max_ms = 0.0;
+
+		// Time from GLFW delivering an input event to vkQueuePresentKHR of the first frame that used it
+		uint32_t latency_samples = 0;
+		double latency_sum_ms = 0.0;
+		double latency_min_ms = 0.0;
+		double latency_max_ms = 0.0;
+
+		void AddFrameTime(int64_t frame_ns);
+		void AddInputLatency(int64_t latency_ns);
+		void Print(int frame) const;
+		void Reset();
+	};
+}
@@ -0,0 +1,165 @@
+#include "gpu_timer.h"
+
+namespace OB3D
+{
+	void GpuTimer::Init(VkDevice vk_device, VkPhysicalDevice physical, uint32_t queue_family_idx,
+						std::span<const std::string_view> scope_names, uint32_t frame_count)
+	{
+		if (scope_names.size() > 64)
+		{
+			OB3D_ERROR_OUT("GpuTimer tracks at most 64 scopes");
+		}
+
+		uint32_t family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physical, &family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(physical, &family_count, families.data());
+
+		uint32_t valid_bits = queue_family_idx < family_count ? families[queue_family_idx].timestampValidBits : 0;
+		if (valid_bits == 0)
+		{
+			OB3D_LOG("Queue family {} has no timestamps, GPU timings are off", queue_family_idx);
+			return;
+		}
+
+		VkPhysicalDeviceProperties device_props = {};
+		vkGetPhysicalDeviceProperties(physical, &device_props);
+
+		device = vk_device;
+		scope_count = uint32_t(scope_names.size());
+		ns_per_tick = double(device_props.limits.timestampPeriod);
+		valid_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+		written_scopes.assign(frame_count, 0);
+
+		stats.clear();
+		for (std::string_view name : scope_names)
+		{
+			GpuScopeStats scope_stats = {};
+			scope_stats.name = name;
+			stats.push_back(scope_stats);
+		}
+
+		VkQueryPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		pool_info.pNext = nullptr;
+		pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		// A begin and an end timestamp per scope
+		pool_info.queryCount = scope_count * 2 * frame_count;
+
+		VkResult result = vkCreateQueryPool(device, &pool_info, nullptr, &query_pool);
+		OB3D_VK_CHECK(result, "Failed to create timestamp query pool");
+
+		is_supported = true;
+	}
+
+	void GpuTimer::Push(DestroyerQueue& queue)
+	{
+		if (!is_supported)
+		{
+			return;
+		}
+
+		Destroyable dstr_pool = {};
+		dstr_pool.query_pool = query_pool;
+		dstr_pool.type = DestroyableVkType::DESTROYABLE_QUERY_POOL;
+		queue.Push(dstr_pool);
+	}
+
+	uint32_t GpuTimer::QueryIndex(uint32_t frame_slot, uint32_t scope) const
+	{
+		return (frame_slot * scope_count + scope) * 2;
+	}
+
+	void GpuTimer::BeginFrame(VkCommandBuffer cmd, uint32_t frame_slot)
+	{
+		if (!is_supported)
+		{
+			return;
+		}
+
+		for (uint32_t scope = 0; scope < scope_count; scope++)
+		{
+			if ((written_scopes[frame_slot] & (1ull << scope)) == 0)
+			{
+				continue;
+			}
+
+			// The slot's fence has been waited on, the results are already there
+			std::array<uint64_t, 2> timestamps = {};
+			VkResult result = vkGetQueryPoolResults(device, query_pool, QueryIndex(frame_slot, scope), 2,
+													sizeof(timestamps), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+			if (result != VK_SUCCESS)
+			{
+				continue;
+			}
+
+			double elapsed_ms = double((timestamps[1] - timestamps[0]) & valid_mask) * ns_per_tick / 1e6;
+			GpuScopeStats& scope_stats = stats[scope];
+			scope_stats.min_ms = scope_stats.samples == 0 ? elapsed_ms : std::min(scope_stats.min_ms, elapsed_ms);
+			scope_stats.max_ms = std::max(scope_stats.max_ms, elapsed_ms);
+			scope_stats.sum_ms += elapsed_ms;
+			scope_stats.last_ms = elapsed_ms;
+			scope_stats.samples++;
+		}
+
+		written_scopes[frame_slot] = 0;
+		vkCmdResetQueryPool(cmd, query_pool, QueryIndex(frame_slot, 0), scope_count * 2);
+	}
+
+	void GpuTimer::Begin(VkCommandBuffer cmd, uint32_t frame_slot, uint32_t scope)
+	{
+		if (!is_supported || is_suspended)
+		{
+			return;
+		}
+
+		// ALL_COMMANDS on both ends, the scope starts once earlier work has drained
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, query_pool, QueryIndex(frame_slot, scope));
+	}
+
+	void GpuTimer::End(VkCommandBuffer cmd, uint32_t frame_slot, uint32_t scope)
+	{
+		if (!is_supported || is_suspended)
+		{
+			return;
+		}
+
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, query_pool, QueryIndex(frame_slot, scope) + 1);
+		written_scopes[frame_slot] |= 1ull << scope;
+	}
+
+	void GpuTimer::MarkWritten(uint32_t frame_slot, uint64_t scope_mask)
+	{
+		if (!is_supported || is_suspended)
+		{
+			return;
+		}
+
+		written_scopes[frame_slot] |= scope_mask;
+	}
+
+	void GpuTimer::Print() const
+	{
+		for (const GpuScopeStats& scope_stats : stats)
+		{
+			if (scope_stats.samples == 0)
+			{
+				continue;
+			}
+
+			fmt::println("GPU {:<18s} avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms",
+				scope_stats.name, scope_stats.AverageMs(), scope_stats.min_ms, scope_stats.max_ms);
+		}
+	}
+
+	void GpuTimer::ResetStats()
+	{
+		for (GpuScopeStats& scope_stats : stats)
+		{
+			scope_stats.samples = 0;
+			scope_stats.sum_ms = 0.0;
+			scope_stats.min_ms = 0.0;
+			scope_stats.max_ms = 0.0;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "util.h"
+#include "destroyer_queue.h"
+
+namespace OB3D
+{
+	// Running statistics of one timed scope, in milliseconds
+	struct GpuScopeStats
+	{
+		std::string_view name;
+		uint32_t samples = 0;
+		double sum_ms = 0.0;
+		double min_ms = 0.0;
+		double max_ms = 0.0;
+		// Newest result, kept across ResetStats
+		double last_ms = 0.0;
+
+		double AverageMs() const { return samples == 0 ? 0.0 : sum_ms / samples; }
+	};
+
+	// Timestamp queries around fixed scopes of a frame, one set of queries per frame in flight
+	// A slot's results are collected once its fence has been waited on so reading never stalls
+	struct GpuTimer
+	{
+		// Does nothing when the queue family can't write timestamps, every other call is a no-op then
+		void Init(VkDevice device, VkPhysicalDevice physical, uint32_t queue_family_idx,
+				  std::span<const std::string_view> scope_names, uint32_t frame_count);
+		void Push(DestroyerQueue& queue);
+
+		// Reads the slot's previous results into the statistics and resets its queries
+		void BeginFrame(VkCommandBuffer cmd, uint32_t frame_slot);
+		void Begin(VkCommandBuffer cmd, uint32_t frame_slot, uint32_t scope);
+		void End(VkCommandBuffer cmd, uint32_t frame_slot, uint32_t scope);
+		// For scopes recorded into a command buffer that is replayed, End only runs when it is recorded
+		void MarkWritten(uint32_t frame_slot, uint64_t scope_mask);
+
+		void Print() const;
+		void ResetStats();
+
+		std::vector<GpuScopeStats> stats;
+		bool is_supported = false;
+		// Begin, End and MarkWritten do nothing while set, for recordings that are never submitted
+		bool is_suspended = false;
+
+	private:
+		uint32_t QueryIndex(uint32_t frame_slot, uint32_t scope) const;
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkQueryPool query_pool = VK_NULL_HANDLE;
+		uint32_t scope_count = 0;
+		double ns_per_tick = 1.0;
+		uint64_t valid_mask = ~0ull;
+		// Scopes that were closed in each slot's last recording, bit per scope
+		std::vector<uint64_t> written_scopes;
+	};
+}
@@ -0,0 +1,108 @@
+#include "input.h"
+#include <chrono>
+#include <GLFW/glfw3.h>
+
+namespace OB3D
+{
+	float InputState::PaddleAxis() const
+	{
+		return (right_held ? 1.0f : 0.0f) - (left_held ? 1.0f : 0.0f);
+	}
+
+	void InputState::Apply(const InputEvent& event)
+	{
+		switch (event.action)
+		{
+			case InputAction::INPUT_PADDLE_LEFT:
+			{
+				left_held = event.is_pressed;
+				break;
+			}
+
+			case InputAction::INPUT_PADDLE_RIGHT:
+			{
+				right_held = event.is_pressed;
+				break;
+			}
+
+			case InputAction::INPUT_LAUNCH:
+			{
+				// latched until the consumer clears it so a tap between two frames isn't lost
+				launch_pressed |= event.is_pressed;
+				break;
+			}
+
+			case InputAction::INPUT_RELOAD_SHADERS:
+			{
+				reload_shaders_pressed |= event.is_pressed;
+				break;
+			}
+		}
+	}
+
+	namespace Input
+	{
+		static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+		{
+			if (action == GLFW_REPEAT)
+			{
+				return;
+			}
+
+			InputEvent event = {};
+			event.timestamp_ns = NowNs();
+			event.is_pressed = action == GLFW_PRESS;
+
+			switch (key)
+			{
+				case GLFW_KEY_LEFT:
+				case GLFW_KEY_A:
+				{
+					event.action = InputAction::INPUT_PADDLE_LEFT;
+					break;
+				}
+
+				case GLFW_KEY_RIGHT:
+				case GLFW_KEY_D:
+				{
+					event.action = InputAction::INPUT_PADDLE_RIGHT;
+					break;
+				}
+
+				case GLFW_KEY_SPACE:
+				{
+					event.action = InputAction::INPUT_LAUNCH;
+					break;
+				}
+
+				case GLFW_KEY_F5:
+				{
+					event.action = InputAction::INPUT_RELOAD_SHADERS;
+					break;
+				}
+
+				default:
+				{
+					return;
+				}
+			}
+
+			InputQueue* queue = static_cast<InputQueue*>(glfwGetWindowUserPointer(window));
+			if (!queue->TryPush(event))
+			{
+				OB3D_LOG("Input queue full, dropping key event");
+			}
+		}
+
+		int64_t NowNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		void InstallCallbacks(GLFWwindow* window, InputQueue* queue)
+		{
+			glfwSetWindowUserPointer(window, queue);
+			glfwSetKeyCallback(window, KeyCallback);
+		}
+	}
+}
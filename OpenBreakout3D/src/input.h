@@ -0,0 +1,44 @@
+#pragma once
+#include "util.h"
+#include "spsc_queue.h"
+
+namespace OB3D
+{
+	enum class InputAction : uint8_t
+	{
+		INPUT_PADDLE_LEFT,
+		INPUT_PADDLE_RIGHT,
+		INPUT_LAUNCH,
+		INPUT_RELOAD_SHADERS
+	};
+
+	struct InputEvent
+	{
+		// steady clock nanoseconds at the time GLFW delivered the event
+		int64_t timestamp_ns;
+		InputAction action;
+		bool is_pressed;
+	};
+
+	// Written by the GLFW callbacks on the main thread, drained by the render thread
+	using InputQueue = SpscQueue<InputEvent, 1024>;
+
+	struct InputState
+	{
+		bool left_held = false;
+		bool right_held = false;
+		bool launch_pressed = false;
+		bool reload_shaders_pressed = false;
+
+		// -1 to 1, positive moves the paddle right
+		float PaddleAxis() const;
+		void Apply(const InputEvent& event);
+	};
+
+	namespace Input
+	{
+		int64_t NowNs();
+		// Routes key events of the window into the queue, the queue has to outlive the window
+		void InstallCallbacks(struct GLFWwindow* window, InputQueue* queue);
+	}
+}
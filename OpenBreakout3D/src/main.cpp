@@ -2,10 +2,67 @@
 
 int main(int argc, char **argv)
 {
+    OB3D::EngineConfig config;
+    if (!OB3D::ParseEngineConfig(argc, argv, config))
+    {
+        return 1;
+    }
+
     OB3D::RenderEngine engine;
 
-    engine.Init();
-    engine.Run();
+    if (!config.replay_path.empty())
+    {
+        OB3D::ReplayData replay;
+        if (!OB3D::Replay::Load(config.replay_path.c_str(), replay))
+        {
+            return 1;
+        }
+
+        if (config.replay_sim_only)
+        {
+            return OB3D::Replay::RunSimulationOnly(replay);
+        }
+
+        // Replays are a benchmark workload, no window and no vsync
+        config.headless = true;
+        engine.Init(config);
+        int exit_code = engine.RunReplay(replay);
+        engine.Destroy();
+        return exit_code;
+    }
+
+    if (config.audio_bench)
+    {
+        // Only the mixer, nothing else of the engine is started
+        return OB3D::Audio::RunBenchmark(config);
+    }
+
+    if (!config.perf_output.empty())
+    {
+        // Fixed scenarios, no window or vsync, and the device's default workgroup shapes so a tuning run can't move the numbers
+        // The mixer thread would only compete with them, its cost is measured by a microbenchmark
+        config.headless = true;
+        config.audio_backend = OB3D::AudioBackend::AUDIO_OFF;
+        config.tuning_path.clear();
+        config.particle_capacity = std::max(config.particle_capacity, OB3D::PERF_PARTICLE_COUNT);
+        engine.Init(config);
+        int exit_code = engine.RunPerfSuite();
+        engine.Destroy();
+        return exit_code;
+    }
+
+    if (config.particle_bench)
+    {
+        config.headless = true;
+        config.particle_capacity = std::max(config.particle_capacity, OB3D::PARTICLE_BENCH_CAPACITY);
+        engine.Init(config);
+        int exit_code = engine.RunParticleBenchmark();
+        engine.Destroy();
+        return exit_code;
+    }
+
+    engine.Init(config);
+    int exit_code = engine.Run();
     engine.Destroy();
-    return 0;
+    return exit_code;
 }
\ No newline at end of file
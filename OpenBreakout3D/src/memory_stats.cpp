@@ -0,0 +1,123 @@
+#include "memory_stats.h"
+
+namespace OB3D
+{
+	namespace MemoryStats
+	{
+		static float Fragmentation(const VmaDetailedStatistics& stats)
+		{
+			VkDeviceSize unused_bytes = stats.statistics.blockBytes - stats.statistics.allocationBytes;
+			if (unused_bytes == 0 || stats.unusedRangeCount == 0)
+			{
+				return 0.0f;
+			}
+
+			// Share of the free memory that is not part of the largest free range
+			return 1.0f - float(stats.unusedRangeSizeMax) / float(unused_bytes);
+		}
+
+		static double ToMiB(VkDeviceSize bytes)
+		{
+			return double(bytes) / (1024.0 * 1024.0);
+		}
+
+		MemoryReport Calculate(VmaAllocator allocator)
+		{
+			const VkPhysicalDeviceMemoryProperties* memory_props = nullptr;
+			vmaGetMemoryProperties(allocator, &memory_props);
+
+			VmaTotalStatistics total_stats = {};
+			vmaCalculateStatistics(allocator, &total_stats);
+
+			std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+			vmaGetHeapBudgets(allocator, budgets.data());
+
+			MemoryReport report = {};
+			report.heap_count = memory_props->memoryHeapCount;
+
+			for (uint32_t i = 0; i < report.heap_count; i++)
+			{
+				const VmaDetailedStatistics& heap_stats = total_stats.memoryHeap[i];
+
+				HeapReport& heap = report.heaps[i];
+				heap.flags = memory_props->memoryHeaps[i].flags;
+				heap.heap_size = memory_props->memoryHeaps[i].size;
+				heap.usage = budgets[i].usage;
+				heap.budget = budgets[i].budget;
+				heap.block_count = heap_stats.statistics.blockCount;
+				heap.allocation_count = heap_stats.statistics.allocationCount;
+				heap.block_bytes = heap_stats.statistics.blockBytes;
+				heap.allocation_bytes = heap_stats.statistics.allocationBytes;
+				heap.fragmentation = Fragmentation(heap_stats);
+			}
+
+			report.total_allocation_count = total_stats.total.statistics.allocationCount;
+			report.total_allocation_bytes = total_stats.total.statistics.allocationBytes;
+			report.total_block_bytes = total_stats.total.statistics.blockBytes;
+			report.fragmentation = Fragmentation(total_stats.total);
+
+			return report;
+		}
+
+		bool IsOverBudget(VmaAllocator allocator, float pressure_ratio)
+		{
+			const VkPhysicalDeviceMemoryProperties* memory_props = nullptr;
+			vmaGetMemoryProperties(allocator, &memory_props);
+
+			std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets = {};
+			vmaGetHeapBudgets(allocator, budgets.data());
+
+			for (uint32_t i = 0; i < memory_props->memoryHeapCount; i++)
+			{
+				if (budgets[i].budget > 0 && double(budgets[i].usage) > double(budgets[i].budget) * pressure_ratio)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Print(const MemoryReport& report, int frame)
+		{
+			fmt::println("---- Memory (frame {}) ----", frame);
+			for (uint32_t i = 0; i < report.heap_count; i++)
+			{
+				const HeapReport& heap = report.heaps[i];
+				fmt::println("Heap {} ({:s}): {:.1f} / {:.1f} MiB budget, {} allocations in {} blocks ({:.1f} / {:.1f} MiB), fragmentation {:.2f}",
+					i,
+					(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "device" : "host",
+					ToMiB(heap.usage), ToMiB(heap.budget),
+					heap.allocation_count, heap.block_count,
+					ToMiB(heap.allocation_bytes), ToMiB(heap.block_bytes),
+					heap.fragmentation);
+			}
+			fmt::println("Total: {} allocations, {:.1f} / {:.1f} MiB, fragmentation {:.2f}",
+				report.total_allocation_count,
+				ToMiB(report.total_allocation_bytes), ToMiB(report.total_block_bytes),
+				report.fragmentation);
+		}
+
+		void PrintJson(const MemoryReport& report, int frame)
+		{
+			// One object per line so soak test logs can be processed line by line
+			std::string json = fmt::format("{{\"frame\":{},\"heaps\":[", frame);
+			for (uint32_t i = 0; i < report.heap_count; i++)
+			{
+				const HeapReport& heap = report.heaps[i];
+				json += fmt::format("{}{{\"index\":{},\"device_local\":{},\"size\":{},\"usage\":{},\"budget\":{},\"blocks\":{},\"allocations\":{},\"block_bytes\":{},\"allocation_bytes\":{},\"fragmentation\":{:.4f}}}",
+					i == 0 ? "" : ",",
+					i,
+					(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "true" : "false",
+					heap.heap_size, heap.usage, heap.budget,
+					heap.block_count, heap.allocation_count,
+					heap.block_bytes, heap.allocation_bytes,
+					heap.fragmentation);
+			}
+			json += fmt::format("],\"allocations\":{},\"allocation_bytes\":{},\"block_bytes\":{},\"fragmentation\":{:.4f}}}",
+				report.total_allocation_count, report.total_allocation_bytes, report.total_block_bytes, report.fragmentation);
+
+			fmt::println("{:s}", json);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	struct HeapReport
+	{
+		VkMemoryHeapFlags flags;
+		VkDeviceSize heap_size;
+		// From VK_EXT_memory_budget when available, otherwise VMA's own estimate
+		VkDeviceSize usage;
+		VkDeviceSize budget;
+		uint32_t block_count;
+		uint32_t allocation_count;
+		VkDeviceSize block_bytes;
+		VkDeviceSize allocation_bytes;
+		// 0 when all free space in the heap's blocks is one contiguous range, approaches 1 as it splinters
+		float fragmentation;
+	};
+
+	struct MemoryReport
+	{
+		std::array<HeapReport, VK_MAX_MEMORY_HEAPS> heaps;
+		uint32_t heap_count;
+		uint32_t total_allocation_count;
+		VkDeviceSize total_allocation_bytes;
+		VkDeviceSize total_block_bytes;
+		float fragmentation;
+	};
+
+	namespace MemoryStats
+	{
+		// Walks every allocation, keep this to periodic dumps
+		MemoryReport Calculate(VmaAllocator allocator);
+		// Cheap enough to call every frame
+		bool IsOverBudget(VmaAllocator allocator, float pressure_ratio);
+
+		void Print(const MemoryReport& report, int frame);
+		void PrintJson(const MemoryReport& report, int frame);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "particle_system.h"
+#include "scene_renderer.h"
+
+namespace OB3D
+{
+	// Units are world units and seconds
+	constexpr uint32_t BRICK_BREAK_PARTICLES = 384;
+	constexpr uint32_t BRICK_HIT_PARTICLES = 64;
+	constexpr uint32_t PADDLE_HIT_PARTICLES = 24;
+
+	void ParticleEmitterQueue::Add(glm::vec2 pos, uint32_t count, float speed, float life, float size, glm::vec4 color)
+	{
+		if (emitters.size() >= MAX_PARTICLE_EMITTERS || count == 0)
+		{
+			return;
+		}
+
+		GpuParticleEmitter emitter = {};
+		emitter.pos = pos;
+		emitter.speed = speed;
+		emitter.life = life;
+		emitter.color = color;
+		emitter.first = particle_count;
+		emitter.count = count;
+		// Golden ratio steps keep neighbouring bursts from repeating each other's pattern
+		emitter.seed = next_seed * 0x9E3779B9u;
+		emitter.size = size;
+		emitters.push_back(emitter);
+
+		next_seed++;
+		particle_count += count;
+	}
+
+	void ParticleEmitterQueue::AddSimEvents(const World& world)
+	{
+		for (uint32_t i = 0; i < world.event_count; i++)
+		{
+			const SimEvent& event = world.events[i];
+			switch (event.type)
+			{
+				case SimEventType::SIM_BRICK_DESTROYED:
+				{
+					Add(event.pos, BRICK_BREAK_PARTICLES, 7.0f, 1.2f, 0.12f, glm::vec4(6.0f, 2.4f, 0.6f, 1.0f));
+					break;
+				}
+
+				case SimEventType::SIM_BRICK_HIT:
+				{
+					Add(event.pos, BRICK_HIT_PARTICLES, 4.0f, 0.5f, 0.08f, glm::vec4(2.0f, 2.0f, 3.0f, 1.0f));
+					break;
+				}
+
+				case SimEventType::SIM_PADDLE_HIT:
+				{
+					Add(event.pos, PADDLE_HIT_PARTICLES, 3.0f, 0.3f, 0.06f, glm::vec4(0.8f, 1.6f, 4.0f, 1.0f));
+					break;
+				}
+
+				default:
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	void ParticleEmitterQueue::Clear()
+	{
+		emitters.clear();
+		particle_count = 0;
+	}
+
+	namespace Particles
+	{
+		glm::mat4 FieldViewProj(VkExtent2D extent)
+		{
+			return Scene::FieldCamera(extent).view_proj;
+		}
+	}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "util.h"
+#include "simulation.h"
+
+namespace OB3D
+{
+	// Matches Particle in Shaders/particle_common.glsl, std430
+	struct GpuParticle
+	{
+		glm::vec2 pos;
+		glm::vec2 vel;
+		// HDR, the additive draw lets bright bursts bloom later
+		glm::vec4 color;
+		// Seconds left, dead once it reaches 0
+		float life;
+		float max_life;
+		float size;
+		float pad;
+	};
+	static_assert(sizeof(GpuParticle) == 48);
+
+	// Matches ParticleEmitter in Shaders/particle_common.glsl, std430
+	// Emitters are uploaded every frame, particle first .. first + count - 1 of the frame's emission belong to this one
+	struct GpuParticleEmitter
+	{
+		glm::vec2 pos;
+		float speed;
+		float life;
+		glm::vec4 color;
+		uint32_t first;
+		uint32_t count;
+		uint32_t seed;
+		float size;
+	};
+	static_assert(sizeof(GpuParticleEmitter) == 48);
+
+	// Matches ParticleCounters in Shaders/particle_common.glsl
+	// Live counts of both pools plus the indirect arguments the GPU writes for itself, the CPU never reads it back
+	struct GpuParticleCounters
+	{
+		uint32_t alive_count[2];
+		// Appends rejected because the pool was full, for debugging
+		uint32_t dropped;
+		uint32_t pad0;
+		VkDispatchIndirectCommand simulate_dispatch;
+		uint32_t pad1;
+		VkDrawIndirectCommand draw;
+	};
+	static_assert(offsetof(GpuParticleCounters, simulate_dispatch) == 16);
+	static_assert(offsetof(GpuParticleCounters, draw) == 32);
+
+	// Shared by the simulate, emit and finalize passes
+	struct ParticleComputePushConstants
+	{
+		VkDeviceAddress src_particles;
+		VkDeviceAddress dst_particles;
+		VkDeviceAddress counters;
+		VkDeviceAddress emitters;
+		uint32_t capacity;
+		uint32_t emitter_count;
+		uint32_t emit_total;
+		// Pools are ping-ponged, survivors of src are compacted into dst
+		uint32_t src_slot;
+		uint32_t dst_slot;
+		float dt;
+		float gravity;
+		float drag;
+	};
+	static_assert(sizeof(ParticleComputePushConstants) <= 128);
+
+	struct ParticleDrawPushConstants
+	{
+		glm::mat4 view_proj;
+		VkDeviceAddress particles;
+		VkDeviceAddress pad;
+	};
+	static_assert(sizeof(ParticleDrawPushConstants) <= 128);
+
+	constexpr uint32_t PARTICLE_WORKGROUP_SIZE = 64;
+	// Two triangles per particle, expanded in the vertex shader
+	constexpr uint32_t PARTICLE_QUAD_VERTICES = 6;
+	// Bursts beyond this in a single frame are dropped
+	constexpr uint32_t MAX_PARTICLE_EMITTERS = 4096;
+
+	// Live particle counts timed by --particle-bench, the pools are grown to the largest one
+	constexpr std::array<uint32_t, 5> PARTICLE_BENCH_COUNTS = { 10000, 100000, 250000, 500000, 1000000 };
+	constexpr uint32_t PARTICLE_BENCH_CAPACITY = PARTICLE_BENCH_COUNTS.back();
+
+	// Emitters collected on the CPU during a frame, uploaded and consumed by the emit pass
+	struct ParticleEmitterQueue
+	{
+		std::vector<GpuParticleEmitter> emitters;
+		// Sum of every emitter's count, one emit thread per particle
+		uint32_t particle_count = 0;
+		uint32_t next_seed = 1;
+
+		void Add(glm::vec2 pos, uint32_t count, float speed, float life, float size, glm::vec4 color);
+		// Bursts for the events of the tick the world just simulated
+		void AddSimEvents(const World& world);
+		void Clear();
+	};
+
+	namespace Particles
+	{
+		// Particles live on the z = 0 plane of the scene and are drawn with its camera
+		glm::mat4 FieldViewProj(VkExtent2D extent);
+	}
+}
@@ -0,0 +1,177 @@
+#include "perf_suite.h"
+#include "simulation.h"
+#include <cstdio>
+
+namespace OB3D
+{
+	// Collision benchmark: balls are put back on the field every round, before many of them are lost
+	constexpr uint32_t COLLISION_ROUNDS = 50;
+	constexpr uint32_t COLLISION_TICKS_PER_ROUND = 240;
+
+	void PerfResults::Add(std::string name, double value)
+	{
+		entries.push_back({ std::move(name), value });
+	}
+
+	static void SkipPast(std::string_view text, size_t& pos, char c)
+	{
+		pos = text.find(c, pos);
+		pos = pos == std::string_view::npos ? text.size() : pos + 1;
+	}
+
+	// Value of "key" between pos and end, the key has to be followed by a colon
+	static std::optional<std::string_view> FindValue(std::string_view text, size_t pos, size_t end, std::string_view key)
+	{
+		std::string quoted_key = fmt::format("\"{:s}\"", key);
+		size_t key_pos = text.find(quoted_key, pos);
+		if (key_pos == std::string_view::npos || key_pos >= end)
+		{
+			return std::nullopt;
+		}
+
+		size_t value_pos = key_pos + quoted_key.size();
+		SkipPast(text, value_pos, ':');
+		while (value_pos < end && (text[value_pos] == ' ' || text[value_pos] == '\t'))
+		{
+			value_pos++;
+		}
+		return text.substr(value_pos, end - value_pos);
+	}
+
+	namespace Perf
+	{
+		bool WriteJson(const char* path, const PerfResults& results)
+		{
+			FILE* file = std::fopen(path, "w");
+			if (file == nullptr)
+			{
+				fmt::println("Failed to write performance results {:s}", path);
+				return false;
+			}
+
+			std::string text = fmt::format("{{\n  \"device\": \"{:s}\",\n  \"results\": [\n", results.device);
+			for (size_t i = 0; i < results.entries.size(); i++)
+			{
+				const PerfResult& entry = results.entries[i];
+				text += fmt::format("    {{ \"name\": \"{:s}\", \"value\": {:.6f} }}{:s}\n",
+									entry.name, entry.value, i + 1 < results.entries.size() ? "," : "");
+			}
+			text += "  ]\n}\n";
+
+			bool is_written = std::fputs(text.c_str(), file) >= 0;
+			std::fclose(file);
+			return is_written;
+		}
+
+		bool ReadBaseline(const char* path, std::vector<PerfResult>& out_entries)
+		{
+			FILE* file = std::fopen(path, "rb");
+			if (file == nullptr)
+			{
+				return false;
+			}
+
+			std::string text;
+			std::array<char, 4096> chunk = {};
+			size_t read_size = 0;
+			while ((read_size = std::fread(chunk.data(), 1, chunk.size(), file)) > 0)
+			{
+				text.append(chunk.data(), read_size);
+			}
+			std::fclose(file);
+
+			// Not a general JSON reader, just enough for the flat objects WriteJson writes
+			size_t pos = text.find("\"results\"");
+			while (pos < text.size())
+			{
+				SkipPast(text, pos, '{');
+				size_t end = text.find('}', pos);
+				if (end == std::string::npos)
+				{
+					break;
+				}
+
+				std::optional<std::string_view> name = FindValue(text, pos, end, "name");
+				std::optional<std::string_view> value = FindValue(text, pos, end, "value");
+				if (name && value && name->front() == '"')
+				{
+					PerfResult entry = {};
+					entry.name = std::string(name->substr(1, name->find('"', 1) - 1));
+					entry.value = std::strtod(std::string(*value).c_str(), nullptr);
+
+					std::optional<std::string_view> tolerance = FindValue(text, pos, end, "tolerance");
+					entry.tolerance = tolerance ? std::strtod(std::string(*tolerance).c_str(), nullptr) : -1.0;
+					out_entries.push_back(entry);
+				}
+				pos = end + 1;
+			}
+
+			return !out_entries.empty();
+		}
+
+		uint32_t Compare(const PerfResults& results, std::span<const PerfResult> baseline, double default_tolerance)
+		{
+			uint32_t regression_count = 0;
+			fmt::println("{:<36s} {:>12s} {:>12s} {:>9s}", "benchmark", "value", "baseline", "change");
+
+			for (const PerfResult& result : results.entries)
+			{
+				auto base = std::find_if(baseline.begin(), baseline.end(), [&](const PerfResult& entry) { return entry.name == result.name; });
+				if (base == baseline.end() || base->value <= 0.0)
+				{
+					fmt::println("{:<36s} {:>12.4f} {:>12s} {:>9s}", result.name, result.value, "-", "new");
+					continue;
+				}
+
+				double change = result.value / base->value - 1.0;
+				double tolerance = base->tolerance >= 0.0 ? base->tolerance : default_tolerance;
+				bool is_regression = change > tolerance;
+				regression_count += is_regression ? 1 : 0;
+
+				fmt::println("{:<36s} {:>12.4f} {:>12.4f} {:>+8.1f}%{:s}", result.name, result.value, base->value, change * 100.0,
+							 is_regression ? fmt::format("  REGRESSION, over {:.0f}%", tolerance * 100.0) : "");
+			}
+			return regression_count;
+		}
+
+		double TimeCollisionTick()
+		{
+			std::array<uint8_t, BRICK_COUNT> full_level;
+			full_level.fill(3);
+
+			World world = {};
+			world.Reset(1);
+			SimRng rng = {};
+			rng.Seed(1);
+
+			std::chrono::steady_clock::duration total_time = {};
+			for (uint32_t round = 0; round < COLLISION_ROUNDS; round++)
+			{
+				world.LoadLevel(full_level);
+
+				// Spread over the open space under the bricks, all heading up into them at different angles
+				world.ball_count = MAX_BALLS;
+				for (uint32_t i = 0; i < MAX_BALLS; i++)
+				{
+					float angle = rng.NextRange(-1.0f, 1.0f);
+					world.balls[i].pos = glm::vec2(rng.NextRange(1.0f, FIELD_WIDTH - 1.0f), rng.NextRange(PADDLE_Y + 1.0f, BRICK_AREA_BOTTOM - 1.0f));
+					world.balls[i].vel = BALL_SPEED * glm::vec2(std::sin(angle), std::cos(angle));
+					world.balls[i].is_attached = false;
+				}
+
+				auto start = std::chrono::steady_clock::now();
+				for (uint32_t tick = 0; tick < COLLISION_TICKS_PER_ROUND; tick++)
+				{
+					// Follows the first ball so fewer of them fall out
+					TickInput input = {};
+					input.paddle_axis = int8_t(world.balls[0].pos.x > world.paddle_x ? 1 : -1);
+					world.Tick(input);
+				}
+				total_time += std::chrono::steady_clock::now() - start;
+			}
+
+			std::chrono::duration<double, std::micro> total_us = total_time;
+			return total_us.count() / (COLLISION_ROUNDS * COLLISION_TICKS_PER_ROUND);
+		}
+	}
+}
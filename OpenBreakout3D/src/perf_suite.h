@@ -0,0 +1,40 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// Particles kept alive in the particle scenario, the pools are grown to hold them
+	constexpr uint32_t PERF_PARTICLE_COUNT = 100000;
+
+	// One measurement, lower is always better
+	struct PerfResult
+	{
+		std::string name;
+		double value;
+		// Overrides the suite's tolerance for this entry when >= 0, only read from baselines
+		double tolerance = -1.0;
+	};
+
+	struct PerfResults
+	{
+		std::string device;
+		std::vector<PerfResult> entries;
+
+		void Add(std::string name, double value);
+	};
+
+	namespace Perf
+	{
+		// { "device": ..., "results": [ { "name": ..., "value": ... }, ... ] }
+		bool WriteJson(const char* path, const PerfResults& results);
+		// Reads the entries of a file written by WriteJson, entries may carry a "tolerance" added by hand
+		// False when the file is missing or has no entries
+		bool ReadBaseline(const char* path, std::vector<PerfResult>& out_entries);
+		// Prints every result next to its baseline, returns how many are slower than their tolerance allows
+		// Results without a baseline entry are printed but never fail
+		uint32_t Compare(const PerfResults& results, std::span<const PerfResult> baseline, double default_tolerance);
+
+		// Microseconds per World::Tick with every brick up and MAX_BALLS balls bouncing through them
+		double TimeCollisionTick();
+	}
+}
@@ -0,0 +1,142 @@
+#include "replay.h"
+#include <chrono>
+#include <cstdio>
+
+namespace OB3D
+{
+	// Space reserved for recordings of unknown length, a minute of play at the fixed tick rate
+	constexpr size_t RECORDER_DEFAULT_TICKS = SIM_TICK_RATE * 60;
+
+	void ReplayRecorder::Begin(const World& world, uint64_t seed, size_t expected_tick_count)
+	{
+		data.header = {};
+		data.header.magic = REPLAY_MAGIC;
+		data.header.version = REPLAY_VERSION;
+		data.header.tick_rate = SIM_TICK_RATE;
+		data.header.seed = seed;
+		data.header.level = world.level_bricks;
+
+		data.ticks.clear();
+		data.ticks.reserve(expected_tick_count != 0 ? expected_tick_count : RECORDER_DEFAULT_TICKS);
+		is_recording = true;
+	}
+
+	void ReplayRecorder::Record(const TickInput& input, const World& world)
+	{
+		ReplayTick tick = {};
+		tick.paddle_axis = input.paddle_axis;
+		tick.buttons = input.buttons;
+		tick.state_hash = uint32_t(world.Hash());
+		data.ticks.push_back(tick);
+		data.header.tick_count = uint32_t(data.ticks.size());
+	}
+
+	namespace Replay
+	{
+		bool Load(const char* path, ReplayData& out_data)
+		{
+			FILE* file = std::fopen(path, "rb");
+			if (file == nullptr)
+			{
+				fmt::println("Failed to open replay {:s}", path);
+				return false;
+			}
+
+			bool is_valid = std::fread(&out_data.header, sizeof(ReplayHeader), 1, file) == 1
+							&& out_data.header.magic == REPLAY_MAGIC
+							&& out_data.header.version == REPLAY_VERSION
+							&& out_data.header.tick_rate == SIM_TICK_RATE;
+
+			if (is_valid)
+			{
+				// The count comes from the file, a truncated or corrupt one must not decide how much is allocated
+				long ticks_start = std::ftell(file);
+				std::fseek(file, 0, SEEK_END);
+				long file_size = std::ftell(file);
+				std::fseek(file, ticks_start, SEEK_SET);
+				is_valid = ticks_start >= 0 && file_size >= ticks_start
+						   && uint64_t(out_data.header.tick_count) * sizeof(ReplayTick) <= uint64_t(file_size - ticks_start);
+			}
+
+			if (is_valid)
+			{
+				out_data.ticks.resize(out_data.header.tick_count);
+				is_valid = std::fread(out_data.ticks.data(), sizeof(ReplayTick), out_data.ticks.size(), file) == out_data.ticks.size();
+			}
+
+			std::fclose(file);
+			if (!is_valid)
+			{
+				fmt::println("{:s} is not a replay of this version", path);
+			}
+			return is_valid;
+		}
+
+		bool Save(const char* path, const ReplayData& data)
+		{
+			FILE* file = std::fopen(path, "wb");
+			if (file == nullptr)
+			{
+				fmt::println("Failed to create replay {:s}", path);
+				return false;
+			}
+
+			bool is_written = std::fwrite(&data.header, sizeof(ReplayHeader), 1, file) == 1
+							  && std::fwrite(data.ticks.data(), sizeof(ReplayTick), data.ticks.size(), file) == data.ticks.size();
+			// Buffered data only reaches the disk on close, a full disk shows up here
+			is_written = std::fclose(file) == 0 && is_written;
+
+			if (!is_written)
+			{
+				fmt::println("Failed to write replay {:s}", path);
+				return false;
+			}
+
+			fmt::println("Saved replay {:s} with {} ticks", path, data.ticks.size());
+			return true;
+		}
+
+		void Start(const ReplayData& data, World& world)
+		{
+			world.Reset(data.header.seed);
+			world.LoadLevel(data.header.level);
+		}
+
+		bool StepAndVerify(const ReplayData& data, uint32_t tick, World& world)
+		{
+			const ReplayTick& recorded = data.ticks[tick];
+
+			TickInput input = {};
+			input.paddle_axis = recorded.paddle_axis;
+			input.buttons = recorded.buttons;
+			world.Tick(input);
+
+			if (uint32_t(world.Hash()) != recorded.state_hash)
+			{
+				fmt::println("Replay diverged at tick {}: state hash {:08x}, recorded {:08x}", tick, uint32_t(world.Hash()), recorded.state_hash);
+				return false;
+			}
+			return true;
+		}
+
+		int RunSimulationOnly(const ReplayData& data)
+		{
+			World world;
+			Start(data, world);
+
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t tick = 0; tick < data.header.tick_count; tick++)
+			{
+				if (!StepAndVerify(data, tick, world))
+				{
+					return 1;
+				}
+			}
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			fmt::println("Replay verified: {} ticks in {:.3f} ms ({:.0f} ticks/s), final score {}",
+				data.header.tick_count, elapsed.count() * 1000.0, data.header.tick_count / std::max(elapsed.count(), 1e-9), world.score);
+			return 0;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "util.h"
+#include "simulation.h"
+
+namespace OB3D
+{
+	constexpr uint32_t REPLAY_MAGIC = 0x5233424F; // "OB3R"
+	// 2: ball directions no longer come from the C runtime's sin and cos
+	constexpr uint32_t REPLAY_VERSION = 2;
+
+	// File layout: ReplayHeader followed by tick_count ReplayTicks, little endian
+	struct ReplayHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t tick_rate;
+		uint32_t tick_count;
+		uint64_t seed;
+		// The level the run started on, replays don't depend on asset files
+		std::array<uint8_t, BRICK_COUNT> level;
+	};
+	static_assert(sizeof(ReplayHeader) == 120);
+
+	struct ReplayTick
+	{
+		int8_t paddle_axis;
+		uint8_t buttons;
+		uint16_t reserved;
+		// Low bits of World::Hash() after the tick
+		uint32_t state_hash;
+	};
+	static_assert(sizeof(ReplayTick) == 8);
+
+	struct ReplayData
+	{
+		ReplayHeader header;
+		std::vector<ReplayTick> ticks;
+	};
+
+	// Appends every simulated tick
+	struct ReplayRecorder
+	{
+		ReplayData data;
+		bool is_recording = false;
+
+		// Reserves expected_tick_count ticks up front, 0 when the length of the run isn't known
+		void Begin(const World& world, uint64_t seed, size_t expected_tick_count);
+		void Record(const TickInput& input, const World& world);
+	};
+
+	namespace Replay
+	{
+		bool Load(const char* path, ReplayData& out_data);
+		// False when the file couldn't be written completely
+		bool Save(const char* path, const ReplayData& data);
+
+		// Puts the world into the state the recording started from
+		void Start(const ReplayData& data, World& world);
+		// Simulates the recorded tick, false when the resulting state differs from the recording
+		bool StepAndVerify(const ReplayData& data, uint32_t tick, World& world);
+
+		// Simulation only playback at full speed, returns the process exit code
+		int RunSimulationOnly(const ReplayData& data);
+	}
+}
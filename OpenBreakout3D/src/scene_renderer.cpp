@@ -0,0 +1,255 @@
+#include "scene_renderer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
+
+namespace OB3D
+{
+	// Units are world units and radians
+	// Space kept around the field so bursts at the edges stay visible
+	constexpr float FIELD_MARGIN = 1.0f;
+	constexpr float CAMERA_FOV_Y = 0.6f;
+	// Camera sits below the field and looks up it, the top rows recede
+	constexpr float CAMERA_TILT = 0.35f;
+
+	// Paddle, balls and bricks are centered on z = 0, the backdrop sits behind them and catches their shadows
+	constexpr float OBJECT_DEPTH = 0.6f;
+	constexpr float BACKDROP_FRONT = -0.9f;
+	constexpr float BACKDROP_DEPTH = 0.2f;
+	// Gaps between bricks so their shadows read as separate blocks
+	constexpr float BRICK_FILL = 0.92f;
+
+	// Blend between uniform (0) and logarithmic (1) cascade splits
+	constexpr float CASCADE_SPLIT_LAMBDA = 0.5f;
+	// How far towards the light casters outside a cascade's slice are still caught
+	constexpr float CASTER_RANGE = 32.0f;
+
+	// Everything the camera and the cascades have to cover
+	static std::array<glm::vec3, 8> SceneBoundsCorners()
+	{
+		glm::vec3 min_corner(-FIELD_MARGIN, -FIELD_MARGIN, BACKDROP_FRONT - BACKDROP_DEPTH);
+		glm::vec3 max_corner(FIELD_WIDTH + FIELD_MARGIN, FIELD_HEIGHT + FIELD_MARGIN, OBJECT_DEPTH * 0.5f);
+
+		std::array<glm::vec3, 8> corners;
+		for (uint32_t i = 0; i < corners.size(); i++)
+		{
+			corners[i] = glm::vec3((i & 1) ? max_corner.x : min_corner.x,
+								   (i & 2) ? max_corner.y : min_corner.y,
+								   (i & 4) ? max_corner.z : min_corner.z);
+		}
+		return corners;
+	}
+
+	static glm::vec4 BrickColor(uint8_t hit_points)
+	{
+		switch (hit_points)
+		{
+			case 1:
+			{
+				return glm::vec4(0.9f, 0.35f, 0.2f, 0.0f);
+			}
+
+			case 2:
+			{
+				return glm::vec4(0.95f, 0.7f, 0.2f, 0.0f);
+			}
+
+			default:
+			{
+				return glm::vec4(0.3f, 0.6f, 0.95f, 0.0f);
+			}
+		}
+	}
+
+	namespace Scene
+	{
+		SceneCamera FieldCamera(VkExtent2D extent)
+		{
+			SceneCamera camera = {};
+			camera.aspect = float(extent.width) / float(std::max(extent.height, 1u));
+			camera.tan_half_fov = std::tan(CAMERA_FOV_Y * 0.5f);
+			camera.forward = glm::vec3(0.0f, std::sin(CAMERA_TILT), -std::cos(CAMERA_TILT));
+			camera.right = glm::normalize(glm::cross(camera.forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+			camera.up = glm::cross(camera.right, camera.forward);
+
+			// Closest distance from the field's center at which every corner of the field is inside the frustum
+			glm::vec3 center(FIELD_WIDTH * 0.5f, FIELD_HEIGHT * 0.5f, 0.0f);
+			float distance = 0.0f;
+			for (float x : { -FIELD_MARGIN, FIELD_WIDTH + FIELD_MARGIN })
+			{
+				for (float y : { -FIELD_MARGIN, FIELD_HEIGHT + FIELD_MARGIN })
+				{
+					glm::vec3 offset = glm::vec3(x, y, 0.0f) - center;
+					float along = glm::dot(offset, camera.forward);
+					distance = std::max(distance, std::abs(glm::dot(offset, camera.up)) / camera.tan_half_fov - along);
+					distance = std::max(distance, std::abs(glm::dot(offset, camera.right)) / (camera.tan_half_fov * camera.aspect) - along);
+				}
+			}
+			camera.position = center - camera.forward * distance;
+
+			// Depth range fitted to the scene, keeps the depth buffer's precision where the objects are
+			float min_depth = distance;
+			float max_depth = distance;
+			for (const glm::vec3& corner : SceneBoundsCorners())
+			{
+				float depth = glm::dot(corner - camera.position, camera.forward);
+				min_depth = std::min(min_depth, depth);
+				max_depth = std::max(max_depth, depth);
+			}
+			camera.near_plane = std::max(0.1f, min_depth - 1.0f);
+			camera.far_plane = max_depth + 1.0f;
+
+			glm::mat4 view = glm::lookAtRH(camera.position, center, glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 proj = glm::perspectiveRH_ZO(CAMERA_FOV_Y, camera.aspect, camera.near_plane, camera.far_plane);
+			// Vulkan's clip space points y down
+			proj[1][1] *= -1.0f;
+			camera.view_proj = proj * view;
+
+			return camera;
+		}
+
+		glm::vec3 LightDirection()
+		{
+			// From the top left in front of the field, shadows fall down and right onto the backdrop
+			return glm::normalize(glm::vec3(-0.35f, 0.55f, 1.0f));
+		}
+
+		uint32_t BuildInstances(const World& world, std::vector<GpuSceneInstance>& out_instances)
+		{
+			GpuSceneInstance paddle = {};
+			paddle.center = glm::vec4(world.paddle_x, PADDLE_Y, 0.0f, 0.0f);
+			paddle.half_extent = glm::vec4(PADDLE_WIDTH * 0.5f, PADDLE_HEIGHT * 0.5f, OBJECT_DEPTH * 0.5f, 0.0f);
+			paddle.color = glm::vec4(0.8f, 0.85f, 0.9f, 0.0f);
+			out_instances.push_back(paddle);
+
+			// Fully emissive and brighter than 1 so they bloom
+			for (uint32_t i = 0; i < world.ball_count; i++)
+			{
+				GpuSceneInstance ball = {};
+				ball.center = glm::vec4(world.balls[i].pos, 0.0f, 0.0f);
+				ball.half_extent = glm::vec4(glm::vec3(BALL_RADIUS), 0.0f);
+				ball.color = glm::vec4(4.0f, 3.8f, 3.2f, 1.0f);
+				out_instances.push_back(ball);
+			}
+
+			for (uint32_t brick_idx = 0; brick_idx < BRICK_COUNT; brick_idx++)
+			{
+				if (world.bricks[brick_idx] == 0)
+				{
+					continue;
+				}
+
+				GpuSceneInstance brick = {};
+				brick.center = glm::vec4(World::BrickCenter(brick_idx), 0.0f, 0.0f);
+				brick.half_extent = glm::vec4(BRICK_WIDTH * 0.5f * BRICK_FILL, BRICK_HEIGHT * 0.5f * BRICK_FILL, OBJECT_DEPTH * 0.5f, 0.0f);
+				brick.color = BrickColor(world.bricks[brick_idx]);
+				out_instances.push_back(brick);
+			}
+
+			uint32_t caster_count = uint32_t(out_instances.size());
+
+			GpuSceneInstance backdrop = {};
+			backdrop.center = glm::vec4(FIELD_WIDTH * 0.5f, FIELD_HEIGHT * 0.5f, BACKDROP_FRONT - BACKDROP_DEPTH * 0.5f, 0.0f);
+			backdrop.half_extent = glm::vec4(FIELD_WIDTH * 0.5f + FIELD_MARGIN, FIELD_HEIGHT * 0.5f + FIELD_MARGIN, BACKDROP_DEPTH * 0.5f, 0.0f);
+			backdrop.color = glm::vec4(0.12f, 0.13f, 0.16f, 0.0f);
+			out_instances.push_back(backdrop);
+
+			return caster_count;
+		}
+
+		std::array<ShadowCascade, SHADOW_CASCADE_COUNT> ComputeCascades(const SceneCamera& camera, glm::vec3 light_dir, uint32_t map_size)
+		{
+			// Practical split scheme over the camera's depth range, which is already fitted to the scene
+			std::array<float, SHADOW_CASCADE_COUNT + 1> splits;
+			splits[0] = camera.near_plane;
+			for (uint32_t i = 1; i <= SHADOW_CASCADE_COUNT; i++)
+			{
+				float ratio = float(i) / float(SHADOW_CASCADE_COUNT);
+				float uniform_split = camera.near_plane + (camera.far_plane - camera.near_plane) * ratio;
+				float log_split = camera.near_plane * std::pow(camera.far_plane / camera.near_plane, ratio);
+				splits[i] = uniform_split + (log_split - uniform_split) * CASCADE_SPLIT_LAMBDA;
+			}
+
+			glm::vec3 light_up = std::abs(light_dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+			std::array<ShadowCascade, SHADOW_CASCADE_COUNT> cascades;
+			for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++)
+			{
+				// Corners of the view frustum's slice
+				std::array<glm::vec3, 8> corners;
+				uint32_t corner_idx = 0;
+				for (float depth : { splits[i], splits[i + 1] })
+				{
+					glm::vec3 slice_center = camera.position + camera.forward * depth;
+					glm::vec3 half_up = camera.up * (depth * camera.tan_half_fov);
+					glm::vec3 half_right = camera.right * (depth * camera.tan_half_fov * camera.aspect);
+					corners[corner_idx++] = slice_center - half_right - half_up;
+					corners[corner_idx++] = slice_center + half_right - half_up;
+					corners[corner_idx++] = slice_center - half_right + half_up;
+					corners[corner_idx++] = slice_center + half_right + half_up;
+				}
+
+				glm::vec3 center(0.0f);
+				for (const glm::vec3& corner : corners)
+				{
+					center += corner / float(corners.size());
+				}
+
+				// A sphere doesn't change size as the camera turns, rounding keeps float noise from changing it either
+				float radius = 0.0f;
+				for (const glm::vec3& corner : corners)
+				{
+					radius = std::max(radius, glm::length(corner - center));
+				}
+				radius = std::ceil(radius * 16.0f) / 16.0f;
+
+				glm::vec3 light_eye = center + light_dir * (radius + CASTER_RANGE);
+				glm::mat4 light_view = glm::lookAtRH(light_eye, center, light_up);
+				glm::mat4 light_proj = glm::orthoRH_ZO(-radius, radius, -radius, radius, 0.0f, radius * 2.0f + CASTER_RANGE);
+
+				// Moves the projection by less than a texel so the world origin lands on a texel corner,
+				// every texel then covers the same world area from one frame to the next
+				glm::vec4 origin = light_proj * light_view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				glm::vec2 origin_texels = glm::vec2(origin) * (float(map_size) * 0.5f);
+				glm::vec2 snap_offset = (glm::round(origin_texels) - origin_texels) * (2.0f / float(map_size));
+				light_proj[3][0] += snap_offset.x;
+				light_proj[3][1] += snap_offset.y;
+
+				cascades[i].view_proj = light_proj * light_view;
+				cascades[i].split_depth = splits[i + 1];
+				cascades[i].texel_size = radius * 2.0f / float(map_size);
+			}
+			return cascades;
+		}
+
+		uint32_t CullCasters(const ShadowCascade& cascade, std::span<const GpuSceneInstance> casters, std::vector<GpuSceneInstance>& out_instances)
+		{
+			const glm::mat4& m = cascade.view_proj;
+			uint32_t count = 0;
+			for (const GpuSceneInstance& caster : casters)
+			{
+				// The projection is orthographic, so the box maps to a box in clip space
+				glm::vec4 center = m * glm::vec4(glm::vec3(caster.center), 1.0f);
+				glm::vec3 extent;
+				for (int row = 0; row < 3; row++)
+				{
+					extent[row] = std::abs(m[0][row]) * caster.half_extent.x
+								+ std::abs(m[1][row]) * caster.half_extent.y
+								+ std::abs(m[2][row]) * caster.half_extent.z;
+				}
+
+				// Nothing in the field is nearer to the light than the near plane, it sits CASTER_RANGE behind the slice
+				bool is_outside = std::abs(center.x) - extent.x > 1.0f
+								  || std::abs(center.y) - extent.y > 1.0f
+								  || center.z - extent.z > 1.0f;
+				if (!is_outside)
+				{
+					out_instances.push_back(caster);
+					count++;
+				}
+			}
+			return count;
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "util.h"
+#include "simulation.h"
+
+namespace OB3D
+{
+	// Matches SceneInstance in Shaders/scene_common.glsl, std430
+	// Every object is the unit cube mesh stretched over its box
+	struct GpuSceneInstance
+	{
+		glm::vec4 center;
+		glm::vec4 half_extent;
+		// HDR albedo, a is the share of it that is emitted instead of lit
+		glm::vec4 color;
+	};
+	static_assert(sizeof(GpuSceneInstance) == 48);
+
+	constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+
+	// Matches SceneFrame in Shaders/scene_common.glsl, std430
+	struct GpuSceneFrame
+	{
+		glm::mat4 cascade_view_proj[SHADOW_CASCADE_COUNT];
+		// View depth where each cascade ends
+		glm::vec4 cascade_splits;
+		// World units covered by one shadow map texel in each cascade
+		glm::vec4 cascade_texel_sizes;
+		// xyz points towards the light
+		glm::vec4 light_dir;
+		// rgb light color, a ambient share
+		glm::vec4 light_color;
+		glm::vec4 camera_pos;
+		glm::vec4 camera_forward;
+		// x is one shadow map texel in uv
+		glm::vec4 shadow_params;
+	};
+	static_assert(sizeof(GpuSceneFrame) == 368);
+
+	// Shared by the shadow, depth prepass and opaque passes
+	struct ScenePushConstants
+	{
+		// The cascade's projection in the shadow pass, the camera's otherwise
+		glm::mat4 view_proj;
+		VkDeviceAddress vertices;
+		VkDeviceAddress instances;
+		VkDeviceAddress frame;
+		VkDeviceAddress pad;
+	};
+	static_assert(sizeof(ScenePushConstants) <= 128);
+
+	struct SceneCamera
+	{
+		glm::mat4 view_proj;
+		glm::vec3 position;
+		glm::vec3 forward;
+		glm::vec3 right;
+		glm::vec3 up;
+		float tan_half_fov;
+		float aspect;
+		float near_plane;
+		float far_plane;
+	};
+
+	struct ShadowCascade
+	{
+		glm::mat4 view_proj;
+		// View depth where the cascade ends
+		float split_depth;
+		float texel_size;
+	};
+
+	// Shadow map resolution when none is configured, per cascade
+	constexpr uint32_t DEFAULT_SHADOW_MAP_SIZE = 2048;
+
+	namespace Scene
+	{
+		// Perspective camera looking up the play field, framed so the whole field stays visible at the target's aspect
+		SceneCamera FieldCamera(VkExtent2D extent);
+		// Direction towards the light, shared by the shadow and opaque passes
+		glm::vec3 LightDirection();
+
+		// Paddle, balls and live bricks followed by the backdrop, returns how many of them cast shadows
+		// Casters always come first, the backdrop only receives
+		uint32_t BuildInstances(const World& world, std::vector<GpuSceneInstance>& out_instances);
+
+		// Splits the depth range the field covers, each cascade is a sphere around its slice of the view
+		// and its projection is snapped to whole texels, so shadow edges don't shimmer as the camera moves
+		std::array<ShadowCascade, SHADOW_CASCADE_COUNT> ComputeCascades(const SceneCamera& camera, glm::vec3 light_dir, uint32_t map_size);
+		// Appends the casters whose box reaches into the cascade, returns how many were appended
+		uint32_t CullCasters(const ShadowCascade& cascade, std::span<const GpuSceneInstance> casters, std::vector<GpuSceneInstance>& out_instances);
+	}
+}
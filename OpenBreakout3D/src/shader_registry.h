@@ -0,0 +1,23 @@
+#pragma once
+#include "util.h"
+// Generated from the compiled shaders by Shaders/EmbedSpirv.cmake
+#include "embedded_shaders.h"
+
+namespace OB3D
+{
+	namespace ShaderRegistry
+	{
+		// Usable in constant expressions, a missing shader can be caught with a static_assert
+		constexpr std::span<const uint32_t> FindEmbedded(std::string_view name)
+		{
+			for (const EmbeddedShaders::EmbeddedShader& shader : EmbeddedShaders::REGISTRY)
+			{
+				if (shader.name == name)
+				{
+					return shader.code;
+				}
+			}
+			return {};
+		}
+	}
+}
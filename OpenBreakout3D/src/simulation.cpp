@@ -0,0 +1,321 @@
+#include "simulation.h"
+
+namespace OB3D
+{
+	// Max deflection off the paddle edge, in radians from straight up
+	constexpr float PADDLE_MAX_BOUNCE_ANGLE = 1.05f;
+	constexpr float LAUNCH_MAX_ANGLE = 0.5f;
+	// One in N destroyed bricks releases an extra ball
+	constexpr uint32_t MULTIBALL_CHANCE = 8;
+	constexpr uint32_t BRICK_SCORE = 10;
+
+	// Unit vector angle radians clockwise from straight up, (sin, cos) from fixed polynomials.
+	// C runtimes disagree on the last bits of std::sin and std::cos, and velocities feed World::Hash(),
+	// so a recording has to come out the same with every compiler. Taylor series up to x^11 and x^12,
+	// accurate to float precision for |angle| <= pi / 2
+	static glm::vec2 DirectionFromAngle(float angle)
+	{
+		float x2 = angle * angle;
+		float sin = angle * (1.0f - x2 / 6.0f * (1.0f - x2 / 20.0f * (1.0f - x2 / 42.0f * (1.0f - x2 / 72.0f * (1.0f - x2 / 110.0f)))));
+		float cos = 1.0f - x2 / 2.0f * (1.0f - x2 / 12.0f * (1.0f - x2 / 30.0f * (1.0f - x2 / 56.0f * (1.0f - x2 / 90.0f * (1.0f - x2 / 132.0f)))));
+		return glm::vec2(sin, cos);
+	}
+
+	static constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+	static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	template<typename T>
+	static uint64_t HashValue(uint64_t hash, const T& value)
+	{
+		return HashBytes(hash, &value, sizeof(T));
+	}
+
+	void SimRng::Seed(uint64_t seed)
+	{
+		state = 0;
+		increment = (seed << 1u) | 1u;
+		Next();
+		state += seed;
+		Next();
+	}
+
+	uint32_t SimRng::Next()
+	{
+		uint64_t old_state = state;
+		state = old_state * 6364136223846793005ull + increment;
+		uint32_t xorshifted = uint32_t(((old_state >> 18u) ^ old_state) >> 27u);
+		uint32_t rot = uint32_t(old_state >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+	}
+
+	float SimRng::NextRange(float min, float max)
+	{
+		// 24 random bits fill a float mantissa exactly
+		float unit = float(Next() >> 8) / float(1u << 24);
+		return min + (max - min) * unit;
+	}
+
+	void World::Reset(uint64_t seed)
+	{
+		rng.Seed(seed);
+		tick = 0;
+		score = 0;
+		lives = START_LIVES;
+		event_count = 0;
+		paddle_x = FIELD_WIDTH * 0.5f;
+
+		// Default layout, tougher bricks at the top
+		for (uint32_t row = 0; row < BRICK_ROWS; row++)
+		{
+			uint8_t hit_points = row < 2 ? 3 : (row < 5 ? 2 : 1);
+			for (uint32_t col = 0; col < BRICK_COLUMNS; col++)
+			{
+				level_bricks[row * BRICK_COLUMNS + col] = hit_points;
+			}
+		}
+
+		RestartLevel();
+	}
+
+	void World::LoadLevel(std::span<const uint8_t> brick_hit_points)
+	{
+		std::fill(level_bricks.begin(), level_bricks.end(), uint8_t(0));
+		std::copy_n(brick_hit_points.begin(), std::min<size_t>(brick_hit_points.size(), BRICK_COUNT), level_bricks.begin());
+		RestartLevel();
+	}
+
+	void World::RestartLevel()
+	{
+		bricks = level_bricks;
+		bricks_left = uint32_t(std::count_if(bricks.begin(), bricks.end(), [](uint8_t hit_points) { return hit_points != 0; }));
+		AttachBall();
+	}
+
+	void World::AttachBall()
+	{
+		ball_count = 1;
+		balls[0].pos = glm::vec2(paddle_x, PADDLE_Y + PADDLE_HEIGHT * 0.5f + BALL_RADIUS);
+		balls[0].vel = glm::vec2(0.0f);
+		balls[0].is_attached = true;
+	}
+
+	void World::PushEvent(SimEventType type, glm::vec2 pos)
+	{
+		if (event_count < MAX_TICK_EVENTS)
+		{
+			events[event_count++] = { type, pos };
+		}
+	}
+
+	glm::vec2 World::BrickCenter(uint32_t brick_idx)
+	{
+		uint32_t col = brick_idx % BRICK_COLUMNS;
+		uint32_t row = brick_idx / BRICK_COLUMNS;
+		return glm::vec2((col + 0.5f) * BRICK_WIDTH, FIELD_HEIGHT - 2.0f - (row + 0.5f) * BRICK_HEIGHT);
+	}
+
+	void World::Tick(const TickInput& input)
+	{
+		tick++;
+		event_count = 0;
+
+		paddle_x += float(input.paddle_axis) * PADDLE_SPEED * SIM_TICK_DT;
+		paddle_x = std::clamp(paddle_x, PADDLE_WIDTH * 0.5f, FIELD_WIDTH - PADDLE_WIDTH * 0.5f);
+
+		uint32_t ball_idx = 0;
+		while (ball_idx < ball_count)
+		{
+			Ball& ball = balls[ball_idx];
+
+			if (ball.is_attached)
+			{
+				ball.pos.x = paddle_x;
+				if (input.buttons & BUTTON_LAUNCH)
+				{
+					float angle = rng.NextRange(-LAUNCH_MAX_ANGLE, LAUNCH_MAX_ANGLE);
+					ball.vel = BALL_SPEED * DirectionFromAngle(angle);
+					ball.is_attached = false;
+				}
+				ball_idx++;
+				continue;
+			}
+
+			ball.pos += ball.vel * SIM_TICK_DT;
+
+			// Walls
+			if (ball.pos.x < BALL_RADIUS)
+			{
+				ball.pos.x = BALL_RADIUS;
+				ball.vel.x = std::abs(ball.vel.x);
+				PushEvent(SimEventType::SIM_WALL_HIT, ball.pos);
+			}
+			else if (ball.pos.x > FIELD_WIDTH - BALL_RADIUS)
+			{
+				ball.pos.x = FIELD_WIDTH - BALL_RADIUS;
+				ball.vel.x = -std::abs(ball.vel.x);
+				PushEvent(SimEventType::SIM_WALL_HIT, ball.pos);
+			}
+
+			if (ball.pos.y > FIELD_HEIGHT - BALL_RADIUS)
+			{
+				ball.pos.y = FIELD_HEIGHT - BALL_RADIUS;
+				ball.vel.y = -std::abs(ball.vel.y);
+				PushEvent(SimEventType::SIM_WALL_HIT, ball.pos);
+			}
+
+			CollidePaddle(ball);
+			CollideBricks(ball);
+
+			if (ball.pos.y < -BALL_RADIUS)
+			{
+				PushEvent(SimEventType::SIM_BALL_LOST, ball.pos);
+				// Swap remove, the moved ball is processed next
+				balls[ball_idx] = balls[ball_count - 1];
+				ball_count--;
+				continue;
+			}
+
+			ball_idx++;
+		}
+
+		if (ball_count == 0)
+		{
+			lives--;
+			if (lives == 0)
+			{
+				score = 0;
+				lives = START_LIVES;
+				RestartLevel();
+			}
+			else
+			{
+				AttachBall();
+			}
+		}
+
+		if (bricks_left == 0)
+		{
+			RestartLevel();
+		}
+	}
+
+	void World::CollidePaddle(Ball& ball)
+	{
+		float paddle_top = PADDLE_Y + PADDLE_HEIGHT * 0.5f;
+		bool is_falling = ball.vel.y < 0.0f;
+		bool overlaps_y = ball.pos.y - BALL_RADIUS <= paddle_top && ball.pos.y >= PADDLE_Y - PADDLE_HEIGHT * 0.5f;
+		bool overlaps_x = std::abs(ball.pos.x - paddle_x) <= PADDLE_WIDTH * 0.5f + BALL_RADIUS;
+
+		if (!is_falling || !overlaps_y || !overlaps_x)
+		{
+			return;
+		}
+
+		// Where the ball lands on the paddle decides the bounce angle
+		float offset = std::clamp((ball.pos.x - paddle_x) / (PADDLE_WIDTH * 0.5f), -1.0f, 1.0f);
+		float angle = offset * PADDLE_MAX_BOUNCE_ANGLE;
+		ball.vel = BALL_SPEED * DirectionFromAngle(angle);
+		ball.pos.y = paddle_top + BALL_RADIUS;
+		PushEvent(SimEventType::SIM_PADDLE_HIT, ball.pos);
+	}
+
+	void World::CollideBricks(Ball& ball)
+	{
+		if (ball.pos.y + BALL_RADIUS < BRICK_AREA_BOTTOM)
+		{
+			return;
+		}
+
+		// Only the cells under the ball's bounding box can be hit
+		float brick_top = FIELD_HEIGHT - 2.0f;
+		int min_col = std::max(0, int((ball.pos.x - BALL_RADIUS) / BRICK_WIDTH));
+		int max_col = std::min(int(BRICK_COLUMNS) - 1, int((ball.pos.x + BALL_RADIUS) / BRICK_WIDTH));
+		int min_row = std::max(0, int((brick_top - (ball.pos.y + BALL_RADIUS)) / BRICK_HEIGHT));
+		int max_row = std::min(int(BRICK_ROWS) - 1, int((brick_top - (ball.pos.y - BALL_RADIUS)) / BRICK_HEIGHT));
+
+		for (int row = min_row; row <= max_row; row++)
+		{
+			for (int col = min_col; col <= max_col; col++)
+			{
+				uint32_t brick_idx = uint32_t(row) * BRICK_COLUMNS + uint32_t(col);
+				if (bricks[brick_idx] == 0)
+				{
+					continue;
+				}
+
+				glm::vec2 center = BrickCenter(brick_idx);
+				glm::vec2 half_size = glm::vec2(BRICK_WIDTH, BRICK_HEIGHT) * 0.5f;
+				glm::vec2 closest = glm::clamp(ball.pos, center - half_size, center + half_size);
+				glm::vec2 delta = ball.pos - closest;
+				if (delta.x * delta.x + delta.y * delta.y > BALL_RADIUS * BALL_RADIUS)
+				{
+					continue;
+				}
+
+				// Reflect along the axis the ball came in from, relative to the brick's aspect
+				glm::vec2 rel = (ball.pos - center) / half_size;
+				if (std::abs(rel.x) > std::abs(rel.y))
+				{
+					ball.vel.x = rel.x > 0.0f ? std::abs(ball.vel.x) : -std::abs(ball.vel.x);
+				}
+				else
+				{
+					ball.vel.y = rel.y > 0.0f ? std::abs(ball.vel.y) : -std::abs(ball.vel.y);
+				}
+
+				bricks[brick_idx]--;
+				if (bricks[brick_idx] != 0)
+				{
+					PushEvent(SimEventType::SIM_BRICK_HIT, center);
+					return;
+				}
+
+				bricks_left--;
+				score += BRICK_SCORE;
+				PushEvent(SimEventType::SIM_BRICK_DESTROYED, center);
+
+				if (rng.Next() % MULTIBALL_CHANCE == 0 && ball_count < MAX_BALLS)
+				{
+					float angle = rng.NextRange(-LAUNCH_MAX_ANGLE, LAUNCH_MAX_ANGLE);
+					Ball& extra_ball = balls[ball_count++];
+					extra_ball.pos = center;
+					extra_ball.vel = BALL_SPEED * DirectionFromAngle(angle) * glm::vec2(1.0f, -1.0f);
+					extra_ball.is_attached = false;
+				}
+
+				// One brick per ball per tick
+				return;
+			}
+		}
+	}
+
+	uint64_t World::Hash() const
+	{
+		uint64_t hash = FNV_OFFSET;
+		hash = HashValue(hash, tick);
+		hash = HashValue(hash, rng.state);
+		hash = HashValue(hash, paddle_x);
+		hash = HashValue(hash, ball_count);
+		for (uint32_t i = 0; i < ball_count; i++)
+		{
+			hash = HashValue(hash, balls[i].pos);
+			hash = HashValue(hash, balls[i].vel);
+			hash = HashValue(hash, balls[i].is_attached);
+		}
+		hash = HashBytes(hash, bricks.data(), bricks.size());
+		hash = HashValue(hash, score);
+		hash = HashValue(hash, lives);
+		return hash;
+	}
+}
\ No newline at end of file
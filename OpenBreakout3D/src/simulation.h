@@ -0,0 +1,117 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	// The simulation always advances in fixed ticks so a run can be replayed exactly
+	constexpr uint32_t SIM_TICK_RATE = 120;
+	constexpr float SIM_TICK_DT = 1.0f / SIM_TICK_RATE;
+
+	// Play field in world units, origin at the bottom left corner
+	constexpr float FIELD_WIDTH = 16.0f;
+	constexpr float FIELD_HEIGHT = 20.0f;
+
+	constexpr uint32_t BRICK_COLUMNS = 12;
+	constexpr uint32_t BRICK_ROWS = 8;
+	constexpr uint32_t BRICK_COUNT = BRICK_COLUMNS * BRICK_ROWS;
+	constexpr float BRICK_WIDTH = FIELD_WIDTH / BRICK_COLUMNS;
+	constexpr float BRICK_HEIGHT = 0.6f;
+	// Bottom edge of the lowest brick row
+	constexpr float BRICK_AREA_BOTTOM = FIELD_HEIGHT - 2.0f - BRICK_ROWS * BRICK_HEIGHT;
+
+	constexpr float PADDLE_Y = 1.0f;
+	constexpr float PADDLE_WIDTH = 2.5f;
+	constexpr float PADDLE_HEIGHT = 0.4f;
+	constexpr float PADDLE_SPEED = 18.0f;
+
+	constexpr float BALL_RADIUS = 0.2f;
+	constexpr float BALL_SPEED = 12.0f;
+	constexpr uint32_t MAX_BALLS = 16;
+	constexpr uint32_t START_LIVES = 3;
+
+	// One tick can't produce more events than this, extra events are dropped
+	constexpr uint32_t MAX_TICK_EVENTS = 64;
+
+	enum TickButtons : uint8_t
+	{
+		BUTTON_LAUNCH = 1 << 0
+	};
+
+	struct TickInput
+	{
+		// -1, 0 or 1
+		int8_t paddle_axis;
+		uint8_t buttons;
+	};
+
+	enum class SimEventType : uint8_t
+	{
+		SIM_BRICK_DESTROYED,
+		SIM_BRICK_HIT,
+		SIM_PADDLE_HIT,
+		SIM_WALL_HIT,
+		SIM_BALL_LOST
+	};
+
+	struct SimEvent
+	{
+		SimEventType type;
+		glm::vec2 pos;
+	};
+
+	// PCG32, std distributions differ between standard libraries which would break replays
+	struct SimRng
+	{
+		uint64_t state;
+		uint64_t increment;
+
+		void Seed(uint64_t seed);
+		uint32_t Next();
+		// Uniform in [min, max)
+		float NextRange(float min, float max);
+	};
+
+	struct Ball
+	{
+		glm::vec2 pos;
+		glm::vec2 vel;
+		// Sits on the paddle until launched
+		bool is_attached;
+	};
+
+	struct World
+	{
+		uint32_t tick;
+		SimRng rng;
+
+		float paddle_x;
+		std::array<Ball, MAX_BALLS> balls;
+		uint32_t ball_count;
+		// Hit points per brick, 0 means destroyed
+		std::array<uint8_t, BRICK_COUNT> bricks;
+		std::array<uint8_t, BRICK_COUNT> level_bricks;
+		uint32_t bricks_left;
+		uint32_t score;
+		uint32_t lives;
+
+		// Events of the last Tick() for effects and audio
+		std::array<SimEvent, MAX_TICK_EVENTS> events;
+		uint32_t event_count;
+
+		void Reset(uint64_t seed);
+		// Layout is BRICK_COLUMNS * BRICK_ROWS hit points, row 0 at the top
+		void LoadLevel(std::span<const uint8_t> brick_hit_points);
+		void Tick(const TickInput& input);
+		// FNV-1a over everything that influences future ticks
+		uint64_t Hash() const;
+
+		static glm::vec2 BrickCenter(uint32_t brick_idx);
+
+	private:
+		void RestartLevel();
+		void AttachBall();
+		void PushEvent(SimEventType type, glm::vec2 pos);
+		void CollideBricks(Ball& ball);
+		void CollidePaddle(Ball& ball);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+namespace OB3D
+{
+	// Lock free ring buffer for exactly one producer thread and one consumer thread
+	template<typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	public:
+		// Producer side, fails when the queue is full
+		bool TryPush(const T& value)
+		{
+			size_t head = m_Head.load(std::memory_order_relaxed);
+			if (head - m_CachedTail == Capacity)
+			{
+				m_CachedTail = m_Tail.load(std::memory_order_acquire);
+				if (head - m_CachedTail == Capacity)
+				{
+					return false;
+				}
+			}
+
+			m_Items[head & (Capacity - 1)] = value;
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side, fails when the queue is empty
+		bool TryPop(T& out_value)
+		{
+			size_t tail = m_Tail.load(std::memory_order_relaxed);
+			if (tail == m_CachedHead)
+			{
+				m_CachedHead = m_Head.load(std::memory_order_acquire);
+				if (tail == m_CachedHead)
+				{
+					return false;
+				}
+			}
+
+			out_value = m_Items[tail & (Capacity - 1)];
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		// Producer and consumer indices on their own cache lines so the threads don't false share
+		alignas(64) std::atomic<size_t> m_Head = 0;
+		size_t m_CachedTail = 0;
+		alignas(64) std::atomic<size_t> m_Tail = 0;
+		size_t m_CachedHead = 0;
+		alignas(64) std::array<T, Capacity> m_Items = {};
+	};
+}
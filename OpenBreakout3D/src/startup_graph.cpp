@@ -0,0 +1,125 @@
+#include "startup_graph.h"
+
+namespace OB3D
+{
+	static int64_t StartupNowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	StartupStepId StartupGraph::AddStep(std::string_view name, std::initializer_list<StartupStepId> dependencies,
+										std::function<void()>&& function, bool is_main_thread_only)
+	{
+		StartupStepId step_id = StartupStepId(steps.size());
+
+		StartupStep step = {};
+		step.name = name;
+		step.function = std::move(function);
+		step.dependency_count = uint32_t(dependencies.size());
+		step.is_main_thread_only = is_main_thread_only;
+		steps.push_back(std::move(step));
+
+		for (StartupStepId dependency : dependencies)
+		{
+			if (dependency >= step_id)
+			{
+				OB3D_ERROR_OUT("Startup steps can only depend on steps added before them");
+			}
+			steps[dependency].dependents.push_back(step_id);
+		}
+
+		return step_id;
+	}
+
+	void StartupGraph::Run(uint32_t worker_count)
+	{
+		start_ns = StartupNowNs();
+		completed_count = 0;
+		thread_count = worker_count + 1;
+
+		pending_dependencies.clear();
+		for (StartupStepId i = 0; i < steps.size(); i++)
+		{
+			pending_dependencies.push_back(steps[i].dependency_count);
+			if (steps[i].dependency_count == 0)
+			{
+				(steps[i].is_main_thread_only ? ready_main_steps : ready_steps).push_back(i);
+			}
+		}
+
+		std::vector<std::thread> workers;
+		for (uint32_t i = 1; i <= worker_count; i++)
+		{
+			workers.emplace_back(&StartupGraph::WorkLoop, this, i);
+		}
+
+		WorkLoop(0);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		total_ns = StartupNowNs() - start_ns;
+	}
+
+	void StartupGraph::WorkLoop(uint32_t thread_idx)
+	{
+		bool is_main_thread = thread_idx == 0;
+
+		std::unique_lock lock(mutex);
+		while (true)
+		{
+			step_done.wait(lock, [&]()
+				{
+					return completed_count == steps.size() || !ready_steps.empty() || (is_main_thread && !ready_main_steps.empty());
+				});
+
+			if (completed_count == steps.size())
+			{
+				return;
+			}
+
+			// The main thread serves its own queue first, nobody else can
+			std::deque<StartupStepId>& queue = is_main_thread && !ready_main_steps.empty() ? ready_main_steps : ready_steps;
+			StartupStepId step_id = queue.front();
+			queue.pop_front();
+
+			lock.unlock();
+			StartupStep& step = steps[step_id];
+			step.thread_idx = thread_idx;
+			step.start_ns = StartupNowNs() - start_ns;
+			step.function();
+			step.end_ns = StartupNowNs() - start_ns;
+			lock.lock();
+
+			completed_count++;
+			for (StartupStepId dependent : step.dependents)
+			{
+				pending_dependencies[dependent]--;
+				if (pending_dependencies[dependent] == 0)
+				{
+					(steps[dependent].is_main_thread_only ? ready_main_steps : ready_steps).push_back(dependent);
+				}
+			}
+			step_done.notify_all();
+		}
+	}
+
+	void StartupGraph::PrintTimings() const
+	{
+		// Sum of the step durations vs wall time shows what running in parallel saved
+		int64_t serial_ns = 0;
+		for (const StartupStep& step : steps)
+		{
+			serial_ns += step.end_ns - step.start_ns;
+		}
+
+		OB3D_LOG("Startup took {:.2f} ms on {} threads, {:.2f} ms of work", total_ns / 1e6, thread_count, serial_ns / 1e6);
+		for (const StartupStep& step : steps)
+		{
+			OB3D_LOG("  {:<18s} thread {}  {:8.2f} ms -> {:8.2f} ms  ({:.2f} ms)",
+				step.name, step.thread_idx, step.start_ns / 1e6, step.end_ns / 1e6, (step.end_ns - step.start_ns) / 1e6);
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	using StartupStepId = uint32_t;
+
+	struct StartupStep
+	{
+		std::string name;
+		std::function<void()> function;
+		std::vector<StartupStepId> dependents;
+		uint32_t dependency_count;
+		// GLFW calls have to happen on the main thread
+		bool is_main_thread_only;
+
+		// Filled by Run(), relative to the start of the graph
+		int64_t start_ns;
+		int64_t end_ns;
+		uint32_t thread_idx;
+	};
+
+	// Initialization steps with their dependencies, steps whose dependencies are done run in parallel
+	// Dependencies have to be added before the steps that depend on them, so the graph can't have cycles
+	struct StartupGraph
+	{
+		StartupStepId AddStep(std::string_view name, std::initializer_list<StartupStepId> dependencies,
+							  std::function<void()>&& function, bool is_main_thread_only = false);
+		// Blocks until every step has run, the calling thread takes part as thread 0
+		// With 0 workers every step runs on the calling thread, one after another
+		void Run(uint32_t worker_count);
+		void PrintTimings() const;
+
+		std::vector<StartupStep> steps;
+		int64_t total_ns = 0;
+		uint32_t thread_count = 0;
+
+	private:
+		void WorkLoop(uint32_t thread_idx);
+
+		std::mutex mutex;
+		std::condition_variable step_done;
+		std::deque<StartupStepId> ready_steps;
+		std::deque<StartupStepId> ready_main_steps;
+		std::vector<uint32_t> pending_dependencies;
+		size_t completed_count = 0;
+		int64_t start_ns = 0;
+	};
+}
@@ -0,0 +1,250 @@
+#include "transient_image_pool.h"
+
+namespace OB3D
+{
+	// Usage bits that let an image live entirely in tile memory on GPUs with lazily allocated memory
+	constexpr VkImageUsageFlags ATTACHMENT_ONLY_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+														VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+														VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+														VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+	static VkImageAspectFlags AspectFromFormat(VkFormat format)
+	{
+		switch (format)
+		{
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_D32_SFLOAT:
+			case VK_FORMAT_X8_D24_UNORM_PACK32:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	TransientImageHandle TransientImagePool::Declare(const TransientImageDesc& desc)
+	{
+		if (is_built)
+		{
+			OB3D_ERROR_OUT("Transient images must be declared before the pool is built");
+		}
+
+		Entry entry = {};
+		entry.desc = desc;
+		entries.push_back(entry);
+		return TransientImageHandle(entries.size() - 1);
+	}
+
+	bool TransientImagePool::CanJoinGroup(const AliasGroup& group, const Entry& entry) const
+	{
+		if ((group.requirements.memoryTypeBits & entry.requirements.memoryTypeBits) == 0)
+		{
+			return false;
+		}
+
+		for (uint32_t member_idx : group.members)
+		{
+			const TransientImageDesc& other = entries[member_idx].desc;
+			bool overlaps = entry.desc.first_pass <= other.last_pass && other.first_pass <= entry.desc.last_pass;
+			if (overlaps)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void TransientImagePool::Build(VkDevice device, VmaAllocator allocator)
+	{
+		requested_bytes = 0;
+		allocated_bytes = 0;
+		groups.clear();
+
+		std::vector<uint32_t> aliased_entries;
+
+		for (uint32_t i = 0; i < entries.size(); i++)
+		{
+			Entry& entry = entries[i];
+			entry.image.img_format = entry.desc.format;
+			entry.image.img_ext = entry.desc.extent;
+			entry.image.alloc = nullptr;
+			entry.is_lazy = false;
+
+			VkImageCreateInfo img_info = VkConstructors::ImageCreateInfo(entry.desc.format, entry.desc.usage, entry.desc.extent);
+			img_info.mipLevels = entry.desc.mip_levels;
+
+			// Attachment only images never need backing memory on tilers, try lazily allocated memory for those
+			if ((entry.desc.usage & ~ATTACHMENT_ONLY_USAGE) == 0)
+			{
+				img_info.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+				VmaAllocationCreateInfo lazy_alloc_info = {};
+				lazy_alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+				uint32_t memory_type_idx = 0;
+				if (vmaFindMemoryTypeIndexForImageInfo(allocator, &img_info, &lazy_alloc_info, &memory_type_idx) == VK_SUCCESS)
+				{
+					VkResult result = vmaCreateImage(allocator, &img_info, &lazy_alloc_info, &entry.image.img, &entry.image.alloc, nullptr);
+					OB3D_VK_CHECK(result, "Failed to create lazily allocated transient image");
+					entry.is_lazy = true;
+				}
+				else
+				{
+					img_info.usage &= ~VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+				}
+			}
+
+			if (!entry.is_lazy)
+			{
+				VkResult result = vkCreateImage(device, &img_info, nullptr, &entry.image.img);
+				OB3D_VK_CHECK(result, "Failed to create transient image");
+
+				vkGetImageMemoryRequirements(device, entry.image.img, &entry.requirements);
+				requested_bytes += entry.requirements.size;
+				aliased_entries.push_back(i);
+			}
+		}
+
+		// Place the largest images first so smaller ones fill in behind them
+		std::sort(aliased_entries.begin(), aliased_entries.end(), [this](uint32_t a, uint32_t b)
+			{
+				return entries[a].requirements.size > entries[b].requirements.size;
+			});
+
+		for (uint32_t entry_idx : aliased_entries)
+		{
+			Entry& entry = entries[entry_idx];
+
+			uint32_t group_idx = 0;
+			while (group_idx < groups.size() && !CanJoinGroup(groups[group_idx], entry))
+			{
+				group_idx++;
+			}
+
+			if (group_idx == groups.size())
+			{
+				AliasGroup new_group = {};
+				new_group.requirements = entry.requirements;
+				groups.push_back(new_group);
+			}
+
+			AliasGroup& group = groups[group_idx];
+			group.requirements.size = std::max(group.requirements.size, entry.requirements.size);
+			group.requirements.alignment = std::max(group.requirements.alignment, entry.requirements.alignment);
+			group.requirements.memoryTypeBits &= entry.requirements.memoryTypeBits;
+			group.members.push_back(entry_idx);
+			entry.alias_group = group_idx;
+		}
+
+		for (AliasGroup& group : groups)
+		{
+			VmaAllocationCreateInfo group_alloc_info = {};
+			group_alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+			VkResult result = vmaAllocateMemory(allocator, &group.requirements, &group_alloc_info, &group.allocation, nullptr);
+			OB3D_VK_CHECK(result, "Failed to allocate transient image memory");
+			allocated_bytes += group.requirements.size;
+
+			for (uint32_t member_idx : group.members)
+			{
+				result = vmaBindImageMemory(allocator, group.allocation, entries[member_idx].image.img);
+				OB3D_VK_CHECK(result, "Failed to bind transient image memory");
+			}
+		}
+
+		for (Entry& entry : entries)
+		{
+			VkImageAspectFlags aspect = AspectFromFormat(entry.desc.format);
+
+			VkImageViewCreateInfo view_info = VkConstructors::ImageViewCreateInfo(entry.desc.format, entry.image.img, aspect);
+			view_info.subresourceRange.levelCount = entry.desc.mip_levels;
+			VkResult result = vkCreateImageView(device, &view_info, nullptr, &entry.image.img_view);
+			OB3D_VK_CHECK(result, "Failed to create transient image view");
+
+			// Storage image writes need one view per mip
+			entry.mip_views.clear();
+			for (uint32_t mip = 0; entry.desc.mip_levels > 1 && mip < entry.desc.mip_levels; mip++)
+			{
+				VkImageViewCreateInfo mip_view_info = VkConstructors::ImageViewCreateInfo(entry.desc.format, entry.image.img, aspect);
+				mip_view_info.subresourceRange.baseMipLevel = mip;
+
+				VkImageView mip_view;
+				result = vkCreateImageView(device, &mip_view_info, nullptr, &mip_view);
+				OB3D_VK_CHECK(result, "Failed to create transient image mip view");
+				entry.mip_views.push_back(mip_view);
+			}
+		}
+
+		is_built = true;
+		OB3D_LOG("Transient images: {} images in {} memory blocks, {} KiB instead of {} KiB",
+			entries.size(), groups.size(), allocated_bytes / 1024, requested_bytes / 1024);
+	}
+
+	void TransientImagePool::Release(DestroyerQueue& queue)
+	{
+		if (!is_built)
+		{
+			return;
+		}
+
+		// Memory goes first so the queue frees it after the images bound to it
+		for (AliasGroup& group : groups)
+		{
+			Destroyable dstr_memory = {};
+			dstr_memory.allocation = group.allocation;
+			dstr_memory.type = DestroyableVkType::DESTROYABLE_MEMORY;
+			queue.Push(dstr_memory);
+		}
+
+		for (Entry& entry : entries)
+		{
+			Destroyable dstr_img = {};
+			dstr_img.img = entry.image.img;
+			dstr_img.allocation = entry.image.alloc;
+			dstr_img.type = entry.is_lazy ? DestroyableVkType::DESTROYABLE_IMG : DestroyableVkType::DESTROYABLE_RAW_IMG;
+			queue.Push(dstr_img);
+
+			Destroyable dstr_img_view = {};
+			dstr_img_view.img_view = entry.image.img_view;
+			dstr_img_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
+			queue.Push(dstr_img_view);
+
+			for (VkImageView mip_view : entry.mip_views)
+			{
+				Destroyable dstr_mip_view = {};
+				dstr_mip_view.img_view = mip_view;
+				dstr_mip_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
+				queue.Push(dstr_mip_view);
+			}
+			entry.mip_views.clear();
+		}
+
+		groups.clear();
+		is_built = false;
+	}
+
+	void TransientImagePool::Clear()
+	{
+		if (is_built)
+		{
+			OB3D_ERROR_OUT("Transient image pool must be released before it is cleared");
+		}
+
+		entries.clear();
+	}
+
+	const AllocatedImage& TransientImagePool::Get(TransientImageHandle handle) const
+	{
+		return entries[handle].image;
+	}
+
+	VkImageView TransientImagePool::GetMipView(TransientImageHandle handle, uint32_t mip) const
+	{
+		const Entry& entry = entries[handle];
+		return entry.mip_views.empty() ? entry.image.img_view : entry.mip_views[mip];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include "util.h"
+#include "vk_constructors.h"
+#include "vk_types.h"
+#include "destroyer_queue.h"
+
+namespace OB3D
+{
+	struct TransientImageDesc
+	{
+		VkFormat format;
+		VkExtent3D extent;
+		VkImageUsageFlags usage;
+		uint32_t mip_levels = 1;
+		// Range of passes within a frame that touch the image, inclusive
+		// Images whose ranges don't overlap can share memory
+		uint32_t first_pass;
+		uint32_t last_pass;
+	};
+
+	using TransientImageHandle = uint32_t;
+
+	// Intermediate render targets that only live within a frame
+	// Contents never survive past last_pass: the first pass using an image must transition it from
+	// VK_IMAGE_LAYOUT_UNDEFINED since another image may have written the same memory in between
+	struct TransientImagePool
+	{
+		TransientImageHandle Declare(const TransientImageDesc& desc);
+		void Build(VkDevice device, VmaAllocator allocator);
+		// Hands every image and memory block to the queue
+		void Release(DestroyerQueue& queue);
+		// Drops all declarations, e.g. before redeclaring at a new size
+		void Clear();
+
+		const AllocatedImage& Get(TransientImageHandle handle) const;
+		VkImageView GetMipView(TransientImageHandle handle, uint32_t mip) const;
+
+		struct Entry
+		{
+			TransientImageDesc desc;
+			AllocatedImage image;
+			std::vector<VkImageView> mip_views;
+			VkMemoryRequirements requirements;
+			uint32_t alias_group;
+			bool is_lazy;
+		};
+
+		struct AliasGroup
+		{
+			VkMemoryRequirements requirements;
+			std::vector<uint32_t> members;
+			VmaAllocation allocation;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<AliasGroup> groups;
+		bool is_built = false;
+
+		// Memory the images would need without aliasing vs what was actually allocated
+		VkDeviceSize requested_bytes = 0;
+		VkDeviceSize allocated_bytes = 0;
+
+	private:
+		bool CanJoinGroup(const AliasGroup& group, const Entry& entry) const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "util.h"
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace OB3D
+{
+#if defined(__GNUC__) || defined(__clang__)
+	#define OB3D_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+	#define OB3D_COLD __declspec(noinline)
+#else
+	#define OB3D_COLD
+#endif
+
+	OB3D_COLD void ReportFatalError(std::string_view message, const char* file, int line)
+	{
+		fmt::println(stderr, "{:s}:{}: {:s}", file, line, message);
+		std::abort();
+	}
+
+	OB3D_COLD void ReportVkError(VkResult result, std::string_view message, const char* file, int line)
+	{
+		fmt::println(stderr, "{:s}:{}: {:s} ({:s})", file, line, message, string_VkResult(result));
+		std::abort();
+	}
+
+	std::string ExecutableRelativePath(std::string_view relative_path)
+	{
+		std::filesystem::path path(relative_path);
+		if (path.is_absolute())
+		{
+			return std::string(relative_path);
+		}
+
+		std::error_code error;
+#ifdef _WIN32
+		std::array<wchar_t, MAX_PATH> module_path = {};
+		DWORD length = GetModuleFileNameW(nullptr, module_path.data(), DWORD(module_path.size()));
+		std::filesystem::path executable = length > 0 && length < module_path.size() ? std::filesystem::path(module_path.data()) : std::filesystem::path();
+#else
+		std::filesystem::path executable = std::filesystem::read_symlink("/proc/self/exe", error);
+#endif
+		if (error || executable.empty())
+		{
+			return std::string(relative_path);
+		}
+		return (executable.parent_path() / path).string();
+	}
+}
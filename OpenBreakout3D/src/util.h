@@ -2,11 +2,22 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <span>
 #include <array>
 #include <functional>
 #include <deque>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
 
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_enum_string_helper.h>
@@ -15,7 +26,39 @@
 #include <fmt/core.h>
 
 #include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
-#define OB3D_ERROR_OUT(s) fmt::println("{:s}", s); abort();
-#define OB3D_VK_CHECK(r, s) if(r != VK_SUCCESS){ OB3D_ERROR_OUT(s); }
\ No newline at end of file
+namespace OB3D
+{
+	// Set by the OB3D_FAST_RELEASE CMake option, no validation layers, no debug messenger and no logging
+#ifdef OB3D_FAST_RELEASE
+	constexpr bool ENABLE_VALIDATION = false;
+	constexpr bool ENABLE_LOGGING = false;
+#else
+	constexpr bool ENABLE_VALIDATION = true;
+	constexpr bool ENABLE_LOGGING = true;
+#endif
+
+	// Out of line so the checks stay a compare and a branch at the call site
+	[[noreturn]] void ReportFatalError(std::string_view message, const char* file, int line);
+	[[noreturn]] void ReportVkError(VkResult result, std::string_view message, const char* file, int line);
+
+	// relative_path inside the executable's directory, so default files are found whatever directory the game is started from
+	// Left as is when it is absolute or the executable's location can't be found
+	std::string ExecutableRelativePath(std::string_view relative_path);
+}
+
+// Informational output, compiled out of fast release builds. Errors are always reported
+#define OB3D_LOG(...) do { if constexpr (OB3D::ENABLE_LOGGING) { fmt::println(__VA_ARGS__); } } while (0)
+
+#define OB3D_ERROR_OUT(s) OB3D::ReportFatalError(s, __FILE__, __LINE__)
+#define OB3D_VK_CHECK(r, s)                                                    \
+	do                                                                         \
+	{                                                                          \
+		VkResult ob3d_check_result = (r);                                      \
+		if (ob3d_check_result != VK_SUCCESS) [[unlikely]]                      \
+		{                                                                      \
+			OB3D::ReportVkError(ob3d_check_result, s, __FILE__, __LINE__);     \
+		}                                                                      \
+	} while (0)
@@ -154,6 +154,80 @@ namespace OB3D
 			return create_info_img_view;
 		}
 
+		VkBufferCreateInfo BufferCreateInfo(VkDeviceSize size, VkBufferUsageFlags usage_flags)
+		{
+			VkBufferCreateInfo create_info_buffer = {};
+			create_info_buffer.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			create_info_buffer.pNext = nullptr;
+
+			create_info_buffer.size = size;
+			create_info_buffer.usage = usage_flags;
+			create_info_buffer.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			return create_info_buffer;
+		}
+
+		VkPipelineShaderStageCreateInfo PipelineShaderStageCreateInfo(VkShaderStageFlagBits stage, VkShaderModule shader_module)
+		{
+			VkPipelineShaderStageCreateInfo create_info_stage = {};
+			create_info_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			create_info_stage.pNext = nullptr;
+
+			create_info_stage.stage = stage;
+			create_info_stage.module = shader_module;
+			create_info_stage.pName = "main";
+
+			return create_info_stage;
+		}
+
+		VkPipelineLayoutCreateInfo PipelineLayoutCreateInfo(VkDescriptorSetLayout* set_layouts, uint32_t set_layout_count, VkPushConstantRange* push_constant_range)
+		{
+			VkPipelineLayoutCreateInfo create_info_layout = {};
+			create_info_layout.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			create_info_layout.pNext = nullptr;
+
+			create_info_layout.pSetLayouts = set_layouts;
+			create_info_layout.setLayoutCount = set_layout_count;
+			create_info_layout.pPushConstantRanges = push_constant_range;
+			create_info_layout.pushConstantRangeCount = push_constant_range == nullptr ? 0 : 1;
+
+			return create_info_layout;
+		}
+
+		VkRenderingAttachmentInfo AttachmentInfo(VkImageView view, VkClearValue* clear, VkImageLayout layout)
+		{
+			VkRenderingAttachmentInfo attachment_info = {};
+			attachment_info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			attachment_info.pNext = nullptr;
+
+			attachment_info.imageView = view;
+			attachment_info.imageLayout = layout;
+			attachment_info.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachment_info.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			if (clear)
+			{
+				attachment_info.clearValue = *clear;
+			}
+
+			return attachment_info;
+		}
+
+		VkRenderingInfo RenderingInfo(VkExtent2D render_extent, VkRenderingAttachmentInfo* color_attachment, VkRenderingAttachmentInfo* depth_attachment)
+		{
+			VkRenderingInfo rendering_info = {};
+			rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			rendering_info.pNext = nullptr;
+
+			rendering_info.renderArea = VkRect2D{ VkOffset2D{ 0, 0 }, render_extent };
+			rendering_info.layerCount = 1;
+			rendering_info.colorAttachmentCount = color_attachment == nullptr ? 0 : 1;
+			rendering_info.pColorAttachments = color_attachment;
+			rendering_info.pDepthAttachment = depth_attachment;
+			rendering_info.pStencilAttachment = nullptr;
+
+			return rendering_info;
+		}
+
 		// Builder Classes
 
 		void DescriptorLayoutBuilder::AddBinding(uint32_t binding, VkDescriptorType type)
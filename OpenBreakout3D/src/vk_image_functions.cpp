@@ -18,7 +18,9 @@ namespace OB3D
 			img_barrier.oldLayout = current_layout;
 			img_barrier.newLayout = new_layout;
 
-			VkImageAspectFlags aspect_mask = (new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+			bool is_depth = new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || new_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL
+							|| current_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || current_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+			VkImageAspectFlags aspect_mask = is_depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
 			img_barrier.subresourceRange = VkConstructors::ImageSubresourceRange(aspect_mask);
 			img_barrier.image = img;
 
@@ -67,5 +69,53 @@ namespace OB3D
 
 			vkCmdBlitImage2(cmd, &blit_img_info);
 		}
+
+		void CopyImageToBuffer(VkCommandBuffer cmd, VkImage source, VkImageLayout source_layout, VkBuffer destination, VkExtent2D src_ext)
+		{
+			VkBufferImageCopy2 copy_region = {};
+			copy_region.sType = VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2;
+			copy_region.pNext = nullptr;
+
+			// 0 row length and height pack the rows tightly
+			copy_region.bufferOffset = 0;
+			copy_region.bufferRowLength = 0;
+			copy_region.bufferImageHeight = 0;
+
+			copy_region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			copy_region.imageSubresource.baseArrayLayer = 0;
+			copy_region.imageSubresource.layerCount = 1;
+			copy_region.imageSubresource.mipLevel = 0;
+			copy_region.imageExtent = { src_ext.width, src_ext.height, 1 };
+
+			VkCopyImageToBufferInfo2 copy_info = {};
+			copy_info.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_TO_BUFFER_INFO_2;
+			copy_info.pNext = nullptr;
+			copy_info.srcImage = source;
+			copy_info.srcImageLayout = source_layout;
+			copy_info.dstBuffer = destination;
+			copy_info.regionCount = 1;
+			copy_info.pRegions = &copy_region;
+
+			vkCmdCopyImageToBuffer2(cmd, &copy_info);
+		}
+
+		void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access)
+		{
+			VkMemoryBarrier2 memory_barrier = {};
+			memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+			memory_barrier.pNext = nullptr;
+
+			memory_barrier.srcStageMask = src_stage;
+			memory_barrier.srcAccessMask = src_access;
+			memory_barrier.dstStageMask = dst_stage;
+			memory_barrier.dstAccessMask = dst_access;
+
+			VkDependencyInfo dep_info = {};
+			dep_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			dep_info.pNext = nullptr;
+			dep_info.memoryBarrierCount = 1;
+			dep_info.pMemoryBarriers = &memory_barrier;
+			vkCmdPipelineBarrier2(cmd, &dep_info);
+		}
 	}
 }
\ No newline at end of file
@@ -7,5 +7,9 @@ namespace OB3D
 	{
 		void TransitionImage(VkCommandBuffer cmd, VkImage img, VkImageLayout current_layout, VkImageLayout new_layout);
 		void CopyImageToImage(VkCommandBuffer cmd, VkImage source, VkImage destination, VkExtent2D src_ext, VkExtent2D dst_ext);
+		// Whole color image into tightly packed rows at the start of the buffer
+		void CopyImageToBuffer(VkCommandBuffer cmd, VkImage source, VkImageLayout source_layout, VkBuffer destination, VkExtent2D src_ext);
+		// Memory barrier over every buffer, drivers don't do anything finer grained with per buffer barriers
+		void GlobalBarrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access);
 	}
 }
\ No newline at end of file
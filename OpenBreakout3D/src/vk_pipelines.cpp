@@ -0,0 +1,282 @@
+#include "vk_pipelines.h"
+#include <fstream>
+
+namespace OB3D
+{
+	namespace VkPipelines
+	{
+		bool LoadShaderModule(const char* file_path, VkDevice device, VkShaderModule* out_shader_module)
+		{
+			// open the file with the cursor at the end so its size is known up front
+			std::ifstream file(file_path, std::ios::ate | std::ios::binary);
+			if (!file.is_open())
+			{
+				return false;
+			}
+
+			size_t file_size = (size_t)file.tellg();
+
+			// SPIR-V expects the buffer to be on uint32
+			std::vector<uint32_t> buffer(file_size / sizeof(uint32_t));
+
+			file.seekg(0);
+			file.read((char*)buffer.data(), file_size);
+			file.close();
+
+			return CreateShaderModule(buffer, device, out_shader_module);
+		}
+
+		bool CreateShaderModule(std::span<const uint32_t> code, VkDevice device, VkShaderModule* out_shader_module)
+		{
+			if (code.empty())
+			{
+				return false;
+			}
+
+			VkShaderModuleCreateInfo create_info_shader = {};
+			create_info_shader.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			create_info_shader.pNext = nullptr;
+			create_info_shader.codeSize = code.size_bytes();
+			create_info_shader.pCode = code.data();
+
+			VkShaderModule shader_module;
+			if (vkCreateShaderModule(device, &create_info_shader, nullptr, &shader_module) != VK_SUCCESS)
+			{
+				return false;
+			}
+
+			*out_shader_module = shader_module;
+			return true;
+		}
+
+		SpecializationConstants& SpecializationConstants::Add(uint32_t value)
+		{
+			VkSpecializationMapEntry entry = {};
+			entry.constantID = uint32_t(entries.size());
+			entry.offset = uint32_t(values.size() * sizeof(uint32_t));
+			entry.size = sizeof(uint32_t);
+
+			entries.push_back(entry);
+			values.push_back(value);
+			return *this;
+		}
+
+		SpecializationConstants& SpecializationConstants::Add(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return Add(bits);
+		}
+
+		VkSpecializationInfo SpecializationConstants::Info() const
+		{
+			VkSpecializationInfo info = {};
+			info.mapEntryCount = uint32_t(entries.size());
+			info.pMapEntries = entries.data();
+			info.dataSize = values.size() * sizeof(uint32_t);
+			info.pData = values.data();
+			return info;
+		}
+
+		VkPipeline CreateComputePipeline(VkDevice device, VkPipelineLayout layout, VkShaderModule shader_module,
+										 const VkSpecializationInfo* specialization, uint32_t required_subgroup_size,
+										 VkPipelineShaderStageCreateFlags stage_flags)
+		{
+			VkPipelineShaderStageRequiredSubgroupSizeCreateInfo subgroup_size_info = {};
+			subgroup_size_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_REQUIRED_SUBGROUP_SIZE_CREATE_INFO;
+			subgroup_size_info.pNext = nullptr;
+			subgroup_size_info.requiredSubgroupSize = required_subgroup_size;
+
+			VkComputePipelineCreateInfo create_info_pipeline = {};
+			create_info_pipeline.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			create_info_pipeline.pNext = nullptr;
+			create_info_pipeline.layout = layout;
+			create_info_pipeline.stage = VkConstructors::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, shader_module);
+			create_info_pipeline.stage.flags = stage_flags;
+			create_info_pipeline.stage.pSpecializationInfo = specialization;
+			create_info_pipeline.stage.pNext = required_subgroup_size != 0 ? &subgroup_size_info : nullptr;
+
+			VkPipeline pipeline;
+			VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &create_info_pipeline, nullptr, &pipeline);
+			OB3D_VK_CHECK(result, "Failed to create compute pipeline");
+
+			return pipeline;
+		}
+
+		void PipelineBuilder::Clear()
+		{
+			input_assembly = { .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+			rasterizer = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+			color_blend_attachment = {};
+			multisampling = { .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+			depth_stencil = { .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+			render_info = { .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
+			color_attachment_format = VK_FORMAT_UNDEFINED;
+			pipeline_layout = VK_NULL_HANDLE;
+			shader_stages.clear();
+		}
+
+		void PipelineBuilder::SetShaders(VkShaderModule vertex_shader, VkShaderModule fragment_shader)
+		{
+			shader_stages.clear();
+			shader_stages.push_back(VkConstructors::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader));
+			shader_stages.push_back(VkConstructors::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragment_shader));
+		}
+
+		void PipelineBuilder::SetVertexShader(VkShaderModule vertex_shader)
+		{
+			shader_stages.clear();
+			shader_stages.push_back(VkConstructors::PipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertex_shader));
+		}
+
+		void PipelineBuilder::SetInputTopology(VkPrimitiveTopology topology)
+		{
+			input_assembly.topology = topology;
+			input_assembly.primitiveRestartEnable = VK_FALSE;
+		}
+
+		void PipelineBuilder::SetPolygonMode(VkPolygonMode mode)
+		{
+			rasterizer.polygonMode = mode;
+			rasterizer.lineWidth = 1.0f;
+		}
+
+		void PipelineBuilder::SetCullMode(VkCullModeFlags cull_mode, VkFrontFace front_face)
+		{
+			rasterizer.cullMode = cull_mode;
+			rasterizer.frontFace = front_face;
+		}
+
+		void PipelineBuilder::SetDepthBias(float constant_factor, float slope_factor)
+		{
+			rasterizer.depthBiasEnable = VK_TRUE;
+			rasterizer.depthBiasConstantFactor = constant_factor;
+			rasterizer.depthBiasSlopeFactor = slope_factor;
+			rasterizer.depthBiasClamp = 0.0f;
+		}
+
+		void PipelineBuilder::SetMultisamplingNone()
+		{
+			multisampling.sampleShadingEnable = VK_FALSE;
+			multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+			multisampling.minSampleShading = 1.0f;
+			multisampling.pSampleMask = nullptr;
+			multisampling.alphaToCoverageEnable = VK_FALSE;
+			multisampling.alphaToOneEnable = VK_FALSE;
+		}
+
+		void PipelineBuilder::DisableBlending()
+		{
+			color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+													VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			color_blend_attachment.blendEnable = VK_FALSE;
+		}
+
+		void PipelineBuilder::EnableBlendingAdditive()
+		{
+			color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+													VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+			color_blend_attachment.blendEnable = VK_TRUE;
+			color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+			color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+			color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+			color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+			color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+		}
+
+		void PipelineBuilder::DisableColorWrites()
+		{
+			color_blend_attachment.colorWriteMask = 0;
+			color_blend_attachment.blendEnable = VK_FALSE;
+		}
+
+		void PipelineBuilder::SetColorAttachmentFormat(VkFormat format)
+		{
+			color_attachment_format = format;
+			render_info.colorAttachmentCount = 1;
+			render_info.pColorAttachmentFormats = &color_attachment_format;
+		}
+
+		void PipelineBuilder::SetDepthFormat(VkFormat format)
+		{
+			render_info.depthAttachmentFormat = format;
+		}
+
+		void PipelineBuilder::DisableDepthTest()
+		{
+			depth_stencil.depthTestEnable = VK_FALSE;
+			depth_stencil.depthWriteEnable = VK_FALSE;
+			depth_stencil.depthCompareOp = VK_COMPARE_OP_NEVER;
+			depth_stencil.depthBoundsTestEnable = VK_FALSE;
+			depth_stencil.stencilTestEnable = VK_FALSE;
+			depth_stencil.front = {};
+			depth_stencil.back = {};
+			depth_stencil.minDepthBounds = 0.0f;
+			depth_stencil.maxDepthBounds = 1.0f;
+		}
+
+		void PipelineBuilder::EnableDepthTest(bool depth_write, VkCompareOp op)
+		{
+			depth_stencil.depthTestEnable = VK_TRUE;
+			depth_stencil.depthWriteEnable = depth_write ? VK_TRUE : VK_FALSE;
+			depth_stencil.depthCompareOp = op;
+			depth_stencil.depthBoundsTestEnable = VK_FALSE;
+			depth_stencil.stencilTestEnable = VK_FALSE;
+			depth_stencil.front = {};
+			depth_stencil.back = {};
+			depth_stencil.minDepthBounds = 0.0f;
+			depth_stencil.maxDepthBounds = 1.0f;
+		}
+
+		VkPipeline PipelineBuilder::Build(VkDevice device)
+		{
+			// Dynamic viewport and scissor, only the counts are baked in
+			VkPipelineViewportStateCreateInfo viewport_state = {};
+			viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewport_state.pNext = nullptr;
+			viewport_state.viewportCount = 1;
+			viewport_state.scissorCount = 1;
+
+			VkPipelineColorBlendStateCreateInfo color_blending = {};
+			color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			color_blending.pNext = nullptr;
+			color_blending.logicOpEnable = VK_FALSE;
+			color_blending.logicOp = VK_LOGIC_OP_COPY;
+			color_blending.attachmentCount = render_info.colorAttachmentCount;
+			color_blending.pAttachments = &color_blend_attachment;
+
+			// Vertices are pulled from buffers through their device addresses
+			VkPipelineVertexInputStateCreateInfo vertex_input_info = {};
+			vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+			std::array<VkDynamicState, 2> dynamic_states = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+			VkPipelineDynamicStateCreateInfo dynamic_info = {};
+			dynamic_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamic_info.dynamicStateCount = (uint32_t)dynamic_states.size();
+			dynamic_info.pDynamicStates = dynamic_states.data();
+
+			VkGraphicsPipelineCreateInfo create_info_pipeline = {};
+			create_info_pipeline.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+			// Dynamic rendering, the attachment formats replace the render pass
+			create_info_pipeline.pNext = &render_info;
+			create_info_pipeline.stageCount = (uint32_t)shader_stages.size();
+			create_info_pipeline.pStages = shader_stages.data();
+			create_info_pipeline.pVertexInputState = &vertex_input_info;
+			create_info_pipeline.pInputAssemblyState = &input_assembly;
+			create_info_pipeline.pViewportState = &viewport_state;
+			create_info_pipeline.pRasterizationState = &rasterizer;
+			create_info_pipeline.pMultisampleState = &multisampling;
+			create_info_pipeline.pColorBlendState = &color_blending;
+			create_info_pipeline.pDepthStencilState = &depth_stencil;
+			create_info_pipeline.pDynamicState = &dynamic_info;
+			create_info_pipeline.layout = pipeline_layout;
+
+			VkPipeline pipeline;
+			VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &create_info_pipeline, nullptr, &pipeline);
+			OB3D_VK_CHECK(result, "Failed to create graphics pipeline");
+
+			return pipeline;
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "util.h"
+#include "vk_constructors.h"
+
+namespace OB3D
+{
+	namespace VkPipelines
+	{
+		bool LoadShaderModule(const char* file_path, VkDevice device, VkShaderModule* out_shader_module);
+		// Creates the module straight from SPIR-V already in memory, e.g. a mapped asset pack
+		bool CreateShaderModule(std::span<const uint32_t> code, VkDevice device, VkShaderModule* out_shader_module);
+
+		// 32 bit specialization constants, the n-th value added is constant_id n
+		struct SpecializationConstants
+		{
+			std::vector<VkSpecializationMapEntry> entries;
+			std::vector<uint32_t> values;
+
+			SpecializationConstants& Add(uint32_t value);
+			SpecializationConstants& Add(float value);
+			// Points into entries and values, only valid while this object is alive and unchanged
+			VkSpecializationInfo Info() const;
+		};
+
+		// required_subgroup_size pins the subgroup size, 0 leaves it to the driver
+		// stage_flags e.g. VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT for kernels that index by subgroup
+		VkPipeline CreateComputePipeline(VkDevice device, VkPipelineLayout layout, VkShaderModule shader_module,
+										 const VkSpecializationInfo* specialization = nullptr, uint32_t required_subgroup_size = 0,
+										 VkPipelineShaderStageCreateFlags stage_flags = 0);
+
+		// Graphics pipelines for dynamic rendering, viewport and scissor are always dynamic state
+		struct PipelineBuilder
+		{
+			std::vector<VkPipelineShaderStageCreateInfo> shader_stages;
+			VkPipelineInputAssemblyStateCreateInfo input_assembly;
+			VkPipelineRasterizationStateCreateInfo rasterizer;
+			VkPipelineColorBlendAttachmentState color_blend_attachment;
+			VkPipelineMultisampleStateCreateInfo multisampling;
+			VkPipelineDepthStencilStateCreateInfo depth_stencil;
+			VkPipelineRenderingCreateInfo render_info;
+			VkFormat color_attachment_format;
+			VkPipelineLayout pipeline_layout;
+
+			PipelineBuilder() { Clear(); }
+
+			void Clear();
+			void SetShaders(VkShaderModule vertex_shader, VkShaderModule fragment_shader);
+			// No fragment stage, for depth only passes
+			void SetVertexShader(VkShaderModule vertex_shader);
+			void SetInputTopology(VkPrimitiveTopology topology);
+			void SetPolygonMode(VkPolygonMode mode);
+			void SetCullMode(VkCullModeFlags cull_mode, VkFrontFace front_face);
+			// Pushes depth away from the viewer by a constant plus a share of the polygon's slope
+			void SetDepthBias(float constant_factor, float slope_factor);
+			void SetMultisamplingNone();
+			void DisableBlending();
+			// dst + src * src_alpha, for glowing effects drawn into the HDR target
+			void EnableBlendingAdditive();
+			// Keeps the color attachment bound but never writes it, e.g. in a depth prepass
+			void DisableColorWrites();
+			void SetColorAttachmentFormat(VkFormat format);
+			void SetDepthFormat(VkFormat format);
+			void DisableDepthTest();
+			void EnableDepthTest(bool depth_write, VkCompareOp op);
+
+			VkPipeline Build(VkDevice device);
+		};
+	}
+}
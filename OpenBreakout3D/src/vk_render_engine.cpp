@@ -6,15 +6,87 @@
 #include "vk_mem_alloc.h"
 
 #include "vk_render_engine.h"
+#include "shader_registry.h"
 
 namespace OB3D
 {
     RenderEngine *loaded_engine = nullptr;
 
-    void RenderEngine::Init()
+    // Floor for the render scale when reacting to memory pressure
+    constexpr float MIN_RENDER_SCALE = 0.5f;
+    constexpr float RENDER_SCALE_STEP = 0.25f;
+    // VMA refreshes its budget numbers about this often, no point in checking more frequently
+    constexpr int BUDGET_CHECK_INTERVAL = 30;
+
+    // The graph never gets wider than this
+    constexpr uint32_t MAX_STARTUP_WORKERS = 4;
+
+    // Longest stretch of time simulated in one frame, after a stall the simulation slows down instead of spiralling
+    constexpr int64_t MAX_SIM_CATCHUP_TICKS = 8;
+
+    void RenderEngine::Init(const EngineConfig& config)
     {
         assert(loaded_engine == nullptr);
         loaded_engine = this;
+        m_Config = config;
+
+        m_Width = 800;
+        m_Height = 600;
+
+        // Steps only wait on what they actually use, the slow instance build overlaps window creation
+        // and asset loading, and everything that only needs the device runs side by side
+        vkb::Instance vkb_inst;
+        StartupGraph startup;
+
+        StartupStepId window = startup.AddStep("window", {}, [this]() { InitWindow(); }, true);
+        StartupStepId simulation = startup.AddStep("assets+simulation", {}, [this]() { InitSimulation(); });
+        StartupStepId instance = startup.AddStep("instance", {}, [&]() { InitInstance(vkb_inst); });
+        StartupStepId surface = startup.AddStep("surface", { window, instance }, [this]() { InitSurface(); }, true);
+        StartupStepId device = startup.AddStep("device", { instance, surface }, [&]() { InitDevice(vkb_inst); });
+        StartupStepId swapchain = startup.AddStep("swapchain", { device }, [this]() { InitSwapchain(); });
+        StartupStepId commands = startup.AddStep("commands", { device }, [this]() { InitCommands(); });
+        StartupStepId sync = startup.AddStep("sync", { device }, [this]() { InitSyncStructs(); });
+        startup.AddStep("frame allocators", { device }, [this]() { InitFrameAllocators(); });
+        startup.AddStep("gpu timer", { device }, [this]() { InitGpuTimer(); });
+        startup.AddStep("particles", { device }, [this]() { InitParticles(); });
+        StartupStepId shadow_map = startup.AddStep("shadow map", { device }, [this]() { InitShadowMap(); });
+        StartupStepId descriptors = startup.AddStep("descriptors", { swapchain, shadow_map }, [this]() { InitDescriptors(); });
+        startup.AddStep("pipelines", { descriptors, simulation }, [this]() { InitPipelines(); });
+        startup.AddStep("mesh upload", { commands, sync, simulation }, [this]() { InitAssets(); });
+
+        uint32_t worker_count = 0;
+        if (!m_Config.serial_init)
+        {
+            worker_count = std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, MAX_STARTUP_WORKERS);
+        }
+        startup.Run(worker_count);
+        startup.PrintTimings();
+
+        // The scene is built from the pack's cube, without a pack there is nothing to draw it with
+        m_SceneMesh = FindMesh("cube");
+        if (m_SceneMesh == nullptr)
+        {
+            OB3D_LOG("No cube mesh, the scene pass is off");
+        }
+
+        // Needs the whole engine, kernels missing from the tuning file are only timed on their first launch
+        if (!m_Config.tuning_path.empty())
+        {
+            AutotuneKernels();
+        }
+
+        m_FrameCapture.Start(m_Config);
+        m_Audio.Start(m_Config);
+
+        m_IsInitialized = true;
+    }
+
+    void RenderEngine::InitWindow()
+    {
+        if (m_Config.headless)
+        {
+            return;
+        }
 
         if (!glfwInit())
         {
@@ -25,8 +97,8 @@ namespace OB3D
         glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
         m_Window = glfwCreateWindow(
-            800,
-            600,
+            m_Width,
+            m_Height,
             "Open Breakout 3D",
             nullptr,
             nullptr);
@@ -36,34 +108,59 @@ namespace OB3D
             OB3D_ERROR_OUT("GLFW failed to create window");
         }
 
-        m_Width = 800;
-        m_Height = 600;
+        Input::InstallCallbacks(m_Window, &m_InputQueue);
+    }
 
-        // Vulkan Initialization
-        InitVulkan();
-        InitSwapchain();
-        InitCommands();
-        InitSyncStructs();
-        InitDescriptors();
-        m_IsInitialized = true;
+    void RenderEngine::InitSimulation()
+    {
+        // Assets
+        //  Mapping is cheap, the pages load while Vulkan initializes
+        if (!m_AssetPack.Open(m_Config.pack_path.c_str()))
+        {
+            OB3D_LOG("No asset pack at {:s}, using built in assets", m_Config.pack_path);
+        }
+        else if (m_Config.verify_pack && !m_AssetPack.VerifyAll())
+        {
+            OB3D_ERROR_OUT("Asset pack failed verification");
+        }
+
+        // Simulation
+        uint64_t seed = m_Config.seed != 0 ? m_Config.seed : uint64_t(Input::NowNs());
+        m_World.Reset(seed);
+        if (m_AssetPack.IsOpen() && !LoadLevel(m_Config.level_name))
+        {
+            OB3D_LOG("Asset pack has no level {:s}, using the default layout", m_Config.level_name);
+        }
+        if (!m_Config.record_path.empty())
+        {
+            // A frame limited run can't simulate more than this, open ended ones grow the storage as they go
+            size_t expected_tick_count = m_Config.frame_limit != 0 ? size_t(m_Config.frame_limit) * MAX_SIM_CATCHUP_TICKS : 0;
+            m_Recorder.Begin(m_World, seed, expected_tick_count);
+        }
     }
 
-    void RenderEngine::InitVulkan()
+    void RenderEngine::InitInstance(vkb::Instance& vkb_inst)
     {
         // Instance and Messenger
         vkb::InstanceBuilder instance_builder;
-        auto built_inst = instance_builder.set_app_name("OpenBreakout3D")
-                              .request_validation_layers(true)
-                              .use_default_debug_messenger()
-                              .require_api_version(1, 4, 0)
-                              .build();
+        instance_builder.set_app_name("OpenBreakout3D")
+                        .request_validation_layers(ENABLE_VALIDATION)
+                        .require_api_version(1, 4, 0)
+                        .set_headless(m_Config.headless);
+
+        if constexpr (ENABLE_VALIDATION)
+        {
+            instance_builder.use_default_debug_messenger();
+        }
+
+        auto built_inst = instance_builder.build();
 
         if (!built_inst)
         {
             OB3D_ERROR_OUT("Failed to create vk instance!");
         }
-        vkb::Instance vkb_inst = built_inst.value();
-        fmt::println("VkInstance created successfully");
+        vkb_inst = built_inst.value();
+        OB3D_LOG("VkInstance created successfully");
 
         // Grab instance from vkb and instantiate the Vulkan one
         m_Instance = vkb_inst.instance;
@@ -73,27 +170,90 @@ namespace OB3D
         dstr_inst.inst = m_Instance;
         dstr_inst.type = DestroyableVkType::DESTROYABLE_INSTANCE;
         global_queue.Push(dstr_inst);
-        Destroyable dstr_dbg;
-        dstr_dbg.dbg_msg = m_DbgMessenger;
-        dstr_dbg.type = DestroyableVkType::DESTROYABLE_DBG_MESSENGER;
-        global_queue.Push(dstr_dbg);
+        if (m_DbgMessenger != VK_NULL_HANDLE)
+        {
+            Destroyable dstr_dbg;
+            dstr_dbg.dbg_msg = m_DbgMessenger;
+            dstr_dbg.type = DestroyableVkType::DESTROYABLE_DBG_MESSENGER;
+            global_queue.Push(dstr_dbg);
+        }
+    }
+
+    void RenderEngine::InitSurface()
+    {
+        if (m_Config.headless)
+        {
+            return;
+        }
 
         // Get surface from GLFW
         VkResult result = glfwCreateWindowSurface(m_Instance, m_Window, nullptr, &m_Surface);
         OB3D_VK_CHECK(result, "Failed to create vk surface!");
-        fmt::println("SurfaceKHR created successfully");
+        OB3D_LOG("SurfaceKHR created successfully");
 
         Destroyable dstr_surf;
         dstr_surf.surface = m_Surface;
         dstr_surf.type = DestroyableVkType::DESTROYABLE_SURFACE;
         global_queue.Push(dstr_surf);
+    }
+
+    // First format in the list with all the features, D16 is the one every device has to support for depth
+    static VkFormat FindDepthFormat(VkPhysicalDevice physical, std::span<const VkFormat> candidates, VkFormatFeatureFlags features)
+    {
+        for (VkFormat format : candidates)
+        {
+            VkFormatProperties format_props = {};
+            vkGetPhysicalDeviceFormatProperties(physical, format, &format_props);
+            if ((format_props.optimalTilingFeatures & features) == features)
+            {
+                return format;
+            }
+        }
+        return VK_FORMAT_D16_UNORM;
+    }
 
+    // Main view depth wants the precision, the shadow map's orthographic depth is linear and fine at 16 bits
+    constexpr std::array<VkFormat, 2> SCENE_DEPTH_FORMATS = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM };
+    constexpr std::array<VkFormat, 2> SHADOW_MAP_FORMATS = { VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT };
+
+    // Vulkan format and name of each DrawFormat
+    constexpr std::array<VkFormat, 3> DRAW_FORMATS = { VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_B10G11R11_UFLOAT_PACK32, VK_FORMAT_R8G8B8A8_UNORM };
+    constexpr std::array<std::string_view, 3> DRAW_FORMAT_NAMES = { "RGBA16F", "B10G11R11_UFLOAT", "RGBA8" };
+    // Suffix of the shader variants declaring the draw image with the format's qualifier, see Shaders/CMakeLists.txt
+    constexpr std::array<std::string_view, 3> DRAW_FORMAT_SHADER_SUFFIXES = { "rgba16f", "r11g11b10f", "rgba8" };
+
+    // Every pass that writes or reads the draw image can use the format. The shaders declare it with the format's
+    // qualifier, so it only has to be a storage format, not one accessible without a format
+    static bool IsDrawFormatUsable(VkPhysicalDevice physical, VkFormat format)
+    {
+        VkFormatProperties3 format_props3 = {};
+        format_props3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+        VkFormatProperties2 format_props = {};
+        format_props.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+        format_props.pNext = &format_props3;
+        vkGetPhysicalDeviceFormatProperties2(physical, format, &format_props);
+        VkFormatFeatureFlags2 features = format_props3.optimalTilingFeatures;
+
+        // The background pass stores to it, the scene and particles blend into it, the bloom and present passes
+        // load from it, blits and copies read it
+        VkFormatFeatureFlags2 required = VK_FORMAT_FEATURE_2_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_2_COLOR_ATTACHMENT_BLEND_BIT
+                                         | VK_FORMAT_FEATURE_2_BLIT_SRC_BIT | VK_FORMAT_FEATURE_2_TRANSFER_SRC_BIT
+                                         | VK_FORMAT_FEATURE_2_TRANSFER_DST_BIT;
+        return (features & required) == required;
+    }
+
+    void RenderEngine::InitDevice(const vkb::Instance& vkb_inst)
+    {
         // Physical Device
         // Grab features for Vulkan 1.3 and 1.2
         VkPhysicalDeviceVulkan13Features features13 = {};
         features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
         features13.dynamicRendering = true;
         features13.synchronization2 = true;
+        // Lets the compute kernel variants pin their subgroup size, core since 1.3
+        features13.subgroupSizeControl = true;
+        // The bloom downsample indexes its invocations by subgroup, core since 1.3 as well
+        features13.computeFullSubgroups = true;
 
         VkPhysicalDeviceVulkan12Features features12 = {};
         features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
@@ -101,18 +261,93 @@ namespace OB3D
         features12.descriptorIndexing = true;
 
         vkb::PhysicalDeviceSelector physical_selector(vkb_inst);
-        vkb::PhysicalDevice selected_physical = physical_selector.set_minimum_version(1, 4)
-                                                    .set_required_features_13(features13)
-                                                    .set_required_features_12(features12)
-                                                    .set_surface(m_Surface)
-                                                    .select()
-                                                    .value();
+        physical_selector.set_minimum_version(1, 4)
+                         .set_required_features_13(features13)
+                         .set_required_features_12(features12);
+
+        if (!m_Config.headless)
+        {
+            physical_selector.set_surface(m_Surface);
+        }
+
+        vkb::PhysicalDevice selected_physical = physical_selector.select().value();
+
+        // Lets VMA report what the OS actually grants us instead of estimating from heap sizes
+        m_HasMemoryBudget = selected_physical.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+        // Needed to write the swapchain image from compute whatever format it ends up with
+        VkPhysicalDeviceFeatures optional_features = {};
+        optional_features.shaderStorageImageWriteWithoutFormat = true;
+        m_HasStorageWriteWithoutFormat = selected_physical.enable_features_if_present(optional_features);
+
+        // Particle compaction hands out slots with one atomic per subgroup
+        m_SubgroupProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+        VkPhysicalDeviceVulkan13Properties props13 = {};
+        props13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_PROPERTIES;
+        m_SubgroupProps.pNext = &props13;
+        VkPhysicalDeviceProperties2 device_props = {};
+        device_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        device_props.pNext = &m_SubgroupProps;
+        vkGetPhysicalDeviceProperties2(selected_physical.physical_device, &device_props);
+        m_SubgroupProps.pNext = nullptr;
+        props13.pNext = nullptr;
+
+        // Workgroup shapes of the image kernels are picked from these
+        m_ComputeDevice = ComputeVariants::QueryDevice(selected_physical.physical_device, m_SubgroupProps, props13);
+
+        bool has_compute_subgroups = m_SubgroupProps.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT;
+        VkSubgroupFeatureFlags ballot_ops = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+        bool has_subgroup_ballot = has_compute_subgroups && (m_SubgroupProps.supportedOperations & ballot_ops) == ballot_ops;
+        m_HasParticles = has_subgroup_ballot && m_Config.particle_capacity > 0;
+        if (!has_subgroup_ballot)
+        {
+            OB3D_LOG("No subgroup ballot in compute shaders, particles are off");
+        }
+
+        // The bloom downsample averages 2x2 blocks across clusters of 4 invocations, whatever size its subgroups end up with
+        VkSubgroupFeatureFlags clustered_ops = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_CLUSTERED_BIT;
+        bool has_subgroup_clusters = has_compute_subgroups && std::min(m_SubgroupProps.subgroupSize, props13.minSubgroupSize) >= 4
+                                     && (m_SubgroupProps.supportedOperations & clustered_ops) == clustered_ops;
+
+        // Its Morton layout assumes every subgroup of a workgroup has the same size, pinned to the default one when the device allows it
+        bool can_pin_subgroup_size = (props13.requiredSubgroupSizeStages & VK_SHADER_STAGE_COMPUTE_BIT)
+                                     && BLOOM_DOWNSAMPLE_INVOCATIONS <= m_SubgroupProps.subgroupSize * props13.maxComputeWorkgroupSubgroups;
+        m_BloomSubgroupSize = can_pin_subgroup_size ? m_SubgroupProps.subgroupSize : 0;
+        m_HasBloom = has_subgroup_clusters && m_Config.bloom_intensity > 0.0f;
+        if (!has_subgroup_clusters)
+        {
+            OB3D_LOG("No clustered subgroup operations in compute shaders, bloom is off");
+        }
+
+        // Formats other than RGBA16F are opt in and only kept when every pass, the compute present included, can use them
+        uint32_t draw_format_idx = uint32_t(m_Config.draw_format);
+        if (draw_format_idx != 0 && !IsDrawFormatUsable(selected_physical.physical_device, DRAW_FORMATS[draw_format_idx]))
+        {
+            OB3D_LOG("Draw format {:s} is not supported by every pass, falling back to {:s}", DRAW_FORMAT_NAMES[draw_format_idx], DRAW_FORMAT_NAMES[0]);
+            draw_format_idx = 0;
+        }
+
+        if (!IsDrawFormatUsable(selected_physical.physical_device, DRAW_FORMATS[draw_format_idx]))
+        {
+            OB3D_ERROR_OUT("The device can't write an RGBA16F draw image from compute shaders");
+        }
+
+        m_DrawFormat = DRAW_FORMATS[draw_format_idx];
+        m_DrawShaderSuffix = DRAW_FORMAT_SHADER_SUFFIXES[draw_format_idx];
+        OB3D_LOG("Draw image format: {:s}", DRAW_FORMAT_NAMES[draw_format_idx]);
+
+        // Nothing in an UNORM draw image is brighter than 1, so there's nothing to bloom or tonemap
+        m_IsDrawImageHdr = m_DrawFormat != VK_FORMAT_R8G8B8A8_UNORM;
+        m_HasBloom = m_HasBloom && m_IsDrawImageHdr;
+
+        // Needed by the transient images, which are declared before the shadow map exists
+        m_DepthFormat = FindDepthFormat(selected_physical.physical_device, SCENE_DEPTH_FORMATS, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
         vkb::DeviceBuilder device_builder(selected_physical);
         vkb::Device built_device = device_builder.build().value();
         m_Device.logical = built_device.device;
         m_Device.physical = selected_physical.physical_device;
-        fmt::println("Device successfully chosen: {:s}", selected_physical.name);
+        OB3D_LOG("Device successfully chosen: {:s}", selected_physical.name);
 
         Destroyable dstr_device;
         dstr_device.device = m_Device.logical;
@@ -127,7 +362,13 @@ namespace OB3D
         create_info_vma.physicalDevice = m_Device.physical;
         create_info_vma.device = m_Device.logical;
         create_info_vma.instance = m_Instance;
+        // Buffer device addresses are core since 1.2, VMA only tags allocations for them when it knows that
+        create_info_vma.vulkanApiVersion = VK_API_VERSION_1_3;
         create_info_vma.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+        if (m_HasMemoryBudget)
+        {
+            create_info_vma.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
         vmaCreateAllocator(&create_info_vma, &m_VmaAlloc);
         if (!m_VmaAlloc)
         {
@@ -142,15 +383,34 @@ namespace OB3D
 
     void RenderEngine::InitSwapchain()
     {
-        CreateSwapchain(800, 600);
-        fmt::println("SwapchainKHR created successfully");
+        if (m_Config.headless)
+        {
+            // Nothing to present to, the draw image is the final output
+            m_SwapchainExtent = { m_Width, m_Height };
+        }
+        else
+        {
+            CreateSwapchain(m_Width, m_Height);
+            OB3D_LOG("SwapchainKHR created successfully");
+        }
+
+        // Bloom is composited by the compute present pass, headless and blit presents have no use for it
+        m_HasBloom = m_HasBloom && m_UseComputePresent;
+
+        CreateDrawImage({ m_Width, m_Height });
+        BuildTransientImages();
+    }
 
+    void RenderEngine::CreateDrawImage(VkExtent2D extent)
+    {
         VkExtent3D draw_img_ext = {
-            m_Width, m_Height, 1
+            std::max(1u, uint32_t(extent.width * m_RenderScale)),
+            std::max(1u, uint32_t(extent.height * m_RenderScale)),
+            1
         };
 
-        // Hardcoded format to 32 bit float
-        m_DrawImg.img_format = VK_FORMAT_R16G16B16A16_SFLOAT;
+        // Picked with the device, see EngineConfig::draw_format
+        m_DrawImg.img_format = m_DrawFormat;
         m_DrawImg.img_ext = draw_img_ext;
 
         VkImageUsageFlags draw_img_usage = {};
@@ -167,43 +427,134 @@ namespace OB3D
         draw_img_alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
         // Allocate the image and create
-        vmaCreateImage(m_VmaAlloc, &draw_img_info, &draw_img_alloc_info, &m_DrawImg.img, &m_DrawImg.alloc, nullptr);
+        VkResult result = vmaCreateImage(m_VmaAlloc, &draw_img_info, &draw_img_alloc_info, &m_DrawImg.img, &m_DrawImg.alloc, nullptr);
+        OB3D_VK_CHECK(result, "Failed to allocate draw image");
 
         // build an image-view for the draw image to use for rendering
         VkImageViewCreateInfo img_view_info = VkConstructors::ImageViewCreateInfo(m_DrawImg.img_format, m_DrawImg.img, VK_IMAGE_ASPECT_COLOR_BIT);
 
-        VkResult result = vkCreateImageView(m_Device.logical, &img_view_info, nullptr, &m_DrawImg.img_view);
+        result = vkCreateImageView(m_Device.logical, &img_view_info, nullptr, &m_DrawImg.img_view);
         OB3D_VK_CHECK(result, "Failed to create draw image view");
+        OB3D_LOG("Draw image created at {}x{}", draw_img_ext.width, draw_img_ext.height);
+    }
 
-        // add to destroyer queue
+    void RenderEngine::PushDrawImage(DestroyerQueue& queue)
+    {
+        // The draw image gets recreated at runtime so it is not owned by the global queue
         Destroyable dstr_img = {};
         dstr_img.img = m_DrawImg.img;
         dstr_img.type = DestroyableVkType::DESTROYABLE_IMG;
         dstr_img.allocation = m_DrawImg.alloc;
-        global_queue.Push(dstr_img);
+        queue.Push(dstr_img);
 
         Destroyable dstr_img_view = {};
         dstr_img_view.img_view = m_DrawImg.img_view;
         dstr_img_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
-        global_queue.Push(dstr_img_view);
+        queue.Push(dstr_img_view);
+    }
+
+    void RenderEngine::RecreateDrawImage()
+    {
+        // The draw image descriptor is referenced by the frames in flight
+        // this only happens on memory pressure so waiting for them is fine
+        vkDeviceWaitIdle(m_Device.logical);
+
+        DestroyerQueue old_img_queue;
+        PushDrawImage(old_img_queue);
+        m_TransientImages.Release(old_img_queue);
+        old_img_queue.Flush();
+
+        // Transient targets follow the draw image size, so lowering the render scale shrinks them as well
+        CreateDrawImage({ m_Width, m_Height });
+        BuildTransientImages();
+        WriteDrawImgDescriptors();
+        m_CommandCache.Invalidate();
     }
 
+    void RenderEngine::BuildTransientImages()
+    {
+        // Passes declare their intermediate targets here, sized from m_DrawImg.img_ext
+        m_TransientImages.Clear();
+
+        if (m_HasBloom)
+        {
+            // Starts at half the draw image, levels stop before they'd drop under a texel
+            VkExtent3D bloom_ext = {
+                std::max(1u, m_DrawImg.img_ext.width / 2),
+                std::max(1u, m_DrawImg.img_ext.height / 2),
+                1
+            };
+            uint32_t max_mips = uint32_t(std::log2(float(std::max(bloom_ext.width, bloom_ext.height)))) + 1;
+            m_BloomMipCount = std::min(BLOOM_MIP_COUNT, max_mips);
+
+            TransientImageDesc bloom_desc = {};
+            bloom_desc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+            bloom_desc.extent = bloom_ext;
+            bloom_desc.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+            bloom_desc.mip_levels = m_BloomMipCount;
+            bloom_desc.first_pass = PASS_POST_PROCESS;
+            bloom_desc.last_pass = PASS_PRESENT;
+            m_BloomImage = m_TransientImages.Declare(bloom_desc);
+        }
+
+        // Only the scene pass tests against it, attachment only so tilers never back it with memory
+        TransientImageDesc depth_desc = {};
+        depth_desc.format = m_DepthFormat;
+        depth_desc.extent = m_DrawImg.img_ext;
+        depth_desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        depth_desc.first_pass = PASS_GEOMETRY;
+        depth_desc.last_pass = PASS_GEOMETRY;
+        m_DepthImage = m_TransientImages.Declare(depth_desc);
+
+        m_TransientImages.Build(m_Device.logical, m_VmaAlloc);
+    }
+
+    // Indexed by PresentMode
+    constexpr std::array<VkPresentModeKHR, 3> PRESENT_MODES = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+    constexpr std::array<std::string_view, 3> PRESENT_MODE_NAMES = { "FIFO", "MAILBOX", "IMMEDIATE" };
+
     void RenderEngine::CreateSwapchain(uint32_t width, uint32_t height)
     {
         vkb::SwapchainBuilder swapchain_builder(m_Device.physical, m_Device.logical, m_Surface);
         m_SwapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+        // The compute present pass writes the swapchain images directly and sRGB encodes them itself
+        m_UseComputePresent = m_Config.compute_present && SupportsComputePresent();
+        if (m_UseComputePresent)
+        {
+            swapchain_builder.add_image_usage_flags(VK_IMAGE_USAGE_STORAGE_BIT);
+        }
+        else
+        {
+            // Blits convert to the destination format, an sRGB one encodes the linear draw image for display
+            m_SwapchainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        }
+
         VkSurfaceFormatKHR desired_format = {};
         desired_format.format = m_SwapchainImageFormat;
         desired_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
-        vkb::Swapchain built_swapchain = swapchain_builder.set_desired_format(desired_format)
-                                             .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-                                             .set_desired_extent(width, height)
-                                             .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT)
-                                             .build()
-                                             .value();
+        swapchain_builder.set_desired_format(desired_format)
+                         .set_desired_present_mode(PRESENT_MODES[uint32_t(m_Config.present_mode)])
+                         .set_desired_extent(width, height)
+                         .add_image_usage_flags(VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+        vkb::Swapchain built_swapchain = swapchain_builder.build().value();
 
         m_SwapchainExtent = built_swapchain.extent;
 
+        // The builder falls back to another surface format when the desired one is missing
+        if (built_swapchain.image_format != m_SwapchainImageFormat)
+        {
+            OB3D_LOG("Swapchain format {} is not supported by the surface, using {}", uint32_t(m_SwapchainImageFormat), uint32_t(built_swapchain.image_format));
+            m_SwapchainImageFormat = built_swapchain.image_format;
+        }
+
+        // The builder settles on FIFO when the surface lacks the requested mode
+        if (built_swapchain.present_mode != PRESENT_MODES[uint32_t(m_Config.present_mode)])
+        {
+            OB3D_LOG("Present mode {:s} is not supported by the surface, using FIFO", PRESENT_MODE_NAMES[uint32_t(m_Config.present_mode)]);
+        }
+
         // Store the swapchain and its images
         m_Swapchain = built_swapchain.swapchain;
         m_SwapchainImages = built_swapchain.get_images().value();
@@ -223,6 +574,20 @@ namespace OB3D
         global_queue.Push(dstr_swap);
     }
 
+    bool RenderEngine::SupportsComputePresent()
+    {
+        VkSurfaceCapabilitiesKHR surface_caps = {};
+        VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_Device.physical, m_Surface, &surface_caps);
+        OB3D_VK_CHECK(result, "Failed to query surface capabilities");
+
+        VkFormatProperties format_props = {};
+        vkGetPhysicalDeviceFormatProperties(m_Device.physical, m_SwapchainImageFormat, &format_props);
+
+        return m_HasStorageWriteWithoutFormat
+               && (surface_caps.supportedUsageFlags & VK_IMAGE_USAGE_STORAGE_BIT)
+               && (format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+    }
+
     void RenderEngine::InitCommands()
     {
         // Create a command pool for commands submitted to the graphics queue
@@ -240,8 +605,23 @@ namespace OB3D
             result = vkAllocateCommandBuffers(m_Device.logical, &command_buffer_allocate_info, &m_Frames[i].main_command_buffer);
             OB3D_VK_CHECK(result, "Failed to allocate command buffers!");
 
-            fmt::println("Successfully created frame data {} with the command pool and a unique command buffer", i);
+            OB3D_LOG("Successfully created frame data {} with the command pool and a unique command buffer", i);
         }
+
+        VkResult result = vkCreateCommandPool(m_Device.logical, &command_pool_create_info, nullptr, &m_ImmCommandPool);
+        OB3D_VK_CHECK(result, "Failed to create immediate command pool!");
+
+        VkCommandBufferAllocateInfo imm_allocate_info = VkConstructors::CommandBufferAllocateInfo(m_ImmCommandPool, 1);
+        result = vkAllocateCommandBuffers(m_Device.logical, &imm_allocate_info, &m_ImmCommandBuffer);
+        OB3D_VK_CHECK(result, "Failed to allocate immediate command buffer!");
+
+        Destroyable dstr_imm_pool = {};
+        dstr_imm_pool.cmd_pool = m_ImmCommandPool;
+        dstr_imm_pool.type = DestroyableVkType::DESTROYABLE_COMMAND_POOL;
+        global_queue.Push(dstr_imm_pool);
+
+        m_CommandCache.Init(m_Device.logical, m_GraphicsQueueFamilyIdx);
+        m_CommandCache.Push(global_queue);
     }
 
     void RenderEngine::InitSyncStructs()
@@ -262,18 +642,30 @@ namespace OB3D
             OB3D_VK_CHECK(result, "Failed to create semaphore for swapchain");
             result = vkCreateSemaphore(m_Device.logical, &semaphore_create_info, nullptr, &m_Frames[i].render_semaphore);
             OB3D_VK_CHECK(result, "Failed to create semaphore for rendering");
-            fmt::println("Created fence and semaphores for frame {}", i);
+            OB3D_LOG("Created fence and semaphores for frame {}", i);
         }
+
+        VkResult result = vkCreateFence(m_Device.logical, &fence_create_info, nullptr, &m_ImmFence);
+        OB3D_VK_CHECK(result, "Failed to create immediate submit fence");
+
+        Destroyable dstr_imm_fence = {};
+        dstr_imm_fence.fence = m_ImmFence;
+        dstr_imm_fence.type = DestroyableVkType::DESTROYABLE_FENCE;
+        global_queue.Push(dstr_imm_fence);
     }
 
     void RenderEngine::InitDescriptors()
     {
         std::vector<VkConstructors::DescriptorAllocator::PoolSizeRatio> sizes =
         {
-            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+            // draw image, the present pass's draw, swapchain and bloom image per swapchain image
+            // and the bloom chain's mips
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 },
+            // shadow map
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
         };
 
-        m_GlobalDescrAllocator.InitPool(m_Device.logical, 10, sizes);
+        m_GlobalDescrAllocator.InitPool(m_Device.logical, 16, sizes);
 
         // make the descriptor set layout for our compute draw
         {
@@ -284,6 +676,94 @@ namespace OB3D
 
         m_DrawImgDescriptors = m_GlobalDescrAllocator.Allocate(m_Device.logical, m_DrawImgDescriptorLayout);
 
+        if (m_UseComputePresent)
+        {
+            VkConstructors::DescriptorLayoutBuilder builder;
+            builder.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            builder.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            builder.AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            m_PresentDescriptorLayout = builder.Build(m_Device.logical, VK_SHADER_STAGE_COMPUTE_BIT);
+
+            for (size_t i = 0; i < m_SwapchainImageViews.size(); i++)
+            {
+                m_PresentDescriptors.push_back(m_GlobalDescrAllocator.Allocate(m_Device.logical, m_PresentDescriptorLayout));
+            }
+
+            Destroyable dstr_present_layout = {};
+            dstr_present_layout.set_layout = m_PresentDescriptorLayout;
+            dstr_present_layout.type = DestroyableVkType::DESTROYABLE_DESCR_LAYOUT;
+            global_queue.Push(dstr_present_layout);
+        }
+
+        if (m_HasBloom)
+        {
+            // Draw image plus one binding per mip
+            VkConstructors::DescriptorLayoutBuilder downsample_builder;
+            for (uint32_t binding = 0; binding <= BLOOM_MIP_COUNT; binding++)
+            {
+                downsample_builder.AddBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            }
+            m_BloomDownsampleDescriptorLayout = downsample_builder.Build(m_Device.logical, VK_SHADER_STAGE_COMPUTE_BIT);
+
+            VkConstructors::DescriptorLayoutBuilder upsample_builder;
+            upsample_builder.AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            upsample_builder.AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+            m_BloomUpsampleDescriptorLayout = upsample_builder.Build(m_Device.logical, VK_SHADER_STAGE_COMPUTE_BIT);
+
+            m_BloomDownsampleDescriptors = m_GlobalDescrAllocator.Allocate(m_Device.logical, m_BloomDownsampleDescriptorLayout);
+            for (VkDescriptorSet& upsample_set : m_BloomUpsampleDescriptors)
+            {
+                upsample_set = m_GlobalDescrAllocator.Allocate(m_Device.logical, m_BloomUpsampleDescriptorLayout);
+            }
+
+            for (VkDescriptorSetLayout layout : { m_BloomDownsampleDescriptorLayout, m_BloomUpsampleDescriptorLayout })
+            {
+                Destroyable dstr_bloom_layout = {};
+                dstr_bloom_layout.set_layout = layout;
+                dstr_bloom_layout.type = DestroyableVkType::DESTROYABLE_DESCR_LAYOUT;
+                global_queue.Push(dstr_bloom_layout);
+            }
+        }
+
+        // The shadow map never changes size, unlike the draw image targets it is written once
+        {
+            VkConstructors::DescriptorLayoutBuilder builder;
+            builder.AddBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+            m_SceneDescriptorLayout = builder.Build(m_Device.logical, VK_SHADER_STAGE_FRAGMENT_BIT);
+            m_SceneDescriptors = m_GlobalDescrAllocator.Allocate(m_Device.logical, m_SceneDescriptorLayout);
+
+            VkDescriptorImageInfo shadow_map_info = {};
+            shadow_map_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+            shadow_map_info.imageView = m_ShadowMap.img_view;
+            shadow_map_info.sampler = m_ShadowSampler;
+
+            VkWriteDescriptorSet shadow_map_write = {};
+            shadow_map_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            shadow_map_write.dstBinding = 0;
+            shadow_map_write.dstSet = m_SceneDescriptors;
+            shadow_map_write.descriptorCount = 1;
+            shadow_map_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            shadow_map_write.pImageInfo = &shadow_map_info;
+            vkUpdateDescriptorSets(m_Device.logical, 1, &shadow_map_write, 0, nullptr);
+
+            Destroyable dstr_scene_layout = {};
+            dstr_scene_layout.set_layout = m_SceneDescriptorLayout;
+            dstr_scene_layout.type = DestroyableVkType::DESTROYABLE_DESCR_LAYOUT;
+            global_queue.Push(dstr_scene_layout);
+        }
+
+        WriteDrawImgDescriptors();
+
+        Destroyable dstr_descriptor = {};
+        global_queue.descr_allocator = m_GlobalDescrAllocator;
+        dstr_descriptor.type = DestroyableVkType::DESTROYABLE_DESCR_SET;
+        dstr_descriptor.set_layout = m_DrawImgDescriptorLayout;
+
+        global_queue.Push(dstr_descriptor);
+    }
+
+    void RenderEngine::WriteDrawImgDescriptors()
+    {
         VkDescriptorImageInfo descr_img_info = {};
         descr_img_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
         descr_img_info.imageView = m_DrawImg.img_view;
@@ -300,129 +780,2349 @@ namespace OB3D
 
         vkUpdateDescriptorSets(m_Device.logical, 1, &draw_img_write, 0, nullptr);
 
-        Destroyable dstr_descriptor = {};
-        global_queue.descr_allocator = m_GlobalDescrAllocator;
-        dstr_descriptor.type = DestroyableVkType::DESTROYABLE_DESCR_SET;
-        dstr_descriptor.set_layout = m_DrawImgDescriptorLayout;
-
-        global_queue.Push(dstr_descriptor);
-    }
+        // Mips the chain is too small for repeat the last one, the bloom passes never touch them
+        std::array<VkDescriptorImageInfo, BLOOM_MIP_COUNT> bloom_mip_infos = {};
+        for (uint32_t mip = 0; m_HasBloom && mip < BLOOM_MIP_COUNT; mip++)
+        {
+            bloom_mip_infos[mip].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            bloom_mip_infos[mip].imageView = m_TransientImages.GetMipView(m_BloomImage, std::min(mip, m_BloomMipCount - 1));
+        }
 
-    void RenderEngine::Run()
-    {
-        while (!glfwWindowShouldClose(m_Window))
+        if (m_HasBloom)
         {
-            if (!m_IsIdle)
+            std::array<VkWriteDescriptorSet, BLOOM_MIP_COUNT + 1> downsample_writes = {};
+            downsample_writes.fill(draw_img_write);
+            for (uint32_t binding = 0; binding < downsample_writes.size(); binding++)
             {
-                Draw();
+                downsample_writes[binding].dstSet = m_BloomDownsampleDescriptors;
+                downsample_writes[binding].dstBinding = binding;
+                downsample_writes[binding].pImageInfo = binding == 0 ? &descr_img_info : &bloom_mip_infos[binding - 1];
+            }
+            vkUpdateDescriptorSets(m_Device.logical, (uint32_t)downsample_writes.size(), downsample_writes.data(), 0, nullptr);
+
+            for (uint32_t mip = 0; mip < m_BloomUpsampleDescriptors.size(); mip++)
+            {
+                std::array<VkWriteDescriptorSet, 2> upsample_writes = { draw_img_write, draw_img_write };
+                upsample_writes[0].dstSet = m_BloomUpsampleDescriptors[mip];
+                upsample_writes[0].pImageInfo = &bloom_mip_infos[mip + 1];
+                upsample_writes[1].dstSet = m_BloomUpsampleDescriptors[mip];
+                upsample_writes[1].dstBinding = 1;
+                upsample_writes[1].pImageInfo = &bloom_mip_infos[mip];
+                vkUpdateDescriptorSets(m_Device.logical, (uint32_t)upsample_writes.size(), upsample_writes.data(), 0, nullptr);
             }
+        }
 
-            glfwPollEvents();
+        for (size_t i = 0; i < m_PresentDescriptors.size(); i++)
+        {
+            VkDescriptorImageInfo swapchain_img_info = {};
+            swapchain_img_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            swapchain_img_info.imageView = m_SwapchainImageViews[i];
+
+            std::array<VkWriteDescriptorSet, 3> present_writes = { draw_img_write, draw_img_write, draw_img_write };
+            present_writes[0].dstSet = m_PresentDescriptors[i];
+            present_writes[1].dstSet = m_PresentDescriptors[i];
+            present_writes[1].dstBinding = 1;
+            present_writes[1].pImageInfo = &swapchain_img_info;
+            // Without bloom the draw image fills the slot, the shader skips the reads
+            present_writes[2].dstSet = m_PresentDescriptors[i];
+            present_writes[2].dstBinding = 2;
+            present_writes[2].pImageInfo = m_HasBloom ? &bloom_mip_infos[0] : &descr_img_info;
+
+            vkUpdateDescriptorSets(m_Device.logical, (uint32_t)present_writes.size(), present_writes.data(), 0, nullptr);
         }
     }
 
-    void RenderEngine::Draw()
+    void RenderEngine::InitFrameAllocators()
     {
-        // Wait until the GPU has finished rendering the last frame. Timeout of 1 sec
-        VkResult result = vkWaitForFences(m_Device.logical, 1, &GetCurrentFrame().render_fence, true, 1000000000);
-        OB3D_VK_CHECK(result, "Fence timeout!");
-        GetCurrentFrame().frame_queue.Flush();
+        // Sub allocations have to be usable as uniform and storage buffer descriptors as well as through addresses
+        VkPhysicalDeviceProperties device_props = {};
+        vkGetPhysicalDeviceProperties(m_Device.physical, &device_props);
+        VkDeviceSize min_alignment = std::max(device_props.limits.minUniformBufferOffsetAlignment,
+                                              device_props.limits.minStorageBufferOffsetAlignment);
 
-        result = vkResetFences(m_Device.logical, 1, &GetCurrentFrame().render_fence);
+        VkBufferUsageFlags ring_usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
-        // Request image from the swapchain
-        // If the swapchain doesn't have any image we can use it will block the
-        // calling thread with the timeout specified which is 1 sec (in nanoseconds)
-        uint32_t swapchain_img_idx;
-        vkAcquireNextImageKHR(m_Device.logical, m_Swapchain, 1000000000, GetCurrentFrame().swapchain_semaphore, nullptr, &swapchain_img_idx);
+        m_FrameRingBuffer = CreateBuffer(FRAME_GPU_RING_SIZE * FRAME_OVERLAP, ring_usage, BufferMemoryType::BUFFER_DEVICE_MAPPED);
 
-        VkCommandBuffer cmd_buff = GetCurrentFrame().main_command_buffer;
-        result = vkResetCommandBuffer(cmd_buff, 0);
-        OB3D_VK_CHECK(result, "Failed to reset command buffer");
+        for (int i = 0; i < FRAME_OVERLAP; i++)
+        {
+            m_Frames[i].frame_allocator.cpu.Init(FRAME_CPU_ARENA_SIZE);
+            m_Frames[i].frame_allocator.gpu.Init(m_FrameRingBuffer, FRAME_GPU_RING_SIZE * i, FRAME_GPU_RING_SIZE, min_alignment);
+        }
+        OB3D_LOG("Frame allocators created, ring buffer is {}", m_FrameRingBuffer.is_device_local ? "device local" : "in system memory");
 
-        VkCommandBufferBeginInfo cmd_buffer_begin_info = VkConstructors::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-        result = vkBeginCommandBuffer(cmd_buff, &cmd_buffer_begin_info);
-        OB3D_VK_CHECK(result, "Failed to begin command buffer");
+        Destroyable dstr_ring = {};
+        dstr_ring.buffer = m_FrameRingBuffer.buffer;
+        dstr_ring.allocation = m_FrameRingBuffer.alloc;
+        dstr_ring.type = DestroyableVkType::DESTROYABLE_BUFFER;
+        global_queue.Push(dstr_ring);
+    }
 
-        m_DrawExt.width = m_DrawImg.img_ext.width;
-        m_DrawExt.height = m_DrawImg.img_ext.height;
+    void RenderEngine::InitGpuTimer()
+    {
+        m_GpuTimer.Init(m_Device.logical, m_Device.physical, m_GraphicsQueueFamilyIdx, GPU_SCOPE_NAMES, FRAME_OVERLAP);
+        m_GpuTimer.Push(global_queue);
 
-        // transition our main draw image into the general layout so we can write into it
-        // we will overwrite it all so we dont care about what the older layout was
-        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        // GPU pacing predicts completion from the frame's timestamps
+        if (m_Config.gpu_pacing && !m_GpuTimer.is_supported)
+        {
+            OB3D_LOG("The graphics queue can't write timestamps, GPU pacing is off");
+        }
+        m_FramePacer.Init(m_Config.target_fps, m_Config.gpu_pacing && m_GpuTimer.is_supported);
+    }
 
-        DrawBackground(cmd_buff);
+    void RenderEngine::InitParticles()
+    {
+        if (!m_HasParticles)
+        {
+            return;
+        }
 
-        // transition the draw image and the swapchain image into the correct transfer layouts
-        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-        VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        // Persistent device memory, particles never leave the GPU
+        m_ParticleCapacity = m_Config.particle_capacity;
+        VkDeviceSize pool_size = VkDeviceSize(m_ParticleCapacity) * sizeof(GpuParticle);
+        for (AllocatedBuffer& pool : m_ParticlePools)
+        {
+            pool = CreateBuffer(pool_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, BufferMemoryType::BUFFER_DEVICE_LOCAL);
+        }
 
-        // Execute a copy from the draw image to the swapchain image
-        VkImageFunctions::CopyImageToImage(cmd_buff, m_DrawImg.img, m_SwapchainImages[swapchain_img_idx], m_DrawExt, m_SwapchainExtent);
+        m_ParticleCounters = CreateBuffer(sizeof(GpuParticleCounters),
+                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          BufferMemoryType::BUFFER_DEVICE_LOCAL);
 
-        // Set swapchain image layout to Present so we can show it to the screen
-        VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        for (const AllocatedBuffer* buffer : { &m_ParticlePools[0], &m_ParticlePools[1], &m_ParticleCounters })
+        {
+            Destroyable dstr_buffer = {};
+            dstr_buffer.buffer = buffer->buffer;
+            dstr_buffer.allocation = buffer->alloc;
+            dstr_buffer.type = DestroyableVkType::DESTROYABLE_BUFFER;
+            global_queue.Push(dstr_buffer);
+        }
 
-        result = vkEndCommandBuffer(cmd_buff);
-        OB3D_VK_CHECK(result, "Failed to end command buffer!");
+        OB3D_LOG("Particle pools created: 2 x {} particles, {} KiB", m_ParticleCapacity, pool_size * 2 / 1024);
+    }
 
-        // prepare submissions to the queue
-        // we want to wait on the present semaphore, as that semaphore is signaled when the swapchain is ready
-        // we will signal the render semaphore to indicate rendering has finished
+    void RenderEngine::InitShadowMap()
+    {
+        // Without shadows the map still gets cleared every frame, so the lookups find everything lit
+        m_HasShadows = m_Config.shadow_map_size > 0;
+        uint32_t map_size = m_HasShadows ? m_Config.shadow_map_size : 1;
+
+        VkFormatFeatureFlags shadow_features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        m_ShadowMap.img_format = FindDepthFormat(m_Device.physical, SHADOW_MAP_FORMATS, shadow_features);
+        m_ShadowMap.img_ext = { map_size, map_size, 1 };
+
+        VkImageCreateInfo img_info = VkConstructors::ImageCreateInfo(m_ShadowMap.img_format,
+                                                                     VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                                     m_ShadowMap.img_ext);
+        img_info.arrayLayers = SHADOW_CASCADE_COUNT;
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+        alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        VkResult result = vmaCreateImage(m_VmaAlloc, &img_info, &alloc_info, &m_ShadowMap.img, &m_ShadowMap.alloc, nullptr);
+        OB3D_VK_CHECK(result, "Failed to allocate shadow map");
+
+        // The scene samples every cascade through one array view, the shadow pass renders each layer on its own
+        VkImageViewCreateInfo array_view_info = VkConstructors::ImageViewCreateInfo(m_ShadowMap.img_format, m_ShadowMap.img, VK_IMAGE_ASPECT_DEPTH_BIT);
+        array_view_info.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        array_view_info.subresourceRange.layerCount = SHADOW_CASCADE_COUNT;
+        result = vkCreateImageView(m_Device.logical, &array_view_info, nullptr, &m_ShadowMap.img_view);
+        OB3D_VK_CHECK(result, "Failed to create shadow map view");
+
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            VkImageViewCreateInfo layer_view_info = VkConstructors::ImageViewCreateInfo(m_ShadowMap.img_format, m_ShadowMap.img, VK_IMAGE_ASPECT_DEPTH_BIT);
+            layer_view_info.subresourceRange.baseArrayLayer = cascade;
+            result = vkCreateImageView(m_Device.logical, &layer_view_info, nullptr, &m_ShadowCascadeViews[cascade]);
+            OB3D_VK_CHECK(result, "Failed to create shadow cascade view");
+        }
 
-        VkCommandBufferSubmitInfo cmd_submit_info = VkConstructors::CommandBufferSubmitInfo(cmd_buff);
+        // Depth compare in the sampler, with linear filtering the hardware blends the 2x2 results for free
+        VkFormatProperties format_props = {};
+        vkGetPhysicalDeviceFormatProperties(m_Device.physical, m_ShadowMap.img_format, &format_props);
+        bool can_filter = format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+        VkSamplerCreateInfo sampler_info = {};
+        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter = can_filter ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        sampler_info.minFilter = sampler_info.magFilter;
+        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        // Outside the map counts as lit
+        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+        sampler_info.compareEnable = VK_TRUE;
+        sampler_info.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        sampler_info.maxLod = 0.0f;
+        result = vkCreateSampler(m_Device.logical, &sampler_info, nullptr, &m_ShadowSampler);
+        OB3D_VK_CHECK(result, "Failed to create shadow map sampler");
 
-        VkSemaphoreSubmitInfo wait_info = VkConstructors::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, GetCurrentFrame().swapchain_semaphore);
-        VkSemaphoreSubmitInfo signal_info = VkConstructors::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame().render_semaphore);
+        Destroyable dstr_img = {};
+        dstr_img.img = m_ShadowMap.img;
+        dstr_img.allocation = m_ShadowMap.alloc;
+        dstr_img.type = DestroyableVkType::DESTROYABLE_IMG;
+        global_queue.Push(dstr_img);
 
-        VkSubmitInfo2 submit_info_2 = VkConstructors::SubmitInfo2(&cmd_submit_info, &signal_info, &wait_info);
+        for (VkImageView view : m_ShadowCascadeViews)
+        {
+            Destroyable dstr_view = {};
+            dstr_view.img_view = view;
+            dstr_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
+            global_queue.Push(dstr_view);
+        }
 
-        // Submit the command buffer to the queue and execute it
-        // render fence will now block until the graphics commands finish execution
-        result = vkQueueSubmit2(m_GraphicsQueue, 1, &submit_info_2, GetCurrentFrame().render_fence);
-        OB3D_VK_CHECK(result, "Failed to submit info to the graphics queue");
+        Destroyable dstr_array_view = {};
+        dstr_array_view.img_view = m_ShadowMap.img_view;
+        dstr_array_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
+        global_queue.Push(dstr_array_view);
 
-        // prepare present
-        // put the image we just rendered to into the visible window
-        // we want to wait on the render semaphore for that
-        // as its necessary that drawing commands have finished before the image is displayed to the user
-        VkPresentInfoKHR present_info = {};
-        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        present_info.pNext = nullptr;
-        present_info.pSwapchains = &m_Swapchain;
-        present_info.swapchainCount = 1;
+        Destroyable dstr_sampler = {};
+        dstr_sampler.sampler = m_ShadowSampler;
+        dstr_sampler.type = DestroyableVkType::DESTROYABLE_SAMPLER;
+        global_queue.Push(dstr_sampler);
 
-        present_info.pWaitSemaphores = &GetCurrentFrame().render_semaphore;
-        present_info.waitSemaphoreCount = 1;
+        OB3D_LOG("Shadow map created: {} cascades at {}x{}", SHADOW_CASCADE_COUNT, map_size, map_size);
+    }
 
-        present_info.pImageIndices = &swapchain_img_idx;
+    void RenderEngine::InitPipelines()
+    {
+        InitKernelShapes();
 
-        result = vkQueuePresentKHR(m_GraphicsQueue, &present_info);
-        OB3D_VK_CHECK(result, "Failed to present to the graphics queue!");
+        // The background writes the draw image through the draw image descriptor, nothing else to pass it
+        VkPipelineLayoutCreateInfo background_layout_info = VkConstructors::PipelineLayoutCreateInfo(&m_DrawImgDescriptorLayout, 1, nullptr);
+        VkResult result = vkCreatePipelineLayout(m_Device.logical, &background_layout_info, nullptr, &m_BackgroundPipelineLayout);
+        OB3D_VK_CHECK(result, "Failed to create background pipeline layout");
 
-        // increment frame number
-        m_FrameCount++;
+        Destroyable dstr_layout = {};
+        dstr_layout.pipeline_layout = m_BackgroundPipelineLayout;
+        dstr_layout.type = DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT;
+        global_queue.Push(dstr_layout);
+
+        if (m_UseComputePresent)
+        {
+            InitPresentPipeline();
+        }
+        if (m_HasBloom)
+        {
+            InitBloomPipelines();
+        }
+        if (!CreateKernelPipelines())
+        {
+            OB3D_ERROR_OUT("Failed to load the compute kernel shaders");
+        }
+        if (m_HasParticles)
+        {
+            InitParticlePipelines();
+        }
+        InitScenePipelines();
+        OB3D_LOG("Presenting through {:s}", m_UseComputePresent ? "the compute present pass" : "image blits");
     }
 
-    void RenderEngine::DrawBackground(VkCommandBuffer cmd_buff)
+    void RenderEngine::InitKernelShapes()
     {
-        VkClearColorValue clear_value = {};
-        float flash_b = std::abs(std::sin(m_FrameCount / 120.0f));
-        float flash_g = std::abs(std::sin(m_FrameCount / 60.0f));
-        float flash_r = std::abs(std::sin(m_FrameCount / 30.0f));
-        clear_value = { {flash_r, flash_g, flash_b, 1.0f} };
+        m_KernelShapes.fill(ComputeVariants::DefaultShape(m_ComputeDevice));
+        if (!m_Config.tuning_path.empty())
+        {
+            m_TunedKernelMask = ComputeVariants::LoadTuning(m_Config.tuning_path.c_str(), m_ComputeDevice, m_KernelShapes);
+        }
 
-        VkImageSubresourceRange clear_range = VkConstructors::ImageSubresourceRange(VK_IMAGE_ASPECT_COLOR_BIT);
-        vkCmdClearColorImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, &clear_value, 1, &clear_range);
+        for (uint32_t kernel = 0; kernel < KERNEL_COUNT; kernel++)
+        {
+            const WorkgroupShape& shape = m_KernelShapes[kernel];
+            OB3D_LOG("Kernel {:s} runs {}x{} workgroups, subgroup size {:s}{:s}", KERNEL_SHADER_NAMES[kernel], shape.x, shape.y,
+                     shape.subgroup_size == 0 ? "by the driver" : fmt::format("{}", shape.subgroup_size),
+                     (m_TunedKernelMask & (1u << kernel)) ? " (tuned)" : "");
+        }
     }
 
-    void RenderEngine::Destroy()
+    void RenderEngine::InitPresentPipeline()
+    {
+        VkPushConstantRange push_constant = {};
+        push_constant.offset = 0;
+        push_constant.size = sizeof(PresentPushConstants);
+        push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo layout_info = VkConstructors::PipelineLayoutCreateInfo(&m_PresentDescriptorLayout, 1, &push_constant);
+        VkResult result = vkCreatePipelineLayout(m_Device.logical, &layout_info, nullptr, &m_PresentPipelineLayout);
+        OB3D_VK_CHECK(result, "Failed to create present pipeline layout");
+
+        Destroyable dstr_layout = {};
+        dstr_layout.pipeline_layout = m_PresentPipelineLayout;
+        dstr_layout.type = DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT;
+        global_queue.Push(dstr_layout);
+    }
+
+    void RenderEngine::InitBloomPipelines()
+    {
+        VkPushConstantRange downsample_push_constant = {};
+        downsample_push_constant.offset = 0;
+        downsample_push_constant.size = sizeof(BloomDownsamplePushConstants);
+        downsample_push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo downsample_layout_info = VkConstructors::PipelineLayoutCreateInfo(&m_BloomDownsampleDescriptorLayout, 1, &downsample_push_constant);
+        VkResult result = vkCreatePipelineLayout(m_Device.logical, &downsample_layout_info, nullptr, &m_BloomDownsampleLayout);
+        OB3D_VK_CHECK(result, "Failed to create bloom downsample pipeline layout");
+
+        VkPushConstantRange upsample_push_constant = {};
+        upsample_push_constant.offset = 0;
+        upsample_push_constant.size = sizeof(BloomUpsamplePushConstants);
+        upsample_push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo upsample_layout_info = VkConstructors::PipelineLayoutCreateInfo(&m_BloomUpsampleDescriptorLayout, 1, &upsample_push_constant);
+        result = vkCreatePipelineLayout(m_Device.logical, &upsample_layout_info, nullptr, &m_BloomUpsampleLayout);
+        OB3D_VK_CHECK(result, "Failed to create bloom upsample pipeline layout");
+
+        if (!CreateBloomDownsamplePipeline(&m_BloomDownsamplePipeline))
+        {
+            OB3D_ERROR_OUT("Failed to load the bloom downsample shader");
+        }
+
+        for (VkPipelineLayout layout : { m_BloomDownsampleLayout, m_BloomUpsampleLayout })
+        {
+            Destroyable dstr_layout = {};
+            dstr_layout.pipeline_layout = layout;
+            dstr_layout.type = DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT;
+            global_queue.Push(dstr_layout);
+        }
+    }
+
+    bool RenderEngine::CreateBloomDownsamplePipeline(VkPipeline* out_pipeline)
+    {
+        // The workgroup is fixed by the shader's tile layout, unlike the upsample it is not a tuned kernel
+        VkShaderModule downsample_shader;
+        if (!LoadShader(DrawImageShaderName("bloom_downsample"), &downsample_shader))
+        {
+            return false;
+        }
+
+        // The shader derives its Morton index from gl_SubgroupID, which only covers the workgroup without gaps when every subgroup is full
+        *out_pipeline = VkPipelines::CreateComputePipeline(m_Device.logical, m_BloomDownsampleLayout, downsample_shader, nullptr,
+                                                           m_BloomSubgroupSize, VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT);
+        vkDestroyShaderModule(m_Device.logical, downsample_shader, nullptr);
+        return true;
+    }
+
+    bool RenderEngine::CreateKernelPipelines()
+    {
+        m_BackgroundPipeline = GetComputeVariant(KERNEL_BACKGROUND, m_BackgroundPipelineLayout, 0);
+        bool is_created = m_BackgroundPipeline != VK_NULL_HANDLE;
+
+        if (m_UseComputePresent)
+        {
+            uint32_t present_features = m_Config.tonemapper == Tonemapper::TONEMAPPER_AGX ? PRESENT_FEATURE_AGX : 0;
+            present_features |= m_IsDrawImageHdr ? 0 : PRESENT_FEATURE_LDR;
+            m_PresentPipeline = GetComputeVariant(KERNEL_PRESENT, m_PresentPipelineLayout, present_features);
+            is_created = is_created && m_PresentPipeline != VK_NULL_HANDLE;
+        }
+
+        if (m_HasBloom)
+        {
+            m_BloomUpsamplePipeline = GetComputeVariant(KERNEL_BLOOM_UPSAMPLE, m_BloomUpsampleLayout, 0);
+            is_created = is_created && m_BloomUpsamplePipeline != VK_NULL_HANDLE;
+        }
+        return is_created;
+    }
+
+    VkPipeline RenderEngine::GetComputeVariant(ComputeKernel kernel, VkPipelineLayout layout, uint32_t features)
+    {
+        const WorkgroupShape& shape = m_KernelShapes[kernel];
+        uint64_t key = ComputeVariantKey(kernel, shape, features);
+        VkPipeline pipeline = m_ComputeVariants.Find(key);
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            return pipeline;
+        }
+
+        // The bloom upsample only touches the bloom chain, always RGBA16F
+        std::string shader_name = kernel == KERNEL_BLOOM_UPSAMPLE ? std::string(KERNEL_SHADER_NAMES[kernel])
+                                                                  : DrawImageShaderName(KERNEL_SHADER_NAMES[kernel]);
+        VkShaderModule shader;
+        if (!LoadShader(shader_name, &shader))
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        // Added in KernelSpecConstant order, the ids are the positions
+        VkPipelines::SpecializationConstants constants;
+        constants.Add(shape.x).Add(shape.y).Add(shape.subgroup_size).Add(features);
+        VkSpecializationInfo specialization = constants.Info();
+
+        pipeline = VkPipelines::CreateComputePipeline(m_Device.logical, layout, shader, &specialization, shape.subgroup_size);
+        vkDestroyShaderModule(m_Device.logical, shader, nullptr);
+
+        m_ComputeVariants.Insert(key, pipeline);
+        return pipeline;
+    }
+
+    uint32_t RenderEngine::UsedKernelMask() const
+    {
+        uint32_t mask = 1u << KERNEL_BACKGROUND;
+        if (m_HasBloom)
+        {
+            mask |= 1u << KERNEL_BLOOM_UPSAMPLE;
+        }
+        if (m_UseComputePresent)
+        {
+            mask |= 1u << KERNEL_PRESENT;
+        }
+        return mask;
+    }
+
+    // Timed dispatches per candidate shape, after one untimed warmup run
+    constexpr uint32_t AUTOTUNE_RUNS = 8;
+
+    void RenderEngine::AutotuneKernels()
+    {
+        // Only what the tuning file is missing, unless a new tuning was asked for
+        uint32_t tune_mask = UsedKernelMask();
+        if (!m_Config.autotune)
+        {
+            tune_mask &= ~m_TunedKernelMask;
+        }
+        if (tune_mask == 0)
+        {
+            return;
+        }
+        if (!m_GpuTimer.is_supported)
+        {
+            OB3D_LOG("The graphics queue has no timestamps, kernels keep their default shapes");
+            return;
+        }
+
+        m_DrawExt.width = m_DrawImg.img_ext.width;
+        m_DrawExt.height = m_DrawImg.img_ext.height;
+
+        // The present kernel writes a stand in for the swapchain image, nothing is acquired or presented while tuning
+        AllocatedImage present_target = {};
+        if (tune_mask & (1u << KERNEL_PRESENT))
+        {
+            present_target.img_format = m_SwapchainImageFormat;
+            present_target.img_ext = { m_SwapchainExtent.width, m_SwapchainExtent.height, 1 };
+            VkImageCreateInfo target_info = VkConstructors::ImageCreateInfo(present_target.img_format, VK_IMAGE_USAGE_STORAGE_BIT, present_target.img_ext);
+
+            VmaAllocationCreateInfo target_alloc_info = {};
+            target_alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+            target_alloc_info.requiredFlags = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            VkResult result = vmaCreateImage(m_VmaAlloc, &target_info, &target_alloc_info, &present_target.img, &present_target.alloc, nullptr);
+            OB3D_VK_CHECK(result, "Failed to allocate the auto tuner's present target");
+
+            VkImageViewCreateInfo target_view_info = VkConstructors::ImageViewCreateInfo(present_target.img_format, present_target.img, VK_IMAGE_ASPECT_COLOR_BIT);
+            result = vkCreateImageView(m_Device.logical, &target_view_info, nullptr, &present_target.img_view);
+            OB3D_VK_CHECK(result, "Failed to create the auto tuner's present target view");
+
+            VkDescriptorImageInfo target_img_info = {};
+            target_img_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            target_img_info.imageView = present_target.img_view;
+
+            VkWriteDescriptorSet target_write = {};
+            target_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            target_write.dstSet = m_PresentDescriptors[0];
+            target_write.dstBinding = 1;
+            target_write.descriptorCount = 1;
+            target_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            target_write.pImageInfo = &target_img_info;
+            vkUpdateDescriptorSets(m_Device.logical, 1, &target_write, 0, nullptr);
+
+            ImmediateSubmit([&](VkCommandBuffer cmd)
+            {
+                VkImageFunctions::TransitionImage(cmd, present_target.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            });
+        }
+
+        // The bloom scope includes the fixed downsample, it adds the same time to every candidate
+        constexpr std::array<GpuScope, KERNEL_COUNT> kernel_scopes = { GPU_SCOPE_BACKGROUND, GPU_SCOPE_BLOOM, GPU_SCOPE_PRESENT };
+        std::vector<WorkgroupShape> candidates = ComputeVariants::CandidateShapes(m_ComputeDevice);
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        OB3D_LOG("Auto tuning compute kernels, {} candidate shapes", candidates.size());
+
+        // In frame order, kernels later in the frame are timed with the shapes just picked for the earlier ones
+        for (uint32_t kernel = 0; kernel < KERNEL_COUNT; kernel++)
+        {
+            if (!(tune_mask & (1u << kernel)))
+            {
+                continue;
+            }
+
+            WorkgroupShape best_shape = m_KernelShapes[kernel];
+            // Negative until the first candidate has been timed
+            double best_ms = -1.0;
+            for (const WorkgroupShape& candidate : candidates)
+            {
+                m_KernelShapes[kernel] = candidate;
+                if (!CreateKernelPipelines())
+                {
+                    OB3D_ERROR_OUT("Failed to load the compute kernel shaders");
+                }
+
+                // Every submit collects the previous one's timestamps, the second one brings in the warmup's
+                for (uint32_t run = 0; run <= AUTOTUNE_RUNS; run++)
+                {
+                    ImmediateSubmit([&](VkCommandBuffer cmd)
+                    {
+                        m_GpuTimer.BeginFrame(cmd, frame_slot);
+                        RecordKernelRun(cmd, ComputeKernel(kernel));
+                    });
+                    if (run == 1)
+                    {
+                        m_GpuTimer.ResetStats();
+                    }
+                }
+                ImmediateSubmit([&](VkCommandBuffer cmd) { m_GpuTimer.BeginFrame(cmd, frame_slot); });
+
+                double average_ms = m_GpuTimer.stats[kernel_scopes[kernel]].AverageMs();
+                if (best_ms < 0.0 || average_ms < best_ms)
+                {
+                    best_ms = average_ms;
+                    best_shape = candidate;
+                }
+            }
+
+            m_KernelShapes[kernel] = best_shape;
+            OB3D_LOG("Kernel {:s} tuned to {}x{} workgroups, subgroup size {}, {:.4f} ms", KERNEL_SHADER_NAMES[kernel],
+                     best_shape.x, best_shape.y, best_shape.subgroup_size, best_ms);
+        }
+
+        // Only the chosen variants are kept, the fences above have been waited on
+        DestroyerQueue tuning_queue;
+        m_ComputeVariants.Release(tuning_queue);
+        if (!CreateKernelPipelines())
+        {
+            OB3D_ERROR_OUT("Failed to load the compute kernel shaders");
+        }
+        m_GpuTimer.ResetStats();
+        // Shapes and pipelines changed under anything recorded so far
+        m_CommandCache.Invalidate();
+
+        if (present_target.img != VK_NULL_HANDLE)
+        {
+            Destroyable dstr_img = {};
+            dstr_img.img = present_target.img;
+            dstr_img.type = DestroyableVkType::DESTROYABLE_IMG;
+            dstr_img.allocation = present_target.alloc;
+            tuning_queue.Push(dstr_img);
+
+            Destroyable dstr_img_view = {};
+            dstr_img_view.img_view = present_target.img_view;
+            dstr_img_view.type = DestroyableVkType::DESTROYABLE_IMG_VIEW;
+            tuning_queue.Push(dstr_img_view);
+
+            // Back to the swapchain images
+            WriteDrawImgDescriptors();
+        }
+        tuning_queue.Flush();
+
+        m_TunedKernelMask |= tune_mask;
+        if (ComputeVariants::SaveTuning(m_Config.tuning_path.c_str(), m_ComputeDevice, m_KernelShapes, tune_mask))
+        {
+            OB3D_LOG("Kernel tuning saved to {:s}", m_Config.tuning_path);
+        }
+    }
+
+    void RenderEngine::InitParticlePipelines()
+    {
+        VkPushConstantRange compute_push_constant = {};
+        compute_push_constant.offset = 0;
+        compute_push_constant.size = sizeof(ParticleComputePushConstants);
+        compute_push_constant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+        VkPipelineLayoutCreateInfo compute_layout_info = VkConstructors::PipelineLayoutCreateInfo(nullptr, 0, &compute_push_constant);
+        VkResult result = vkCreatePipelineLayout(m_Device.logical, &compute_layout_info, nullptr, &m_ParticleComputeLayout);
+        OB3D_VK_CHECK(result, "Failed to create particle compute pipeline layout");
+
+        VkPushConstantRange draw_push_constant = {};
+        draw_push_constant.offset = 0;
+        draw_push_constant.size = sizeof(ParticleDrawPushConstants);
+        draw_push_constant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        VkPipelineLayoutCreateInfo draw_layout_info = VkConstructors::PipelineLayoutCreateInfo(nullptr, 0, &draw_push_constant);
+        result = vkCreatePipelineLayout(m_Device.logical, &draw_layout_info, nullptr, &m_ParticleDrawLayout);
+        OB3D_VK_CHECK(result, "Failed to create particle draw pipeline layout");
+
+        if (!CreateParticlePipelines(m_ParticlePipelines))
+        {
+            OB3D_ERROR_OUT("Failed to load the particle shaders");
+        }
+
+        for (VkPipelineLayout layout : { m_ParticleComputeLayout, m_ParticleDrawLayout })
+        {
+            Destroyable dstr_layout = {};
+            dstr_layout.pipeline_layout = layout;
+            dstr_layout.type = DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT;
+            global_queue.Push(dstr_layout);
+        }
+    }
+
+    bool RenderEngine::CreateParticlePipelines(ParticlePipelines& out_pipelines)
+    {
+        constexpr std::array<std::string_view, 5> shader_names = {
+            "particle_simulate", "particle_emit", "particle_finalize", "particle_billboard", "particle_glow"
+        };
+
+        std::array<VkShaderModule, shader_names.size()> shaders = {};
+        bool is_loaded = true;
+        for (size_t i = 0; i < shader_names.size() && is_loaded; i++)
+        {
+            is_loaded = LoadShader(shader_names[i], &shaders[i]);
+        }
+
+        if (is_loaded)
+        {
+            out_pipelines.simulate = VkPipelines::CreateComputePipeline(m_Device.logical, m_ParticleComputeLayout, shaders[0]);
+            out_pipelines.emit = VkPipelines::CreateComputePipeline(m_Device.logical, m_ParticleComputeLayout, shaders[1]);
+            out_pipelines.finalize = VkPipelines::CreateComputePipeline(m_Device.logical, m_ParticleComputeLayout, shaders[2]);
+
+            VkPipelines::PipelineBuilder builder;
+            builder.pipeline_layout = m_ParticleDrawLayout;
+            builder.SetShaders(shaders[3], shaders[4]);
+            builder.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+            builder.SetPolygonMode(VK_POLYGON_MODE_FILL);
+            builder.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+            builder.SetMultisamplingNone();
+            builder.EnableBlendingAdditive();
+            builder.DisableDepthTest();
+            builder.SetColorAttachmentFormat(m_DrawImg.img_format);
+            out_pipelines.draw = builder.Build(m_Device.logical);
+        }
+
+        for (VkShaderModule shader : shaders)
+        {
+            if (shader != VK_NULL_HANDLE)
+            {
+                vkDestroyShaderModule(m_Device.logical, shader, nullptr);
+            }
+        }
+        return is_loaded;
+    }
+
+    // Pushes shadow depth away from the light, in depth buffer units and per unit of depth slope
+    constexpr float SHADOW_DEPTH_BIAS = 1.25f;
+    constexpr float SHADOW_SLOPE_BIAS = 1.75f;
+
+    void RenderEngine::InitScenePipelines()
+    {
+        // The fragment shader reads the per frame data through the same addresses as the vertex shader
+        VkPushConstantRange push_constant = {};
+        push_constant.offset = 0;
+        push_constant.size = sizeof(ScenePushConstants);
+        push_constant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        VkPipelineLayoutCreateInfo layout_info = VkConstructors::PipelineLayoutCreateInfo(&m_SceneDescriptorLayout, 1, &push_constant);
+        VkResult result = vkCreatePipelineLayout(m_Device.logical, &layout_info, nullptr, &m_ScenePipelineLayout);
+        OB3D_VK_CHECK(result, "Failed to create scene pipeline layout");
+
+        if (!CreateScenePipelines(m_ScenePipelines))
+        {
+            OB3D_ERROR_OUT("Failed to load the scene shaders");
+        }
+
+        Destroyable dstr_layout = {};
+        dstr_layout.pipeline_layout = m_ScenePipelineLayout;
+        dstr_layout.type = DestroyableVkType::DESTROYABLE_PIPELINE_LAYOUT;
+        global_queue.Push(dstr_layout);
+    }
+
+    bool RenderEngine::CreateScenePipelines(ScenePipelines& out_pipelines)
+    {
+        VkShaderModule vertex_shader = VK_NULL_HANDLE;
+        VkShaderModule fragment_shader = VK_NULL_HANDLE;
+        bool is_loaded = LoadShader("scene_box", &vertex_shader) && LoadShader("scene_lit", &fragment_shader);
+
+        if (is_loaded)
+        {
+            VkPipelines::PipelineBuilder builder;
+            builder.pipeline_layout = m_ScenePipelineLayout;
+            builder.SetVertexShader(vertex_shader);
+            builder.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+            builder.SetPolygonMode(VK_POLYGON_MODE_FILL);
+            // The light's projection isn't flipped like the camera's, the boxes are closed so both faces are fine
+            builder.SetCullMode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+            builder.SetDepthBias(SHADOW_DEPTH_BIAS, SHADOW_SLOPE_BIAS);
+            builder.SetMultisamplingNone();
+            builder.EnableDepthTest(true, VK_COMPARE_OP_LESS_OR_EQUAL);
+            builder.SetDepthFormat(m_ShadowMap.img_format);
+            out_pipelines.shadow = builder.Build(m_Device.logical);
+
+            builder.Clear();
+            builder.pipeline_layout = m_ScenePipelineLayout;
+            builder.SetInputTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+            builder.SetPolygonMode(VK_POLYGON_MODE_FILL);
+            // Flipping y in the projection keeps the mesh's counter clockwise faces counter clockwise on screen
+            builder.SetCullMode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+            builder.SetMultisamplingNone();
+            builder.SetColorAttachmentFormat(m_DrawImg.img_format);
+            builder.SetDepthFormat(m_DepthFormat);
+
+            out_pipelines.prepass = VK_NULL_HANDLE;
+            if (m_Config.depth_prepass)
+            {
+                builder.SetVertexShader(vertex_shader);
+                builder.DisableColorWrites();
+                builder.EnableDepthTest(true, VK_COMPARE_OP_LESS);
+                out_pipelines.prepass = builder.Build(m_Device.logical);
+            }
+
+            // After the prepass only the nearest surface of every pixel passes and gets shaded
+            builder.SetShaders(vertex_shader, fragment_shader);
+            builder.DisableBlending();
+            if (m_Config.depth_prepass)
+            {
+                builder.EnableDepthTest(false, VK_COMPARE_OP_EQUAL);
+            }
+            else
+            {
+                builder.EnableDepthTest(true, VK_COMPARE_OP_LESS);
+            }
+            out_pipelines.opaque = builder.Build(m_Device.logical);
+        }
+
+        for (VkShaderModule shader : { vertex_shader, fragment_shader })
+        {
+            if (shader != VK_NULL_HANDLE)
+            {
+                vkDestroyShaderModule(m_Device.logical, shader, nullptr);
+            }
+        }
+        return is_loaded;
+    }
+
+    // Variants of the default draw format, the one every device runs
+    static_assert(!ShaderRegistry::FindEmbedded("gradient_rgba16f").empty(), "gradient.comp's RGBA16F variant is missing from the embedded shaders");
+    static_assert(!ShaderRegistry::FindEmbedded("present_rgba16f").empty(), "present.comp's RGBA16F variant is missing from the embedded shaders");
+    static_assert(!ShaderRegistry::FindEmbedded("bloom_downsample_rgba16f").empty(), "bloom_downsample.comp's RGBA16F variant is missing from the embedded shaders");
+    static_assert(!ShaderRegistry::FindEmbedded("particle_simulate").empty(), "particle_simulate.comp is missing from the embedded shaders");
+    static_assert(!ShaderRegistry::FindEmbedded("scene_box").empty(), "scene_box.vert is missing from the embedded shaders");
+    static_assert(!ShaderRegistry::FindEmbedded("scene_lit").empty(), "scene_lit.frag is missing from the embedded shaders");
+
+    bool RenderEngine::LoadShader(std::string_view name, VkShaderModule* out_shader_module)
+    {
+        if (!m_Config.shader_dir.empty())
+        {
+            std::string override_path = fmt::format("{:s}/{:s}.spv", m_Config.shader_dir, name);
+            if (VkPipelines::LoadShaderModule(override_path.c_str(), m_Device.logical, out_shader_module))
+            {
+                OB3D_LOG("Loaded shader {:s} from {:s}", name, override_path);
+                return true;
+            }
+        }
+
+        // Both are read only memory, nothing is copied or read from disk here
+        return VkPipelines::CreateShaderModule(m_AssetPack.GetShader(name), m_Device.logical, out_shader_module)
+               || VkPipelines::CreateShaderModule(ShaderRegistry::FindEmbedded(name), m_Device.logical, out_shader_module);
+    }
+
+    std::string RenderEngine::DrawImageShaderName(std::string_view name) const
+    {
+        // With bloom on the present pass reads RGBA16F bloom mip 0 where it otherwise reads the draw image
+        bool is_bloom_present = name == KERNEL_SHADER_NAMES[KERNEL_PRESENT] && m_HasBloom;
+        return fmt::format("{:s}_{:s}{:s}", name, m_DrawShaderSuffix, is_bloom_present ? "_bloom" : "");
+    }
+
+    void RenderEngine::ReloadShaders()
+    {
+        // Rare and user triggered, simply wait for the frames using the old pipelines
+        vkDeviceWaitIdle(m_Device.logical);
+
+        // Variants are rebuilt from scratch, the old ones stay around until the new set is complete
+        ComputeVariantCache old_variants = std::move(m_ComputeVariants);
+        m_ComputeVariants = {};
+        VkPipeline old_background_pipeline = m_BackgroundPipeline;
+        VkPipeline old_present_pipeline = m_PresentPipeline;
+        VkPipeline old_upsample_pipeline = m_BloomUpsamplePipeline;
+
+        DestroyerQueue old_variant_queue;
+        if (CreateKernelPipelines())
+        {
+            old_variants.Release(old_variant_queue);
+        }
+        else
+        {
+            m_ComputeVariants.Release(old_variant_queue);
+            m_ComputeVariants = std::move(old_variants);
+            m_BackgroundPipeline = old_background_pipeline;
+            m_PresentPipeline = old_present_pipeline;
+            m_BloomUpsamplePipeline = old_upsample_pipeline;
+            OB3D_LOG("Compute kernel shader reload failed, keeping the current pipelines");
+        }
+        old_variant_queue.Flush();
+
+        VkPipeline new_pipeline;
+        if (m_HasBloom && CreateBloomDownsamplePipeline(&new_pipeline))
+        {
+            vkDestroyPipeline(m_Device.logical, m_BloomDownsamplePipeline, nullptr);
+            m_BloomDownsamplePipeline = new_pipeline;
+        }
+        else if (m_HasBloom)
+        {
+            OB3D_LOG("Bloom downsample shader reload failed, keeping the current pipeline");
+        }
+
+        ParticlePipelines new_particle_pipelines = {};
+        if (m_HasParticles && CreateParticlePipelines(new_particle_pipelines))
+        {
+            DestroyerQueue old_pipeline_queue;
+            PushParticlePipelines(old_pipeline_queue);
+            old_pipeline_queue.Flush();
+            m_ParticlePipelines = new_particle_pipelines;
+        }
+        else if (m_HasParticles)
+        {
+            OB3D_LOG("Particle shader reload failed, keeping the current pipelines");
+        }
+
+        ScenePipelines new_scene_pipelines = {};
+        if (CreateScenePipelines(new_scene_pipelines))
+        {
+            DestroyerQueue old_pipeline_queue;
+            PushScenePipelines(old_pipeline_queue);
+            old_pipeline_queue.Flush();
+            m_ScenePipelines = new_scene_pipelines;
+        }
+        else
+        {
+            OB3D_LOG("Scene shader reload failed, keeping the current pipelines");
+        }
+
+        // Pipelines and workgroup counts are baked into the cached recordings, the device is idle
+        m_CommandCache.Invalidate();
+        OB3D_LOG("Shaders reloaded");
+    }
+
+    void RenderEngine::PushPipelines(DestroyerQueue& queue)
+    {
+        // Pipelines get replaced by shader reloads so they are not owned by the global queue
+        m_ComputeVariants.Release(queue);
+        if (m_HasBloom)
+        {
+            Destroyable dstr_pipeline = {};
+            dstr_pipeline.pipeline = m_BloomDownsamplePipeline;
+            dstr_pipeline.type = DestroyableVkType::DESTROYABLE_PIPELINE;
+            queue.Push(dstr_pipeline);
+        }
+        PushParticlePipelines(queue);
+        PushScenePipelines(queue);
+    }
+
+    void RenderEngine::PushParticlePipelines(DestroyerQueue& queue)
+    {
+        if (!m_HasParticles)
+        {
+            return;
+        }
+
+        for (VkPipeline pipeline : { m_ParticlePipelines.simulate, m_ParticlePipelines.emit, m_ParticlePipelines.finalize, m_ParticlePipelines.draw })
+        {
+            Destroyable dstr_pipeline = {};
+            dstr_pipeline.pipeline = pipeline;
+            dstr_pipeline.type = DestroyableVkType::DESTROYABLE_PIPELINE;
+            queue.Push(dstr_pipeline);
+        }
+    }
+
+    void RenderEngine::PushScenePipelines(DestroyerQueue& queue)
+    {
+        for (VkPipeline pipeline : { m_ScenePipelines.shadow, m_ScenePipelines.prepass, m_ScenePipelines.opaque })
+        {
+            if (pipeline == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+
+            Destroyable dstr_pipeline = {};
+            dstr_pipeline.pipeline = pipeline;
+            dstr_pipeline.type = DestroyableVkType::DESTROYABLE_PIPELINE;
+            queue.Push(dstr_pipeline);
+        }
+    }
+
+    void RenderEngine::InitAssets()
+    {
+        if (!m_AssetPack.IsOpen())
+        {
+            return;
+        }
+
+        UploadMeshes();
+    }
+
+    void RenderEngine::UploadMeshes()
+    {
+        std::vector<PackMesh> pack_meshes;
+        VkDeviceSize staging_size = 0;
+
+        for (const PackEntry& entry : m_AssetPack.entries)
+        {
+            if (entry.type != PackEntryType::PACK_MESH)
+            {
+                continue;
+            }
+
+            std::string_view name(entry.name, strnlen(entry.name, PACK_NAME_SIZE));
+            PackMesh pack_mesh = {};
+            if (!m_AssetPack.GetMesh(name, pack_mesh))
+            {
+                OB3D_LOG("Skipping malformed mesh {:s}", name);
+                continue;
+            }
+
+            GpuMesh mesh = {};
+            mesh.name = name;
+            mesh.vertex_count = pack_mesh.header->vertex_count;
+            mesh.index_count = pack_mesh.header->index_count;
+            m_Meshes.push_back(mesh);
+            pack_meshes.push_back(pack_mesh);
+            staging_size += pack_mesh.vertex_data.size() + pack_mesh.index_data.size();
+        }
+
+        if (m_Meshes.empty())
+        {
+            return;
+        }
+
+        // Mapped pages go straight into one staging buffer and every mesh is copied in a single submit
+        AllocatedBuffer staging = CreateBuffer(staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, BufferMemoryType::BUFFER_HOST_MAPPED);
+        uint8_t* staging_data = static_cast<uint8_t*>(staging.mapped);
+        std::vector<VkDeviceSize> staging_offsets;
+        VkDeviceSize staging_offset = 0;
+
+        for (size_t i = 0; i < m_Meshes.size(); i++)
+        {
+            GpuMesh& mesh = m_Meshes[i];
+            const PackMesh& pack_mesh = pack_meshes[i];
+
+            mesh.vertex_buffer = CreateBuffer(std::max<VkDeviceSize>(pack_mesh.vertex_data.size(), 4),
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                              BufferMemoryType::BUFFER_DEVICE_LOCAL);
+            mesh.index_buffer = CreateBuffer(std::max<VkDeviceSize>(pack_mesh.index_data.size(), 4),
+                                             VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                             BufferMemoryType::BUFFER_DEVICE_LOCAL);
+
+            staging_offsets.push_back(staging_offset);
+            memcpy(staging_data + staging_offset, pack_mesh.vertex_data.data(), pack_mesh.vertex_data.size());
+            staging_offset += pack_mesh.vertex_data.size();
+            memcpy(staging_data + staging_offset, pack_mesh.index_data.data(), pack_mesh.index_data.size());
+            staging_offset += pack_mesh.index_data.size();
+
+            for (const AllocatedBuffer* buffer : { &mesh.vertex_buffer, &mesh.index_buffer })
+            {
+                Destroyable dstr_buffer = {};
+                dstr_buffer.buffer = buffer->buffer;
+                dstr_buffer.allocation = buffer->alloc;
+                dstr_buffer.type = DestroyableVkType::DESTROYABLE_BUFFER;
+                global_queue.Push(dstr_buffer);
+            }
+        }
+
+        ImmediateSubmit([&](VkCommandBuffer cmd)
+        {
+            for (size_t i = 0; i < m_Meshes.size(); i++)
+            {
+                VkDeviceSize vertex_size = pack_meshes[i].vertex_data.size();
+                VkDeviceSize index_size = pack_meshes[i].index_data.size();
+
+                if (vertex_size > 0)
+                {
+                    VkBufferCopy vertex_copy = { staging_offsets[i], 0, vertex_size };
+                    vkCmdCopyBuffer(cmd, staging.buffer, m_Meshes[i].vertex_buffer.buffer, 1, &vertex_copy);
+                }
+                if (index_size > 0)
+                {
+                    VkBufferCopy index_copy = { staging_offsets[i] + vertex_size, 0, index_size };
+                    vkCmdCopyBuffer(cmd, staging.buffer, m_Meshes[i].index_buffer.buffer, 1, &index_copy);
+                }
+            }
+        });
+
+        vmaDestroyBuffer(m_VmaAlloc, staging.buffer, staging.alloc);
+        OB3D_LOG("Uploaded {} meshes, {} KiB", m_Meshes.size(), staging_size / 1024);
+    }
+
+    bool RenderEngine::LoadLevel(std::string_view name)
+    {
+        PackLevel level = {};
+        if (!m_AssetPack.GetLevel(name, level))
+        {
+            return false;
+        }
+
+        if (level.header->columns != BRICK_COLUMNS || level.header->rows != BRICK_ROWS)
+        {
+            OB3D_LOG("Level {:s} is {}x{}, expected {}x{}", name, level.header->columns, level.header->rows, BRICK_COLUMNS, BRICK_ROWS);
+            return false;
+        }
+
+        // The simulation copies the hit points out of the mapped pages, no parsing involved
+        m_World.LoadLevel(level.hit_points);
+        return true;
+    }
+
+    const GpuMesh* RenderEngine::FindMesh(std::string_view name) const
+    {
+        for (const GpuMesh& mesh : m_Meshes)
+        {
+            if (mesh.name == name)
+            {
+                return &mesh;
+            }
+        }
+        return nullptr;
+    }
+
+    // Upper bound on how long the main thread sleeps between event checks
+    constexpr double INPUT_POLL_TIMEOUT_SEC = 0.001;
+
+    int RenderEngine::Run()
+    {
+        // Rendering blocks on fences and image acquisition, keep it off the thread that owns the window
+        // so input is timestamped when it arrives rather than whenever the last frame finished
+        m_IsRunning = true;
+
+        if (m_Config.headless)
+        {
+            // No events to pump
+            RenderLoop();
+        }
+        else
+        {
+            std::thread render_thread(&RenderEngine::RenderLoop, this);
+
+            // GLFW events must be processed on the main thread
+            while (m_IsRunning && !glfwWindowShouldClose(m_Window))
+            {
+                glfwWaitEventsTimeout(INPUT_POLL_TIMEOUT_SEC);
+            }
+
+            m_IsRunning = false;
+            render_thread.join();
+        }
+
+        bool is_saved = !m_Recorder.is_recording || Replay::Save(m_Config.record_path.c_str(), m_Recorder.data);
+        bool is_captured = FinishCapture();
+        return is_saved && is_captured ? 0 : 1;
+    }
+
+    // Rate replays are rendered at, each frame consumes SIM_TICK_RATE / REPLAY_FRAME_RATE ticks
+    constexpr uint32_t REPLAY_FRAME_RATE = 60;
+
+    int RenderEngine::RunReplay(const ReplayData& replay)
+    {
+        m_IsReplaying = true;
+        Replay::Start(replay, m_World);
+
+        constexpr uint32_t ticks_per_frame = SIM_TICK_RATE / REPLAY_FRAME_RATE;
+        uint32_t tick = 0;
+        uint32_t frame_count = 0;
+        double min_frame_ms = 0.0;
+        double max_frame_ms = 0.0;
+
+        auto start = std::chrono::steady_clock::now();
+        while (tick < replay.header.tick_count)
+        {
+            auto frame_start = std::chrono::steady_clock::now();
+
+            for (uint32_t i = 0; i < ticks_per_frame && tick < replay.header.tick_count; i++, tick++)
+            {
+                if (!Replay::StepAndVerify(replay, tick, m_World))
+                {
+                    vkDeviceWaitIdle(m_Device.logical);
+                    return 1;
+                }
+                if (m_HasParticles)
+                {
+                    m_ParticleEmitters.AddSimEvents(m_World);
+                }
+                if (m_Audio.IsActive())
+                {
+                    m_Audio.AddSimEvents(m_World);
+                }
+            }
+
+            Draw();
+
+            std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - frame_start;
+            min_frame_ms = frame_count == 0 ? frame_time.count() : std::min(min_frame_ms, frame_time.count());
+            max_frame_ms = std::max(max_frame_ms, frame_time.count());
+            frame_count++;
+        }
+
+        vkDeviceWaitIdle(m_Device.logical);
+        std::chrono::duration<double, std::milli> total_time = std::chrono::steady_clock::now() - start;
+
+        fmt::println("Replay verified: {} ticks, {} frames in {:.1f} ms", replay.header.tick_count, frame_count, total_time.count());
+        fmt::println("Frame time: avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms",
+            total_time.count() / std::max(frame_count, 1u), min_frame_ms, max_frame_ms);
+
+        // A sink fed nothing still writes a valid file, a replay that made sounds has to have made them audible
+        bool is_audio_written = true;
+        if (m_Audio.IsActive() && m_Config.audio_backend == AudioBackend::AUDIO_WAV)
+        {
+            m_Audio.Stop();
+            is_audio_written = m_Audio.played_commands == 0 || m_Audio.AudibleFrames() > 0;
+            if (!is_audio_written)
+            {
+                fmt::println("Replay played {} sounds but {:s} is silent", m_Audio.played_commands, m_Config.audio_wav_path);
+            }
+        }
+
+        bool is_captured = FinishCapture();
+        return is_captured && is_audio_written ? 0 : 1;
+    }
+
+    // Frames per particle count, timings are only taken once the pools are warm
+    constexpr uint32_t PARTICLE_BENCH_WARMUP_FRAMES = 30;
+    constexpr uint32_t PARTICLE_BENCH_FRAMES = 240;
+
+    int RenderEngine::RunParticleBenchmark()
+    {
+        if (!m_HasParticles)
+        {
+            fmt::println("Particles are not supported on this device");
+            return 1;
+        }
+        if (!m_GpuTimer.is_supported)
+        {
+            fmt::println("The graphics queue has no timestamps, nothing to measure");
+            return 1;
+        }
+
+        m_IsParticleBench = true;
+        fmt::println("{:>10s} {:>14s} {:>14s} {:>14s} {:>14s}", "particles", "simulate ms", "draw ms", "gpu frame ms", "cpu frame ms");
+
+        for (uint32_t particle_count : PARTICLE_BENCH_COUNTS)
+        {
+            if (particle_count > m_ParticleCapacity)
+            {
+                fmt::println("{:>10} skipped, the pools hold {}", particle_count, m_ParticleCapacity);
+                continue;
+            }
+
+            // Start from empty pools and fill them in one burst that outlives the run,
+            // every measured frame simulates, compacts and draws exactly particle_count particles
+            vkDeviceWaitIdle(m_Device.logical);
+            m_ResetParticles = true;
+            m_ParticleEmitters.Clear();
+            m_ParticleEmitters.Add(glm::vec2(FIELD_WIDTH * 0.5f, FIELD_HEIGHT * 0.5f), particle_count, 6.0f, 1e9f, 0.05f, glm::vec4(1.0f));
+
+            for (uint32_t i = 0; i < PARTICLE_BENCH_WARMUP_FRAMES; i++)
+            {
+                Draw();
+            }
+
+            vkDeviceWaitIdle(m_Device.logical);
+            m_GpuTimer.ResetStats();
+
+            // Timings are collected when a slot comes around again, FRAME_OVERLAP frames behind,
+            // every one of them ran at the same particle count
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < PARTICLE_BENCH_FRAMES; i++)
+            {
+                Draw();
+            }
+            vkDeviceWaitIdle(m_Device.logical);
+            std::chrono::duration<double, std::milli> total_time = std::chrono::steady_clock::now() - start;
+
+            fmt::println("{:>10} {:>14.3f} {:>14.3f} {:>14.3f} {:>14.3f}", particle_count,
+                m_GpuTimer.stats[GPU_SCOPE_PARTICLE_SIMULATE].AverageMs(),
+                m_GpuTimer.stats[GPU_SCOPE_PARTICLE_DRAW].AverageMs(),
+                m_GpuTimer.stats[GPU_SCOPE_FRAME].AverageMs(),
+                total_time.count() / PARTICLE_BENCH_FRAMES);
+        }
+
+        return 0;
+    }
+
+    // Frames per performance scenario, timings are only taken once pools and caches are warm
+    constexpr uint32_t PERF_WARMUP_FRAMES = 30;
+    constexpr uint32_t PERF_FRAMES = 240;
+    // Runs of each engine microbenchmark, averaged
+    constexpr uint32_t PERF_MICRO_RUNS = 64;
+    // Objects per DestroyerQueue flush and descriptor sets per pool in the microbenchmarks
+    constexpr uint32_t PERF_MICRO_BATCH = 1024;
+
+    int RenderEngine::RunPerfSuite()
+    {
+        PerfResults results;
+        VkPhysicalDeviceProperties device_props = {};
+        vkGetPhysicalDeviceProperties(m_Device.physical, &device_props);
+        results.device = device_props.deviceName;
+        fmt::println("Performance suite on {:s}", results.device);
+
+        // The suite puts the world into each scenario's state and keeps it there
+        m_IsReplaying = true;
+        const GpuMesh* scene_mesh = m_SceneMesh;
+        bool has_particles = m_HasParticles;
+
+        std::array<uint8_t, BRICK_COUNT> full_level;
+        full_level.fill(3);
+
+        // Background and post passes only
+        m_World.LoadLevel({});
+        m_SceneMesh = nullptr;
+        m_HasParticles = false;
+        RunPerfScenario("empty", results);
+
+        if (scene_mesh != nullptr)
+        {
+            m_World.LoadLevel(full_level);
+            m_SceneMesh = scene_mesh;
+            RunPerfScenario(fmt::format("bricks_{}", BRICK_COUNT), results);
+        }
+        else
+        {
+            fmt::println("No cube mesh, the brick scenario is skipped");
+        }
+
+        if (has_particles)
+        {
+            // One burst that outlives the run, every measured frame simulates and draws the same count
+            vkDeviceWaitIdle(m_Device.logical);
+            m_World.LoadLevel({});
+            m_SceneMesh = nullptr;
+            m_HasParticles = true;
+            m_IsParticleBench = true;
+            m_ResetParticles = true;
+            m_ParticleEmitters.Clear();
+            m_ParticleEmitters.Add(glm::vec2(FIELD_WIDTH * 0.5f, FIELD_HEIGHT * 0.5f), std::min(PERF_PARTICLE_COUNT, m_ParticleCapacity),
+                                   6.0f, 1e9f, 0.05f, glm::vec4(1.0f));
+            RunPerfScenario(fmt::format("particles_{}", PERF_PARTICLE_COUNT), results);
+            m_IsParticleBench = false;
+        }
+        else
+        {
+            fmt::println("Particles are not supported on this device, the particle scenario is skipped");
+        }
+
+        // Command recording measures the full brick field's passes
+        m_World.LoadLevel(full_level);
+        m_SceneMesh = scene_mesh;
+        vkDeviceWaitIdle(m_Device.logical);
+
+        results.Add("micro.destroyer_flush_us", TimeDestroyerFlush());
+        results.Add("micro.descriptor_alloc_us", TimeDescriptorAllocation());
+        results.Add("micro.command_record_us", TimeCommandRecording());
+        results.Add("micro.collision_tick_us", Perf::TimeCollisionTick());
+        results.Add("micro.audio_mix_block_us", Audio::TimeMixBlock());
+
+        bool is_written = Perf::WriteJson(m_Config.perf_output.c_str(), results);
+        if (m_Config.perf_baseline.empty())
+        {
+            return is_written ? 0 : 1;
+        }
+
+        if (m_Config.perf_update_baseline)
+        {
+            bool is_stored = Perf::WriteJson(m_Config.perf_baseline.c_str(), results);
+            fmt::println("Baseline {:s} {:s}", m_Config.perf_baseline, is_stored ? "updated" : "could not be written");
+            return is_written && is_stored ? 0 : 1;
+        }
+
+        std::vector<PerfResult> baseline;
+        if (!Perf::ReadBaseline(m_Config.perf_baseline.c_str(), baseline))
+        {
+            // Not a pass, nothing was checked
+            fmt::println("No baseline at {:s}, nothing compared. --perf-update-baseline stores these results as one", m_Config.perf_baseline);
+            return 1;
+        }
+
+        uint32_t regression_count = Perf::Compare(results, baseline, m_Config.perf_tolerance);
+        fmt::println("{} of {} benchmarks regressed", regression_count, results.entries.size());
+        return is_written && regression_count == 0 ? 0 : 1;
+    }
+
+    void RenderEngine::RunPerfScenario(std::string_view name, PerfResults& results)
+    {
+        for (uint32_t i = 0; i < PERF_WARMUP_FRAMES; i++)
+        {
+            Draw();
+        }
+
+        vkDeviceWaitIdle(m_Device.logical);
+        m_GpuTimer.ResetStats();
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < PERF_FRAMES; i++)
+        {
+            Draw();
+        }
+        vkDeviceWaitIdle(m_Device.logical);
+        std::chrono::duration<double, std::milli> total_time = std::chrono::steady_clock::now() - start;
+
+        results.Add(fmt::format("frame.{:s}.cpu_ms", name), total_time.count() / PERF_FRAMES);
+        if (m_GpuTimer.is_supported)
+        {
+            results.Add(fmt::format("frame.{:s}.gpu_ms", name), m_GpuTimer.stats[GPU_SCOPE_FRAME].AverageMs());
+        }
+    }
+
+    double RenderEngine::TimeDestroyerFlush()
+    {
+        VkSemaphoreCreateInfo semaphore_info = VkConstructors::SemaphoreCreateInfo(0);
+
+        std::chrono::steady_clock::duration total_time = {};
+        for (uint32_t run = 0; run < PERF_MICRO_RUNS; run++)
+        {
+            DestroyerQueue queue;
+            for (uint32_t i = 0; i < PERF_MICRO_BATCH; i++)
+            {
+                Destroyable dstr_semaphore = {};
+                VkResult result = vkCreateSemaphore(m_Device.logical, &semaphore_info, nullptr, &dstr_semaphore.semaphore);
+                OB3D_VK_CHECK(result, "Failed to create benchmark semaphore");
+                dstr_semaphore.type = DestroyableVkType::DESTROYABLE_SEMAPHORE;
+                queue.Push(dstr_semaphore);
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            queue.Flush();
+            total_time += std::chrono::steady_clock::now() - start;
+        }
+
+        std::chrono::duration<double, std::micro> total_us = total_time;
+        return total_us.count() / PERF_MICRO_RUNS;
+    }
+
+    double RenderEngine::TimeDescriptorAllocation()
+    {
+        std::array<VkConstructors::DescriptorAllocator::PoolSizeRatio, 1> pool_ratios = { {
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+        } };
+        VkConstructors::DescriptorAllocator allocator = {};
+        allocator.InitPool(m_Device.logical, PERF_MICRO_BATCH, pool_ratios);
+
+        std::chrono::steady_clock::duration total_time = {};
+        for (uint32_t run = 0; run < PERF_MICRO_RUNS; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < PERF_MICRO_BATCH; i++)
+            {
+                allocator.Allocate(m_Device.logical, m_DrawImgDescriptorLayout);
+            }
+            allocator.ClearDescriptors(m_Device.logical);
+            total_time += std::chrono::steady_clock::now() - start;
+        }
+        allocator.DestroyPool(m_Device.logical);
+
+        std::chrono::duration<double, std::micro> total_us = total_time;
+        return total_us.count() / PERF_MICRO_RUNS;
+    }
+
+    double RenderEngine::TimeCommandRecording()
+    {
+        // The per frame passes Draw() records every frame, the cached segments aside
+        // Recorded into the immediate command buffer and never submitted
+        if (m_SceneMesh != nullptr)
+        {
+            PrepareScene();
+        }
+
+        // The passes' GPU scopes would be marked written in the current slot although their queries never run
+        m_GpuTimer.is_suspended = true;
+        std::chrono::steady_clock::duration total_time = {};
+        for (uint32_t run = 0; run < PERF_MICRO_RUNS; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            VkResult result = vkResetCommandBuffer(m_ImmCommandBuffer, 0);
+            OB3D_VK_CHECK(result, "Failed to reset immediate command buffer");
+            VkCommandBufferBeginInfo begin_info = VkConstructors::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            result = vkBeginCommandBuffer(m_ImmCommandBuffer, &begin_info);
+            OB3D_VK_CHECK(result, "Failed to begin immediate command buffer");
+
+            if (m_SceneMesh != nullptr)
+            {
+                DrawShadows(m_ImmCommandBuffer);
+                DrawScene(m_ImmCommandBuffer);
+            }
+            if (m_HasParticles)
+            {
+                DrawParticles(m_ImmCommandBuffer);
+            }
+
+            result = vkEndCommandBuffer(m_ImmCommandBuffer);
+            OB3D_VK_CHECK(result, "Failed to end immediate command buffer");
+            total_time += std::chrono::steady_clock::now() - start;
+        }
+        m_GpuTimer.is_suspended = false;
+
+        std::chrono::duration<double, std::micro> total_us = total_time;
+        return total_us.count() / PERF_MICRO_RUNS;
+    }
+
+    void RenderEngine::RenderLoop()
+    {
+        while (m_IsRunning)
+        {
+            if (!m_IsIdle)
+            {
+                // Replays and benchmarks call Draw themselves and run as fast as they can
+                m_FramePacer.WaitForNextFrame();
+                Draw();
+                m_FramePacer.EndFrame(m_LastPresentNs, m_GpuTimer.is_supported ? m_GpuTimer.stats[GPU_SCOPE_FRAME].last_ms : 0.0);
+            }
+
+            if (m_Config.frame_limit != 0 && uint32_t(m_FrameCount) >= m_Config.frame_limit)
+            {
+                m_IsRunning = false;
+            }
+        }
+    }
+
+    void RenderEngine::SampleInput()
+    {
+        PollInput();
+        if (!m_IsReplaying)
+        {
+            UpdateSimulation();
+        }
+    }
+
+    void RenderEngine::UpdateSimulation()
+    {
+        constexpr int64_t tick_ns = 1000000000 / SIM_TICK_RATE;
+
+        int64_t now_ns = Input::NowNs();
+        if (m_LastSimTimeNs == 0)
+        {
+            m_LastSimTimeNs = now_ns;
+        }
+
+        m_SimAccumulatorNs = std::min(m_SimAccumulatorNs + (now_ns - m_LastSimTimeNs), tick_ns * MAX_SIM_CATCHUP_TICKS);
+        m_LastSimTimeNs = now_ns;
+
+        while (m_SimAccumulatorNs >= tick_ns)
+        {
+            TickInput input = {};
+            input.paddle_axis = int8_t(m_InputState.PaddleAxis());
+            input.buttons = m_InputState.launch_pressed ? BUTTON_LAUNCH : 0;
+            m_InputState.launch_pressed = false;
+
+            m_World.Tick(input);
+            if (m_Recorder.is_recording)
+            {
+                m_Recorder.Record(input, m_World);
+            }
+            if (m_HasParticles)
+            {
+                m_ParticleEmitters.AddSimEvents(m_World);
+            }
+            if (m_Audio.IsActive())
+            {
+                m_Audio.AddSimEvents(m_World);
+            }
+
+            m_SimAccumulatorNs -= tick_ns;
+        }
+    }
+
+    void RenderEngine::PollInput()
+    {
+        InputEvent event;
+        while (m_InputQueue.TryPop(event))
+        {
+            m_InputState.Apply(event);
+            if (m_PendingInputNs == 0)
+            {
+                m_PendingInputNs = event.timestamp_ns;
+            }
+        }
+    }
+
+    void RenderEngine::Draw()
+    {
+        if (!m_Config.low_latency)
+        {
+            SampleInput();
+        }
+
+        if (m_InputState.reload_shaders_pressed)
+        {
+            m_InputState.reload_shaders_pressed = false;
+            ReloadShaders();
+        }
+
+        // Wait until the GPU has finished rendering the last frame. Timeout of 1 sec
+        VkResult result = vkWaitForFences(m_Device.logical, 1, &GetCurrentFrame().render_fence, true, 1000000000);
+        OB3D_VK_CHECK(result, "Fence timeout!");
+        GetCurrentFrame().frame_queue.Flush();
+        // Nothing from this frame's previous use is in flight anymore
+        GetCurrentFrame().frame_allocator.Reset();
+        if (m_FrameCapture.IsActive())
+        {
+            CollectCaptures(m_FrameCount % FRAME_OVERLAP);
+        }
+
+        result = vkResetFences(m_Device.logical, 1, &GetCurrentFrame().render_fence);
+
+        // Request image from the swapchain
+        // If the swapchain doesn't have any image we can use it will block the
+        // calling thread with the timeout specified which is 1 sec (in nanoseconds)
+        uint32_t swapchain_img_idx = 0;
+        if (!m_Config.headless)
+        {
+            vkAcquireNextImageKHR(m_Device.logical, m_Swapchain, 1000000000, GetCurrentFrame().swapchain_semaphore, nullptr, &swapchain_img_idx);
+        }
+
+        // Everything that could block is behind us, input sampled now is as fresh as it gets for this frame
+        if (m_Config.low_latency)
+        {
+            SampleInput();
+        }
+
+        VkCommandBuffer cmd_buff = GetCurrentFrame().main_command_buffer;
+        result = vkResetCommandBuffer(cmd_buff, 0);
+        OB3D_VK_CHECK(result, "Failed to reset command buffer");
+
+        VkCommandBufferBeginInfo cmd_buffer_begin_info = VkConstructors::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        result = vkBeginCommandBuffer(cmd_buff, &cmd_buffer_begin_info);
+        OB3D_VK_CHECK(result, "Failed to begin command buffer");
+
+        // This slot's previous timings are complete, its fence has been waited on
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.BeginFrame(cmd_buff, frame_slot);
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_FRAME);
+
+        m_DrawExt.width = m_DrawImg.img_ext.width;
+        m_DrawExt.height = m_DrawImg.img_ext.height;
+
+        // Only the scene and the particles change from frame to frame, what comes before and after
+        // them is replayed from the command buffer cache
+        ExecuteSegment(cmd_buff, CachedSegmentKey(SEGMENT_BACKGROUND, 0, frame_slot), 1ull << GPU_SCOPE_BACKGROUND, [this](VkCommandBuffer cmd)
+        {
+            // transition our main draw image into the general layout so we can write into it
+            // we will overwrite it all so we dont care about what the older layout was
+            VkImageFunctions::TransitionImage(cmd, m_DrawImg.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+            DrawBackground(cmd);
+        });
+
+        if (m_SceneMesh != nullptr)
+        {
+            PrepareScene();
+            DrawShadows(cmd_buff);
+            DrawScene(cmd_buff);
+        }
+
+        if (m_HasParticles)
+        {
+            SimulateParticles(cmd_buff);
+            DrawParticles(cmd_buff);
+        }
+
+        // Bloom and present only read the draw image, what's captured is what they start from
+        if (m_FrameCapture.IsActive())
+        {
+            CaptureDrawImage(cmd_buff, frame_slot);
+        }
+
+        if (m_HasBloom || !m_Config.headless)
+        {
+            uint64_t post_scopes = (m_HasBloom ? 1ull << GPU_SCOPE_BLOOM : 0) | (m_UseComputePresent ? 1ull << GPU_SCOPE_PRESENT : 0);
+            ExecuteSegment(cmd_buff, CachedSegmentKey(SEGMENT_POST, swapchain_img_idx, frame_slot), post_scopes, [this, swapchain_img_idx](VkCommandBuffer cmd)
+            {
+                if (m_HasBloom)
+                {
+                    DrawBloom(cmd);
+                }
+
+                if (!m_Config.headless)
+                {
+                    DrawToSwapchain(cmd, swapchain_img_idx);
+                }
+            });
+        }
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_FRAME);
+
+        result = vkEndCommandBuffer(cmd_buff);
+        OB3D_VK_CHECK(result, "Failed to end command buffer!");
+
+        // prepare submissions to the queue
+        // we want to wait on the present semaphore, as that semaphore is signaled when the swapchain is ready
+        // we will signal the render semaphore to indicate rendering has finished
+
+        VkCommandBufferSubmitInfo cmd_submit_info = VkConstructors::CommandBufferSubmitInfo(cmd_buff);
+
+        VkSemaphoreSubmitInfo wait_info = VkConstructors::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR, GetCurrentFrame().swapchain_semaphore);
+        VkSemaphoreSubmitInfo signal_info = VkConstructors::SemaphoreSubmitInfo(VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, GetCurrentFrame().render_semaphore);
+
+        // Headless frames neither wait on an acquired image nor hand one to the presentation engine
+        VkSubmitInfo2 submit_info_2 = m_Config.headless
+                                      ? VkConstructors::SubmitInfo2(&cmd_submit_info, nullptr, nullptr)
+                                      : VkConstructors::SubmitInfo2(&cmd_submit_info, &signal_info, &wait_info);
+
+        // Submit the command buffer to the queue and execute it
+        // render fence will now block until the graphics commands finish execution
+        result = vkQueueSubmit2(m_GraphicsQueue, 1, &submit_info_2, GetCurrentFrame().render_fence);
+        OB3D_VK_CHECK(result, "Failed to submit info to the graphics queue");
+
+        if (!m_Config.headless)
+        {
+            // prepare present
+            // put the image we just rendered to into the visible window
+            // we want to wait on the render semaphore for that
+            // as its necessary that drawing commands have finished before the image is displayed to the user
+            VkPresentInfoKHR present_info = {};
+            present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+            present_info.pNext = nullptr;
+            present_info.pSwapchains = &m_Swapchain;
+            present_info.swapchainCount = 1;
+
+            present_info.pWaitSemaphores = &GetCurrentFrame().render_semaphore;
+            present_info.waitSemaphoreCount = 1;
+
+            present_info.pImageIndices = &swapchain_img_idx;
+
+            result = vkQueuePresentKHR(m_GraphicsQueue, &present_info);
+            OB3D_VK_CHECK(result, "Failed to present to the graphics queue!");
+        }
+
+        int64_t present_ns = Input::NowNs();
+        if (m_LastPresentNs != 0)
+        {
+            m_FrameStats.AddFrameTime(present_ns - m_LastPresentNs);
+        }
+        m_LastPresentNs = present_ns;
+
+        if (m_PendingInputNs != 0)
+        {
+            m_FrameStats.AddInputLatency(present_ns - m_PendingInputNs);
+            m_PendingInputNs = 0;
+        }
+
+        if (m_Config.stats_interval != 0 && m_FrameCount % m_Config.stats_interval == 0)
+        {
+            m_FrameStats.Print(m_FrameCount);
+            m_FrameStats.Reset();
+            m_GpuTimer.Print();
+            m_GpuTimer.ResetStats();
+        }
+
+        UpdateMemoryStats();
+
+        // increment frame number
+        m_FrameCount++;
+    }
+
+    static_assert(CAPTURE_RING_SIZE > FRAME_OVERLAP, "Golden runs wait for a capture slot the GPU isn't using");
+
+    void RenderEngine::CaptureDrawImage(VkCommandBuffer cmd_buff, uint32_t frame_slot)
+    {
+        auto find_free_slot = [this]()
+        {
+            uint32_t slot_idx = 0;
+            while (slot_idx < CAPTURE_RING_SIZE && (m_CaptureSlots[slot_idx].is_in_flight || !m_FrameCapture.IsSlotFree(slot_idx)))
+            {
+                slot_idx++;
+            }
+            return slot_idx;
+        };
+
+        uint32_t slot_idx = find_free_slot();
+        // A golden run has to compare every frame, it waits for the worker to give back one of the slots it holds.
+        // This frame's slots were collected already, so at most FRAME_OVERLAP - 1 of them are still on the GPU
+        if (slot_idx == CAPTURE_RING_SIZE && m_FrameCapture.IsComparing())
+        {
+            uint32_t worker_slot_mask = 0;
+            for (uint32_t i = 0; i < CAPTURE_RING_SIZE; i++)
+            {
+                worker_slot_mask |= m_CaptureSlots[i].is_in_flight ? 0 : 1u << i;
+            }
+            m_FrameCapture.WaitForSlot(worker_slot_mask);
+            slot_idx = find_free_slot();
+        }
+
+        // Otherwise waiting for the worker would stall the frame, a gap in the capture is the lesser evil
+        if (slot_idx == CAPTURE_RING_SIZE)
+        {
+            m_FrameCapture.dropped_count++;
+            return;
+        }
+
+        CaptureSlot& slot = m_CaptureSlots[slot_idx];
+        VkDeviceSize size = VkDeviceSize(m_DrawImg.img_ext.width) * m_DrawImg.img_ext.height * Capture::BytesPerPixel(m_DrawImg.img_format);
+        // First use, or the draw image has grown since
+        if (slot.buffer.size < size)
+        {
+            if (slot.buffer.buffer != VK_NULL_HANDLE)
+            {
+                RetireBuffer(slot.buffer);
+            }
+            slot.buffer = CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, BufferMemoryType::BUFFER_HOST_READBACK);
+        }
+
+        // Waits for the color writes of the scene and particle passes, the layout stays GENERAL
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL);
+        VkImageFunctions::CopyImageToBuffer(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, slot.buffer.buffer,
+                                            { m_DrawImg.img_ext.width, m_DrawImg.img_ext.height });
+        // The fence alone doesn't make transfer writes visible to the host
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT);
+
+        slot.extent = m_DrawImg.img_ext;
+        slot.format = m_DrawImg.img_format;
+        slot.frame_idx = uint32_t(m_FrameCount);
+        slot.frame_slot = frame_slot;
+        slot.is_in_flight = true;
+    }
+
+    void RenderEngine::CollectCaptures(uint32_t frame_slot)
+    {
+        for (uint32_t slot_idx = 0; slot_idx < CAPTURE_RING_SIZE; slot_idx++)
+        {
+            CaptureSlot& slot = m_CaptureSlots[slot_idx];
+            if (!slot.is_in_flight || slot.frame_slot != frame_slot)
+            {
+                continue;
+            }
+
+            // Readback memory may be cached and not coherent
+            VkResult result = vmaInvalidateAllocation(m_VmaAlloc, slot.buffer.alloc, 0, VK_WHOLE_SIZE);
+            OB3D_VK_CHECK(result, "Failed to invalidate capture buffer");
+
+            CapturedFrame frame = {};
+            frame.pixels = slot.buffer.mapped;
+            frame.slot_idx = slot_idx;
+            frame.frame_idx = slot.frame_idx;
+            frame.width = slot.extent.width;
+            frame.height = slot.extent.height;
+            frame.format = slot.format;
+            m_FrameCapture.Submit(frame);
+
+            slot.is_in_flight = false;
+        }
+    }
+
+    bool RenderEngine::FinishCapture()
+    {
+        if (!m_FrameCapture.IsActive())
+        {
+            return true;
+        }
+
+        // The copies of the last FRAME_OVERLAP frames are still waiting on their fences
+        vkDeviceWaitIdle(m_Device.logical);
+        for (uint32_t frame_slot = 0; frame_slot < FRAME_OVERLAP; frame_slot++)
+        {
+            CollectCaptures(frame_slot);
+        }
+        return m_FrameCapture.Stop();
+    }
+
+    void RenderEngine::PushCaptureBuffers(DestroyerQueue& queue)
+    {
+        for (CaptureSlot& slot : m_CaptureSlots)
+        {
+            if (slot.buffer.buffer == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+
+            Destroyable dstr_buffer = {};
+            dstr_buffer.buffer = slot.buffer.buffer;
+            dstr_buffer.allocation = slot.buffer.alloc;
+            dstr_buffer.type = DestroyableVkType::DESTROYABLE_BUFFER;
+            queue.Push(dstr_buffer);
+            slot = {};
+        }
+    }
+
+    void RenderEngine::UpdateMemoryStats()
+    {
+        // Lets VMA refresh its cached budget numbers periodically
+        vmaSetCurrentFrameIndex(m_VmaAlloc, uint32_t(m_FrameCount));
+
+        if (m_Config.mem_stats_interval != 0 && m_FrameCount % m_Config.mem_stats_interval == 0)
+        {
+            MemoryReport report = MemoryStats::Calculate(m_VmaAlloc);
+            if (m_Config.mem_stats_json)
+            {
+                MemoryStats::PrintJson(report, m_FrameCount);
+            }
+            else
+            {
+                MemoryStats::Print(report, m_FrameCount);
+            }
+        }
+
+        if (m_FrameCount % BUDGET_CHECK_INTERVAL != 0
+            || !MemoryStats::IsOverBudget(m_VmaAlloc, m_Config.budget_pressure_ratio))
+        {
+            return;
+        }
+
+        // Give memory back before the driver starts paging
+        if (m_RenderScale > MIN_RENDER_SCALE)
+        {
+            m_RenderScale = std::max(MIN_RENDER_SCALE, m_RenderScale - RENDER_SCALE_STEP);
+            OB3D_LOG("Memory budget pressure, lowering render scale to {:.2f}", m_RenderScale);
+            RecreateDrawImage();
+        }
+    }
+
+    static uint32_t WorkgroupCount(uint32_t size, uint32_t workgroup_size)
+    {
+        return (size + workgroup_size - 1) / workgroup_size;
+    }
+
+    static void SetViewportAndScissor(VkCommandBuffer cmd_buff, VkExtent2D extent)
+    {
+        VkViewport viewport = {};
+        viewport.width = float(extent.width);
+        viewport.height = float(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmd_buff, 0, 1, &viewport);
+
+        VkRect2D scissor = { { 0, 0 }, extent };
+        vkCmdSetScissor(cmd_buff, 0, 1, &scissor);
+    }
+
+    void RenderEngine::DrawBackground(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_BACKGROUND);
+
+        const WorkgroupShape& shape = m_KernelShapes[KERNEL_BACKGROUND];
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BackgroundPipeline);
+        vkCmdBindDescriptorSets(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BackgroundPipelineLayout, 0, 1, &m_DrawImgDescriptors, 0, nullptr);
+        vkCmdDispatch(cmd_buff, WorkgroupCount(m_DrawExt.width, shape.x), WorkgroupCount(m_DrawExt.height, shape.y), 1);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_BACKGROUND);
+    }
+
+    // Share of the albedo that stays lit in shadow
+    constexpr float SCENE_AMBIENT = 0.25f;
+
+    void RenderEngine::PrepareScene()
+    {
+        m_SceneCamera = Scene::FieldCamera(m_DrawExt);
+        glm::vec3 light_dir = Scene::LightDirection();
+        m_ShadowCascades = Scene::ComputeCascades(m_SceneCamera, light_dir, m_ShadowMap.img_ext.width);
+
+        m_SceneInstances.clear();
+        uint32_t caster_count = Scene::BuildInstances(m_World, m_SceneInstances);
+        std::span<const GpuSceneInstance> casters(m_SceneInstances.data(), caster_count);
+
+        // Each cascade only draws the casters that reach into it, one instanced draw per cascade
+        m_ShadowCasters.clear();
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            m_CascadeCasterCounts[cascade] = m_HasShadows ? Scene::CullCasters(m_ShadowCascades[cascade], casters, m_ShadowCasters) : 0;
+        }
+
+        GpuSceneFrame frame = {};
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            frame.cascade_view_proj[cascade] = m_ShadowCascades[cascade].view_proj;
+            frame.cascade_splits[cascade] = m_ShadowCascades[cascade].split_depth;
+            frame.cascade_texel_sizes[cascade] = m_ShadowCascades[cascade].texel_size;
+        }
+        frame.light_dir = glm::vec4(light_dir, 0.0f);
+        frame.light_color = glm::vec4(1.0f, 0.96f, 0.9f, SCENE_AMBIENT);
+        frame.camera_pos = glm::vec4(m_SceneCamera.position, 1.0f);
+        frame.camera_forward = glm::vec4(m_SceneCamera.forward, 0.0f);
+        frame.shadow_params.x = 1.0f / float(m_ShadowMap.img_ext.width);
+
+        GpuLinearAllocator& frame_gpu = GetCurrentFrame().frame_allocator.gpu;
+        m_SceneInstanceAddr = frame_gpu.Upload(std::span<const GpuSceneInstance>(m_SceneInstances)).device_addr;
+        m_ShadowCasterAddr = m_ShadowCasters.empty() ? 0 : frame_gpu.Upload(std::span<const GpuSceneInstance>(m_ShadowCasters)).device_addr;
+        m_SceneFrameAddr = frame_gpu.Upload(std::span<const GpuSceneFrame>(&frame, 1)).device_addr;
+    }
+
+    void RenderEngine::DrawShadows(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_SHADOWS);
+
+        // Every cascade is cleared and redrawn, last frame's contents don't matter
+        VkImageFunctions::TransitionImage(cmd_buff, m_ShadowMap.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+        VkExtent2D map_extent = { m_ShadowMap.img_ext.width, m_ShadowMap.img_ext.height };
+        SetViewportAndScissor(cmd_buff, map_extent);
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ScenePipelines.shadow);
+        vkCmdBindIndexBuffer(cmd_buff, m_SceneMesh->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+        uint32_t first_caster = 0;
+        for (uint32_t cascade = 0; cascade < SHADOW_CASCADE_COUNT; cascade++)
+        {
+            VkClearValue depth_clear = {};
+            depth_clear.depthStencil.depth = 1.0f;
+            VkRenderingAttachmentInfo depth_attachment = VkConstructors::AttachmentInfo(m_ShadowCascadeViews[cascade], &depth_clear, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+            VkRenderingInfo rendering_info = VkConstructors::RenderingInfo(map_extent, nullptr, &depth_attachment);
+            vkCmdBeginRendering(cmd_buff, &rendering_info);
+
+            uint32_t caster_count = m_CascadeCasterCounts[cascade];
+            if (caster_count > 0)
+            {
+                ScenePushConstants push_constants = {};
+                push_constants.view_proj = m_ShadowCascades[cascade].view_proj;
+                push_constants.vertices = m_SceneMesh->vertex_buffer.device_addr;
+                push_constants.instances = m_ShadowCasterAddr;
+                push_constants.frame = m_SceneFrameAddr;
+                vkCmdPushConstants(cmd_buff, m_ScenePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   0, sizeof(ScenePushConstants), &push_constants);
+                vkCmdDrawIndexed(cmd_buff, m_SceneMesh->index_count, caster_count, 0, 0, first_caster);
+            }
+
+            vkCmdEndRendering(cmd_buff);
+            first_caster += caster_count;
+        }
+
+        VkImageFunctions::TransitionImage(cmd_buff, m_ShadowMap.img, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_SHADOWS);
+    }
+
+    void RenderEngine::DrawScene(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_SCENE);
+
+        const AllocatedImage& depth_img = m_TransientImages.Get(m_DepthImage);
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkImageFunctions::TransitionImage(cmd_buff, depth_img.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+
+        VkClearValue depth_clear = {};
+        depth_clear.depthStencil.depth = 1.0f;
+        VkRenderingAttachmentInfo color_attachment = VkConstructors::AttachmentInfo(m_DrawImg.img_view, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderingAttachmentInfo depth_attachment = VkConstructors::AttachmentInfo(depth_img.img_view, &depth_clear, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL);
+        // Nothing reads the depth after this pass, tilers can drop it instead of writing it out
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        VkRenderingInfo rendering_info = VkConstructors::RenderingInfo(m_DrawExt, &color_attachment, &depth_attachment);
+        vkCmdBeginRendering(cmd_buff, &rendering_info);
+        SetViewportAndScissor(cmd_buff, m_DrawExt);
+
+        ScenePushConstants push_constants = {};
+        push_constants.view_proj = m_SceneCamera.view_proj;
+        push_constants.vertices = m_SceneMesh->vertex_buffer.device_addr;
+        push_constants.instances = m_SceneInstanceAddr;
+        push_constants.frame = m_SceneFrameAddr;
+        vkCmdPushConstants(cmd_buff, m_ScenePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(ScenePushConstants), &push_constants);
+        vkCmdBindIndexBuffer(cmd_buff, m_SceneMesh->index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+        uint32_t instance_count = uint32_t(m_SceneInstances.size());
+        if (m_ScenePipelines.prepass != VK_NULL_HANDLE)
+        {
+            vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ScenePipelines.prepass);
+            vkCmdDrawIndexed(cmd_buff, m_SceneMesh->index_count, instance_count, 0, 0, 0);
+        }
+
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ScenePipelines.opaque);
+        vkCmdBindDescriptorSets(cmd_buff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ScenePipelineLayout, 0, 1, &m_SceneDescriptors, 0, nullptr);
+        vkCmdDrawIndexed(cmd_buff, m_SceneMesh->index_count, instance_count, 0, 0, 0);
+
+        vkCmdEndRendering(cmd_buff);
+
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_SCENE);
+    }
+
+    // Units are world units and seconds
+    constexpr float PARTICLE_GRAVITY = 9.0f;
+    constexpr float PARTICLE_DRAG = 1.5f;
+    // A hitch doesn't fling every particle across the screen
+    constexpr float MAX_PARTICLE_DT = 1.0f / 20.0f;
+
+    void RenderEngine::SimulateParticles(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_PARTICLE_SIMULATE);
+
+        // Both pools are shared by the frames in flight, wait for the previous frame's particle passes
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+        if (m_ResetParticles)
+        {
+            GpuParticleCounters counters = {};
+            counters.simulate_dispatch = { 0, 1, 1 };
+            counters.draw = { PARTICLE_QUAD_VERTICES, 0, 0, 0 };
+            vkCmdUpdateBuffer(cmd_buff, m_ParticleCounters.buffer, 0, sizeof(counters), &counters);
+
+            VkImageFunctions::GlobalBarrier(cmd_buff,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+                VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT);
+
+            m_ParticleSlot = 0;
+            m_ResetParticles = false;
+        }
+
+        int64_t now_ns = Input::NowNs();
+        float dt = m_LastParticleTimeNs == 0 ? 0.0f : float(now_ns - m_LastParticleTimeNs) / 1e9f;
+        m_LastParticleTimeNs = now_ns;
+        // Replays step the simulation by a fixed amount per frame, so the particles render the same frames on every run
+        if (m_IsReplaying)
+        {
+            dt = 1.0f / float(REPLAY_FRAME_RATE);
+        }
+
+        ParticleComputePushConstants push_constants = {};
+        push_constants.src_particles = m_ParticlePools[m_ParticleSlot].device_addr;
+        push_constants.dst_particles = m_ParticlePools[m_ParticleSlot ^ 1].device_addr;
+        push_constants.counters = m_ParticleCounters.device_addr;
+        push_constants.capacity = m_ParticleCapacity;
+        push_constants.src_slot = m_ParticleSlot;
+        push_constants.dst_slot = m_ParticleSlot ^ 1;
+        push_constants.dt = std::min(dt, MAX_PARTICLE_DT);
+        // The benchmark keeps its particles on screen so the draw pass pays for real fill
+        push_constants.gravity = m_IsParticleBench ? 0.0f : PARTICLE_GRAVITY;
+        push_constants.drag = PARTICLE_DRAG;
+
+        if (m_ParticleEmitters.particle_count > 0)
+        {
+            std::span<const GpuParticleEmitter> emitters = m_ParticleEmitters.emitters;
+            push_constants.emitters = GetCurrentFrame().frame_allocator.gpu.Upload(emitters).device_addr;
+            push_constants.emitter_count = uint32_t(emitters.size());
+            push_constants.emit_total = m_ParticleEmitters.particle_count;
+        }
+
+        // Simulate and compact, sized by the count the previous frame's finalize pass wrote
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_ParticlePipelines.simulate);
+        vkCmdPushConstants(cmd_buff, m_ParticleComputeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticleComputePushConstants), &push_constants);
+        vkCmdDispatchIndirect(cmd_buff, m_ParticleCounters.buffer, offsetof(GpuParticleCounters, simulate_dispatch));
+
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        // Append this frame's bursts behind the survivors, the layout is shared so the constants stay bound
+        if (push_constants.emit_total > 0)
+        {
+            vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_ParticlePipelines.emit);
+            vkCmdDispatch(cmd_buff, (push_constants.emit_total + PARTICLE_WORKGROUP_SIZE - 1) / PARTICLE_WORKGROUP_SIZE, 1, 1);
+
+            VkImageFunctions::GlobalBarrier(cmd_buff,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+        }
+        m_ParticleEmitters.Clear();
+
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_ParticlePipelines.finalize);
+        vkCmdDispatch(cmd_buff, 1, 1, 1);
+
+        // The finalize pass wrote the draw arguments
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+            VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_PARTICLE_SIMULATE);
+
+        // Survivors and new particles are in the other pool now
+        m_ParticleSlot ^= 1;
+    }
+
+    void RenderEngine::DrawParticles(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_PARTICLE_DRAW);
+
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+        VkRenderingAttachmentInfo color_attachment = VkConstructors::AttachmentInfo(m_DrawImg.img_view, nullptr, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        VkRenderingInfo rendering_info = VkConstructors::RenderingInfo(m_DrawExt, &color_attachment, nullptr);
+        vkCmdBeginRendering(cmd_buff, &rendering_info);
+        SetViewportAndScissor(cmd_buff, m_DrawExt);
+
+        ParticleDrawPushConstants push_constants = {};
+        push_constants.view_proj = Particles::FieldViewProj(m_DrawExt);
+        push_constants.particles = m_ParticlePools[m_ParticleSlot].device_addr;
+
+        // One instance per live particle, the count never comes back to the CPU
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ParticlePipelines.draw);
+        vkCmdPushConstants(cmd_buff, m_ParticleDrawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawPushConstants), &push_constants);
+        vkCmdDrawIndirect(cmd_buff, m_ParticleCounters.buffer, offsetof(GpuParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+
+        vkCmdEndRendering(cmd_buff);
+
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_PARTICLE_DRAW);
+    }
+
+    // Brightness range below the threshold that fades into the bloom
+    constexpr float BLOOM_KNEE = 0.5f;
+    // Share of the wider levels in every upsample step
+    constexpr float BLOOM_SCATTER = 0.7f;
+
+    static VkExtent2D BloomMipExtent(const AllocatedImage& bloom_img, uint32_t mip)
+    {
+        return { std::max(1u, bloom_img.img_ext.width >> mip), std::max(1u, bloom_img.img_ext.height >> mip) };
+    }
+
+    void RenderEngine::DrawBloom(VkCommandBuffer cmd_buff)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_BLOOM);
+
+        // The background and particle draws into the draw image have to land before it is read
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+        // Transient, whatever shared the memory before left garbage behind
+        const AllocatedImage& bloom_img = m_TransientImages.Get(m_BloomImage);
+        VkImageFunctions::TransitionImage(cmd_buff, bloom_img.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+        VkExtent2D mip0_extent = BloomMipExtent(bloom_img, 0);
+
+        BloomDownsamplePushConstants downsample_constants = {};
+        downsample_constants.src_extent = glm::ivec2(m_DrawExt.width, m_DrawExt.height);
+        downsample_constants.mip0_extent = glm::ivec2(mip0_extent.width, mip0_extent.height);
+        downsample_constants.mip_count = int32_t(m_BloomMipCount);
+        downsample_constants.threshold = m_Config.bloom_threshold;
+        downsample_constants.knee = BLOOM_KNEE;
+
+        // Threshold and the whole mip chain in one dispatch
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BloomDownsamplePipeline);
+        vkCmdBindDescriptorSets(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BloomDownsampleLayout, 0, 1, &m_BloomDownsampleDescriptors, 0, nullptr);
+        vkCmdPushConstants(cmd_buff, m_BloomDownsampleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomDownsamplePushConstants), &downsample_constants);
+        vkCmdDispatch(cmd_buff, WorkgroupCount(mip0_extent.width, BLOOM_DOWNSAMPLE_TILE), WorkgroupCount(mip0_extent.height, BLOOM_DOWNSAMPLE_TILE), 1);
+
+        // Back up from the smallest level, each step reads what the previous one wrote
+        const WorkgroupShape& upsample_shape = m_KernelShapes[KERNEL_BLOOM_UPSAMPLE];
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BloomUpsamplePipeline);
+        for (int32_t mip = int32_t(m_BloomMipCount) - 2; mip >= 0; mip--)
+        {
+            VkImageFunctions::GlobalBarrier(cmd_buff,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+            VkExtent2D src_extent = BloomMipExtent(bloom_img, uint32_t(mip) + 1);
+            VkExtent2D dst_extent = BloomMipExtent(bloom_img, uint32_t(mip));
+
+            BloomUpsamplePushConstants upsample_constants = {};
+            upsample_constants.src_extent = glm::ivec2(src_extent.width, src_extent.height);
+            upsample_constants.dst_extent = glm::ivec2(dst_extent.width, dst_extent.height);
+            upsample_constants.scatter = BLOOM_SCATTER;
+
+            vkCmdBindDescriptorSets(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_BloomUpsampleLayout, 0, 1, &m_BloomUpsampleDescriptors[mip], 0, nullptr);
+            vkCmdPushConstants(cmd_buff, m_BloomUpsampleLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BloomUpsamplePushConstants), &upsample_constants);
+            vkCmdDispatch(cmd_buff, WorkgroupCount(dst_extent.width, upsample_shape.x), WorkgroupCount(dst_extent.height, upsample_shape.y), 1);
+        }
+
+        // Mip 0 is read by the present pass
+        VkImageFunctions::GlobalBarrier(cmd_buff,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_BLOOM);
+    }
+
+    void RenderEngine::DrawToSwapchain(VkCommandBuffer cmd_buff, uint32_t swapchain_img_idx)
+    {
+        if (m_UseComputePresent)
+        {
+            // The draw image stays in GENERAL, the present pass reads it as a storage image
+            VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+
+            DrawPresent(cmd_buff, swapchain_img_idx);
+
+            VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+        else
+        {
+            // transition the draw image and the swapchain image into the correct transfer layouts
+            VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+            // Execute a copy from the draw image to the swapchain image
+            VkImageFunctions::CopyImageToImage(cmd_buff, m_DrawImg.img, m_SwapchainImages[swapchain_img_idx], m_DrawExt, m_SwapchainExtent);
+
+            // Set swapchain image layout to Present so we can show it to the screen
+            VkImageFunctions::TransitionImage(cmd_buff, m_SwapchainImages[swapchain_img_idx], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+    }
+
+    void RenderEngine::DrawPresent(VkCommandBuffer cmd_buff, uint32_t swapchain_img_idx)
+    {
+        uint32_t frame_slot = m_FrameCount % FRAME_OVERLAP;
+        m_GpuTimer.Begin(cmd_buff, frame_slot, GPU_SCOPE_PRESENT);
+
+        PresentPushConstants push_constants = {};
+        push_constants.src_extent = glm::ivec2(m_DrawExt.width, m_DrawExt.height);
+        push_constants.dst_extent = glm::ivec2(m_SwapchainExtent.width, m_SwapchainExtent.height);
+        push_constants.exposure = 1.0f;
+
+        // Sharpening only makes up for detail lost to a lower render scale
+        bool is_upscaling = m_DrawExt.width < m_SwapchainExtent.width || m_DrawExt.height < m_SwapchainExtent.height;
+        push_constants.sharpness = is_upscaling ? m_Config.present_sharpness : 0.0f;
+
+        if (m_HasBloom)
+        {
+            const AllocatedImage& bloom_img = m_TransientImages.Get(m_BloomImage);
+            push_constants.bloom_extent = glm::ivec2(bloom_img.img_ext.width, bloom_img.img_ext.height);
+            push_constants.bloom_intensity = m_Config.bloom_intensity;
+        }
+        else
+        {
+            push_constants.bloom_extent = push_constants.src_extent;
+        }
+
+        vkCmdBindPipeline(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_PresentPipeline);
+        vkCmdBindDescriptorSets(cmd_buff, VK_PIPELINE_BIND_POINT_COMPUTE, m_PresentPipelineLayout, 0, 1, &m_PresentDescriptors[swapchain_img_idx], 0, nullptr);
+        vkCmdPushConstants(cmd_buff, m_PresentPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PresentPushConstants), &push_constants);
+
+        const WorkgroupShape& shape = m_KernelShapes[KERNEL_PRESENT];
+        vkCmdDispatch(cmd_buff, WorkgroupCount(m_SwapchainExtent.width, shape.x), WorkgroupCount(m_SwapchainExtent.height, shape.y), 1);
+
+        m_GpuTimer.End(cmd_buff, frame_slot, GPU_SCOPE_PRESENT);
+    }
+
+    void RenderEngine::ExecuteSegment(VkCommandBuffer cmd_buff, uint32_t key, uint64_t timer_scopes,
+                                      const std::function<void(VkCommandBuffer cmd)>& record)
+    {
+        if (!m_Config.command_cache)
+        {
+            record(cmd_buff);
+            return;
+        }
+
+        VkCommandBuffer cached_cmd = m_CommandCache.Get(key, record);
+        vkCmdExecuteCommands(cmd_buff, 1, &cached_cmd);
+        m_GpuTimer.MarkWritten(m_FrameCount % FRAME_OVERLAP, timer_scopes);
+    }
+
+    void RenderEngine::RecordKernelRun(VkCommandBuffer cmd_buff, ComputeKernel kernel)
+    {
+        // Kernels read what they read in a frame, so the passes before them run as well
+        VkImageFunctions::TransitionImage(cmd_buff, m_DrawImg.img, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+        DrawBackground(cmd_buff);
+
+        if (kernel >= KERNEL_BLOOM_UPSAMPLE && m_HasBloom)
+        {
+            DrawBloom(cmd_buff);
+        }
+
+        if (kernel == KERNEL_PRESENT)
+        {
+            DrawPresent(cmd_buff, 0);
+        }
+    }
+
+    AllocatedBuffer RenderEngine::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, BufferMemoryType memory_type)
+    {
+        // Every buffer can be reached from shaders through its device address
+        VkBufferCreateInfo buffer_info = VkConstructors::BufferCreateInfo(size, usage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT);
+
+        VmaAllocationCreateInfo buffer_alloc_info = {};
+        switch (memory_type)
+        {
+            case BufferMemoryType::BUFFER_DEVICE_LOCAL:
+            {
+                buffer_alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+                break;
+            }
+
+            case BufferMemoryType::BUFFER_HOST_MAPPED:
+            {
+                buffer_alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+                buffer_alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                break;
+            }
+
+            case BufferMemoryType::BUFFER_DEVICE_MAPPED:
+            {
+                // VMA picks a DEVICE_LOCAL | HOST_VISIBLE type when the BAR is resizable
+                // and otherwise drops back to mapped system memory
+                buffer_alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+                buffer_alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                buffer_alloc_info.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                buffer_alloc_info.preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                break;
+            }
+
+            case BufferMemoryType::BUFFER_HOST_READBACK:
+            {
+                buffer_alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+                buffer_alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT;
+                break;
+            }
+        }
+
+        AllocatedBuffer new_buffer = {};
+        VmaAllocationInfo allocation_info = {};
+        VkResult result = vmaCreateBuffer(m_VmaAlloc, &buffer_info, &buffer_alloc_info, &new_buffer.buffer, &new_buffer.alloc, &allocation_info);
+        OB3D_VK_CHECK(result, "Failed to create buffer");
+
+        VkMemoryPropertyFlags memory_props = 0;
+        vmaGetAllocationMemoryProperties(m_VmaAlloc, new_buffer.alloc, &memory_props);
+
+        VkBufferDeviceAddressInfo address_info = {};
+        address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        address_info.pNext = nullptr;
+        address_info.buffer = new_buffer.buffer;
+
+        new_buffer.size = size;
+        new_buffer.device_addr = vkGetBufferDeviceAddress(m_Device.logical, &address_info);
+        new_buffer.mapped = allocation_info.pMappedData;
+        new_buffer.memory_type = memory_type;
+        new_buffer.is_device_local = (memory_props & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0;
+
+        return new_buffer;
+    }
+
+    void RenderEngine::ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function)
+    {
+        VkResult result = vkResetFences(m_Device.logical, 1, &m_ImmFence);
+        OB3D_VK_CHECK(result, "Failed to reset immediate submit fence");
+        result = vkResetCommandBuffer(m_ImmCommandBuffer, 0);
+        OB3D_VK_CHECK(result, "Failed to reset immediate command buffer");
+
+        VkCommandBufferBeginInfo cmd_begin_info = VkConstructors::CommandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        result = vkBeginCommandBuffer(m_ImmCommandBuffer, &cmd_begin_info);
+        OB3D_VK_CHECK(result, "Failed to begin immediate command buffer");
+
+        function(m_ImmCommandBuffer);
+
+        result = vkEndCommandBuffer(m_ImmCommandBuffer);
+        OB3D_VK_CHECK(result, "Failed to end immediate command buffer");
+
+        VkCommandBufferSubmitInfo cmd_submit_info = VkConstructors::CommandBufferSubmitInfo(m_ImmCommandBuffer);
+        VkSubmitInfo2 submit_info = VkConstructors::SubmitInfo2(&cmd_submit_info, nullptr, nullptr);
+
+        result = vkQueueSubmit2(m_GraphicsQueue, 1, &submit_info, m_ImmFence);
+        OB3D_VK_CHECK(result, "Failed to submit immediate command buffer");
+
+        result = vkWaitForFences(m_Device.logical, 1, &m_ImmFence, true, UINT64_MAX);
+        OB3D_VK_CHECK(result, "Failed to wait for immediate submit fence");
+    }
+
+    void RenderEngine::RetireBuffer(const AllocatedBuffer& buffer)
+    {
+        // The frame queue is flushed after this frame's fence is waited on next time around,
+        // by then every frame that could have referenced the buffer has completed
+        Destroyable dstr_buffer = {};
+        dstr_buffer.buffer = buffer.buffer;
+        dstr_buffer.allocation = buffer.alloc;
+        dstr_buffer.type = DestroyableVkType::DESTROYABLE_BUFFER;
+        GetCurrentFrame().frame_queue.Push(dstr_buffer);
+    }
+
+    void RenderEngine::Destroy()
     {
         if (m_IsInitialized)
         {
-            fmt::println("Shutting down...");
+            OB3D_LOG("Shutting down...");
             // Reverse order of creation
             loaded_engine = nullptr;
+            m_Audio.Stop();
             // Vulkan
             //  Rendering
             vkDeviceWaitIdle(m_Device.logical);
@@ -434,13 +3134,27 @@ namespace OB3D
                 vkDestroyFence(m_Device.logical, m_Frames[i].render_fence, nullptr);
                 vkDestroySemaphore(m_Device.logical, m_Frames[i].render_semaphore, nullptr);
                 vkDestroySemaphore(m_Device.logical, m_Frames[i].swapchain_semaphore, nullptr);
+
+                // anything retired during the last frames
+                m_Frames[i].frame_queue.Flush();
             }
+            // Joins the capture worker when a run ended without finishing the capture, it reads the capture buffers
+            m_FrameCapture.Stop();
+            PushCaptureBuffers(global_queue);
+            PushDrawImage(global_queue);
+            m_TransientImages.Release(global_queue);
+            PushPipelines(global_queue);
             //  Core
             global_queue.Flush();
 
+            m_AssetPack.Close();
+
             // GLFW
-            glfwDestroyWindow(m_Window);
-            glfwTerminate();
+            if (m_Window)
+            {
+                glfwDestroyWindow(m_Window);
+                glfwTerminate();
+            }
         }
     }
 
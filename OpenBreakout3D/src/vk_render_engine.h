@@ -2,19 +2,36 @@
 #include "util.h"
 #include "vk_constructors.h"
 #include "vk_image_functions.h"
+#include "vk_pipelines.h"
 #include "destroyer_queue.h"
+#include "vk_types.h"
+#include "frame_allocator.h"
+#include "engine_config.h"
+#include "memory_stats.h"
+#include "transient_image_pool.h"
+#include "input.h"
+#include "frame_stats.h"
+#include "frame_pacer.h"
+#include "simulation.h"
+#include "replay.h"
+#include "asset_pack.h"
+#include "startup_graph.h"
+#include "particle_system.h"
+#include "gpu_timer.h"
+#include "compute_variants.h"
+#include "scene_renderer.h"
+#include "command_cache.h"
+#include "frame_capture.h"
+#include "perf_suite.h"
+#include "audio_system.h"
 
-namespace OB3D
+namespace vkb
 {
-    struct AllocatedImage
-    {
-        VkImage img;
-        VkImageView img_view;
-        VmaAllocation alloc;
-        VkExtent3D img_ext;
-        VkFormat img_format;
-    };
+    struct Instance;
+}
 
+namespace OB3D
+{
     struct FrameData
     {
 
@@ -23,9 +40,118 @@ namespace OB3D
         VkSemaphore swapchain_semaphore, render_semaphore;
         VkFence render_fence;
         DestroyerQueue frame_queue;
+        FrameAllocator frame_allocator;
+    };
+
+    struct PresentPushConstants
+    {
+        glm::ivec2 src_extent;
+        glm::ivec2 dst_extent;
+        float sharpness;
+        float exposure;
+        glm::ivec2 bloom_extent;
+        float bloom_intensity;
+        float pad;
+    };
+
+    // Levels of the bloom chain, bloom_downsample.comp has one binding per level
+    constexpr uint32_t BLOOM_MIP_COUNT = 6;
+    // Mip 0 texels covered by one bloom_downsample workgroup along each side
+    constexpr uint32_t BLOOM_DOWNSAMPLE_TILE = 32;
+    // local_size_x of bloom_downsample.comp, one invocation per 2x2 texels of the tile
+    constexpr uint32_t BLOOM_DOWNSAMPLE_INVOCATIONS = 256;
+
+    struct BloomDownsamplePushConstants
+    {
+        glm::ivec2 src_extent;
+        glm::ivec2 mip0_extent;
+        int32_t mip_count;
+        float threshold;
+        float knee;
+    };
+
+    struct BloomUpsamplePushConstants
+    {
+        glm::ivec2 src_extent;
+        glm::ivec2 dst_extent;
+        float scatter;
+    };
+
+    // Order of the passes within a frame, used for transient image lifetimes
+    enum FramePass : uint32_t
+    {
+        PASS_BACKGROUND,
+        PASS_GEOMETRY,
+        PASS_POST_PROCESS,
+        PASS_PRESENT
+    };
+
+    // Scopes timed on the GPU every frame, printed with the frame statistics
+    enum GpuScope : uint32_t
+    {
+        GPU_SCOPE_FRAME,
+        GPU_SCOPE_BACKGROUND,
+        GPU_SCOPE_SHADOWS,
+        GPU_SCOPE_SCENE,
+        GPU_SCOPE_PARTICLE_SIMULATE,
+        GPU_SCOPE_PARTICLE_DRAW,
+        GPU_SCOPE_BLOOM,
+        GPU_SCOPE_PRESENT,
+        GPU_SCOPE_COUNT
+    };
+
+    constexpr std::array<std::string_view, GPU_SCOPE_COUNT> GPU_SCOPE_NAMES = {
+        "frame", "background", "shadows", "scene", "particle simulate", "particle draw", "bloom", "present"
+    };
+
+    // Parts of the frame replayed from the command buffer cache, everything else is recorded every frame
+    enum CachedSegment : uint32_t
+    {
+        // Draw image transition and background
+        SEGMENT_BACKGROUND,
+        // Bloom and the copy or present pass into one swapchain image
+        SEGMENT_POST
+    };
+
+    constexpr uint32_t CachedSegmentKey(CachedSegment segment, uint32_t swapchain_img_idx, uint32_t frame_slot)
+    {
+        return segment << 16 | (swapchain_img_idx & 0xFF) << 8 | (frame_slot & 0xFF);
+    }
+
+    struct ParticlePipelines
+    {
+        VkPipeline simulate;
+        VkPipeline emit;
+        VkPipeline finalize;
+        VkPipeline draw;
+    };
+
+    struct ScenePipelines
+    {
+        // Depth only into one cascade of the shadow map
+        VkPipeline shadow;
+        // Depth only into the main depth buffer, nullptr without the depth prepass
+        VkPipeline prepass;
+        VkPipeline opaque;
+    };
+
+    // Ring slot of the frame capture, the capture worker owns it while it reads the copy
+    struct CaptureSlot
+    {
+        AllocatedBuffer buffer;
+        VkExtent3D extent;
+        VkFormat format;
+        uint32_t frame_idx;
+        // Frame slot whose fence covers the copy
+        uint32_t frame_slot;
+        // The copy has been recorded and that fence not waited on yet
+        bool is_in_flight;
     };
 
     constexpr unsigned int FRAME_OVERLAP = 2;
+    // Transient memory available to a single frame
+    constexpr size_t FRAME_CPU_ARENA_SIZE = 1024 * 1024;
+    constexpr VkDeviceSize FRAME_GPU_RING_SIZE = 4 * 1024 * 1024;
 
     class RenderEngine
     {
@@ -34,40 +160,263 @@ namespace OB3D
         static RenderEngine &Get();
         FrameData& GetCurrentFrame();
 
-        void Init();
-        void Run();
+        void Init(const EngineConfig& config = {});
+        // Returns the process exit code, failure when a captured frame differed from its golden image
+        int Run();
+        // Headless playback of a recording, returns the process exit code
+        int RunReplay(const ReplayData& replay);
+        // Headless GPU timings of the particle passes at increasing particle counts, returns the process exit code
+        int RunParticleBenchmark();
+        // Headless scenarios and engine microbenchmarks compared against a stored baseline, returns the process exit code
+        int RunPerfSuite();
         void Draw();
         void Destroy();
 
+        // Buffers
+        AllocatedBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, BufferMemoryType memory_type);
+        // Queues the buffer for destruction once the frames that may still be reading it have finished
+        void RetireBuffer(const AllocatedBuffer& buffer);
+        // Records with the function and blocks until the GPU has executed it
+        void ImmediateSubmit(std::function<void(VkCommandBuffer cmd)>&& function);
+
+        // Assets
+        // Switches the simulation to a level from the asset pack, false when the pack has no such level
+        bool LoadLevel(std::string_view name);
+        const GpuMesh* FindMesh(std::string_view name) const;
+
     private:
-        // Initialization
-        void InitVulkan();
+        // Initialization, see Init() for the order the steps run in
+        void InitWindow();
+        void InitSimulation();
+        void InitInstance(vkb::Instance& vkb_inst);
+        void InitSurface();
+        void InitDevice(const vkb::Instance& vkb_inst);
         void CreateSwapchain(uint32_t width, uint32_t height);
         void InitSwapchain();
         void InitCommands();
         void InitSyncStructs();
         void InitDescriptors();
+        void InitFrameAllocators();
+        void InitGpuTimer();
+        void InitParticles();
+        void InitShadowMap();
+        void InitPipelines();
+        // Device defaults, overridden by whatever the tuning file has for this device
+        void InitKernelShapes();
+        void InitPresentPipeline();
+        void InitBloomPipelines();
+        bool CreateBloomDownsamplePipeline(VkPipeline* out_pipeline);
+        // Background, bloom upsample and present pipelines for the kernels' current shapes, false when a shader failed to load
+        bool CreateKernelPipelines();
+        // Cached variant of the kernel for its current shape, VK_NULL_HANDLE when the shader failed to load
+        VkPipeline GetComputeVariant(ComputeKernel kernel, VkPipelineLayout layout, uint32_t features);
+        // Times every candidate shape of the kernels in use and saves the fastest ones to the tuning file
+        void AutotuneKernels();
+        uint32_t UsedKernelMask() const;
+        void InitParticlePipelines();
+        bool CreateParticlePipelines(ParticlePipelines& out_pipelines);
+        // Override directory first, then the asset pack, then the SPIR-V embedded at build time
+        bool LoadShader(std::string_view name, VkShaderModule* out_shader_module);
+        // Variant of a shader that accesses the draw image built for m_DrawFormat
+        std::string DrawImageShaderName(std::string_view name) const;
+        void ReloadShaders();
+        void PushPipelines(DestroyerQueue& queue);
+        void PushParticlePipelines(DestroyerQueue& queue);
+        void InitScenePipelines();
+        bool CreateScenePipelines(ScenePipelines& out_pipelines);
+        void PushScenePipelines(DestroyerQueue& queue);
+        void InitAssets();
+        void UploadMeshes();
+        bool SupportsComputePresent();
+
+        // Draw image
+        void CreateDrawImage(VkExtent2D extent);
+        void PushDrawImage(DestroyerQueue& queue);
+        void WriteDrawImgDescriptors();
+        void RecreateDrawImage();
+        void BuildTransientImages();
+
+        // Memory
+        void UpdateMemoryStats();
+
+        // Frame capture
+        // Records the draw image's copy into a free ring slot, the frame is dropped when the worker holds them all
+        void CaptureDrawImage(VkCommandBuffer cmd, uint32_t frame_slot);
+        // Hands the copies covered by the frame slot's fence to the capture worker, call after waiting on it
+        void CollectCaptures(uint32_t frame_slot);
+        // Waits for the frames in flight and the worker, false when a frame differed from its golden image
+        bool FinishCapture();
+        void PushCaptureBuffers(DestroyerQueue& queue);
+
+        // Threads
+        void RenderLoop();
+        void PollInput();
+        void SampleInput();
+
+        // Simulation
+        void UpdateSimulation();
 
         // Rendering
         void DrawBackground(VkCommandBuffer cmd);
+        // Instances and per frame data of the shadow and scene passes, uploaded once per frame
+        void PrepareScene();
+        void DrawShadows(VkCommandBuffer cmd);
+        void DrawScene(VkCommandBuffer cmd);
+        void SimulateParticles(VkCommandBuffer cmd);
+        void DrawParticles(VkCommandBuffer cmd);
+        void DrawBloom(VkCommandBuffer cmd);
+        void DrawToSwapchain(VkCommandBuffer cmd, uint32_t swapchain_img_idx);
+        void DrawPresent(VkCommandBuffer cmd, uint32_t swapchain_img_idx);
+        // Replays the segment's cached recording, or records it right into cmd without the cache
+        // timer_scopes are the GPU timer scopes the recording writes
+        void ExecuteSegment(VkCommandBuffer cmd, uint32_t key, uint64_t timer_scopes, const std::function<void(VkCommandBuffer cmd)>& record);
+        // The frame's passes up to and including the kernel, what the auto tuner times
+        void RecordKernelRun(VkCommandBuffer cmd, ComputeKernel kernel);
+
+        // Performance suite
+        // Average CPU and GPU frame time of the world as it is, nothing is simulated while the suite runs
+        void RunPerfScenario(std::string_view name, PerfResults& results);
+        // Microseconds per call of each engine microbenchmark
+        double TimeDestroyerFlush();
+        double TimeDescriptorAllocation();
+        double TimeCommandRecording();
 
         // Class Members
     public:
         bool m_IsInitialized = false;
         int m_FrameCount = 0;
         bool m_IsIdle = false;
+        // Cleared by the main thread to stop the render thread
+        std::atomic<bool> m_IsRunning = false;
 
     private:
         // Engine Util
+        EngineConfig m_Config;
         DestroyerQueue global_queue;
         VmaAllocator m_VmaAlloc;
+        bool m_HasMemoryBudget = false;
 
         VkConstructors::DescriptorAllocator m_GlobalDescrAllocator;
         VkDescriptorSet m_DrawImgDescriptors;
         VkDescriptorSetLayout m_DrawImgDescriptorLayout;
+        VkPipelineLayout m_BackgroundPipelineLayout;
+        // Owned by m_ComputeVariants, like the present and bloom upsample pipelines
+        VkPipeline m_BackgroundPipeline;
+
+        // Image kernels, specialized on a workgroup shape picked per device and created on first use
+        ComputeDeviceInfo m_ComputeDevice = {};
+        std::array<WorkgroupShape, KERNEL_COUNT> m_KernelShapes = {};
+        // Bit per kernel whose shape came from the tuning file
+        uint32_t m_TunedKernelMask = 0;
+        ComputeVariantCache m_ComputeVariants;
+
+        // Compute present pass, one descriptor set per swapchain image
+        bool m_UseComputePresent = false;
+        bool m_HasStorageWriteWithoutFormat = false;
+        // The draw image's format is only known at runtime, the shaders that access it come in a variant per format
+        VkFormat m_DrawFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        std::string_view m_DrawShaderSuffix;
+        bool m_IsDrawImageHdr = true;
+        VkDescriptorSetLayout m_PresentDescriptorLayout;
+        std::vector<VkDescriptorSet> m_PresentDescriptors;
+        VkPipelineLayout m_PresentPipelineLayout;
+        VkPipeline m_PresentPipeline;
+
+        // Bloom, one dispatch builds the whole mip chain from the draw image, then one upsample per level
+        // folds it back into mip 0 which the present pass adds before tonemapping
+        bool m_HasBloom = false;
+        // Subgroup size the downsample is pinned to, 0 when the device can't pin it
+        uint32_t m_BloomSubgroupSize = 0;
+        TransientImageHandle m_BloomImage = 0;
+        uint32_t m_BloomMipCount = 0;
+        VkDescriptorSetLayout m_BloomDownsampleDescriptorLayout;
+        VkDescriptorSetLayout m_BloomUpsampleDescriptorLayout;
+        VkDescriptorSet m_BloomDownsampleDescriptors;
+        // Set i reads mip i + 1 and writes mip i
+        std::array<VkDescriptorSet, BLOOM_MIP_COUNT - 1> m_BloomUpsampleDescriptors;
+        VkPipelineLayout m_BloomDownsampleLayout;
+        VkPipelineLayout m_BloomUpsampleLayout;
+        VkPipeline m_BloomDownsamplePipeline;
+        VkPipeline m_BloomUpsamplePipeline;
+
+        // GPU particles, two pools ping-ponged every frame: survivors of one are compacted into the other
+        bool m_HasParticles = false;
+        uint32_t m_ParticleCapacity = 0;
+        AllocatedBuffer m_ParticlePools[2];
+        // GpuParticleCounters, also the indirect dispatch and draw arguments
+        AllocatedBuffer m_ParticleCounters;
+        // Pool holding the particles simulated next
+        uint32_t m_ParticleSlot = 0;
+        // Counters are zeroed on the GPU at the start of the next frame
+        bool m_ResetParticles = true;
+        int64_t m_LastParticleTimeNs = 0;
+        bool m_IsParticleBench = false;
+        ParticleEmitterQueue m_ParticleEmitters;
+        VkPipelineLayout m_ParticleComputeLayout;
+        VkPipelineLayout m_ParticleDrawLayout;
+        ParticlePipelines m_ParticlePipelines;
+
+        // Scene, the paddle, balls and bricks as instances of the cube mesh with cascaded shadows
+        // Skipped without an asset pack, the cube mesh comes from it
+        const GpuMesh* m_SceneMesh = nullptr;
+        VkFormat m_DepthFormat = VK_FORMAT_UNDEFINED;
+        TransientImageHandle m_DepthImage = 0;
+        //  One layer per cascade, 1x1 and never drawn into when shadows are off
+        bool m_HasShadows = false;
+        AllocatedImage m_ShadowMap;
+        std::array<VkImageView, SHADOW_CASCADE_COUNT> m_ShadowCascadeViews;
+        VkSampler m_ShadowSampler;
+        VkDescriptorSetLayout m_SceneDescriptorLayout;
+        VkDescriptorSet m_SceneDescriptors;
+        VkPipelineLayout m_ScenePipelineLayout;
+        ScenePipelines m_ScenePipelines = {};
+        //  Filled by PrepareScene, every instance and then each cascade's casters one cascade after the other
+        std::vector<GpuSceneInstance> m_SceneInstances;
+        std::vector<GpuSceneInstance> m_ShadowCasters;
+        std::array<ShadowCascade, SHADOW_CASCADE_COUNT> m_ShadowCascades;
+        std::array<uint32_t, SHADOW_CASCADE_COUNT> m_CascadeCasterCounts = {};
+        SceneCamera m_SceneCamera;
+        VkDeviceAddress m_SceneInstanceAddr = 0;
+        VkDeviceAddress m_ShadowCasterAddr = 0;
+        VkDeviceAddress m_SceneFrameAddr = 0;
+
+        GpuTimer m_GpuTimer;
+
+        // Frame capture, the draw image is copied into a host buffer and read once the frame's fence is
+        // waited on again, FRAME_OVERLAP frames later, so neither the copy nor the write ever stalls a frame
+        FrameCapture m_FrameCapture;
+        std::array<CaptureSlot, CAPTURE_RING_SIZE> m_CaptureSlots = {};
+
+        // Input
+        InputQueue m_InputQueue;
+        InputState m_InputState;
+        // Timestamp of the oldest event drained this frame, 0 when there was none
+        int64_t m_PendingInputNs = 0;
+        FrameStats m_FrameStats;
+
+        // Frame pacing, only the render loop waits on it
+        FramePacer m_FramePacer;
+        // End of the last frame, taken once it was submitted and presented, for pacing and frame times
+        int64_t m_LastPresentNs = 0;
+
+        // Assets
+        AssetPack m_AssetPack;
+        std::vector<GpuMesh> m_Meshes;
+
+        // Simulation
+        World m_World;
+        ReplayRecorder m_Recorder;
+        // Advanced in fixed ticks, the accumulator carries the remainder between frames
+        int64_t m_LastSimTimeNs = 0;
+        int64_t m_SimAccumulatorNs = 0;
+        // Replays drive the simulation themselves
+        bool m_IsReplaying = false;
+
+        // Audio, the simulation feeds it collision sounds
+        AudioSystem m_Audio;
 
         // GLFW
-        struct GLFWwindow *m_Window;
+        struct GLFWwindow *m_Window = nullptr;
         uint32_t m_Width;
         uint32_t m_Height;
 
@@ -79,6 +428,7 @@ namespace OB3D
             VkPhysicalDevice physical;
             VkDevice logical;
         } m_Device;
+        VkPhysicalDeviceSubgroupProperties m_SubgroupProps = {};
         VkDebugUtilsMessengerEXT m_DbgMessenger;
         VkSurfaceKHR m_Surface;
         
@@ -92,8 +442,20 @@ namespace OB3D
         // Offline rendering image
         AllocatedImage m_DrawImg;
         VkExtent2D m_DrawExt;
+        // Draw image size relative to the window, lowered when memory runs low
+        float m_RenderScale = 1.0f;
+        // Intermediate targets sized after the draw image
+        TransientImagePool m_TransientImages;
 
         FrameData m_Frames[FRAME_OVERLAP];
+        // One off uploads outside of the frame loop
+        VkCommandPool m_ImmCommandPool;
+        VkCommandBuffer m_ImmCommandBuffer;
+        // Invalidated when the draw image targets or the pipelines change
+        CommandBufferCache m_CommandCache;
+        VkFence m_ImmFence;
+        // Backs every frame's GpuLinearAllocator, one FRAME_GPU_RING_SIZE slice per frame
+        AllocatedBuffer m_FrameRingBuffer;
         VkQueue m_GraphicsQueue;
         uint32_t m_GraphicsQueueFamilyIdx;
     };
@@ -0,0 +1,51 @@
+#pragma once
+#include "util.h"
+
+namespace OB3D
+{
+	struct AllocatedImage
+	{
+		VkImage img;
+		VkImageView img_view;
+		VmaAllocation alloc;
+		VkExtent3D img_ext;
+		VkFormat img_format;
+	};
+
+	// Where the memory behind an AllocatedBuffer lives
+	enum class BufferMemoryType : uint8_t
+	{
+		// GPU only memory, filled with transfer commands from a staging buffer
+		BUFFER_DEVICE_LOCAL,
+		// System memory that stays mapped for the lifetime of the buffer (staging, per frame data)
+		BUFFER_HOST_MAPPED,
+		// Device local memory the CPU can write directly (ReBAR / SAM)
+		// Falls back to mapped system memory when the device has no such heap
+		BUFFER_DEVICE_MAPPED,
+		// Mapped system memory the GPU writes and the CPU reads back, cached where the device has such a type
+		BUFFER_HOST_READBACK
+	};
+
+	struct AllocatedBuffer
+	{
+		VkBuffer buffer;
+		VmaAllocation alloc;
+		VkDeviceSize size;
+		// Passed to shaders through push constants
+		VkDeviceAddress device_addr;
+		// nullptr for BUFFER_DEVICE_LOCAL buffers
+		void* mapped;
+		BufferMemoryType memory_type;
+		bool is_device_local;
+	};
+
+	// Mesh uploaded to device local memory, vertices are PackVertex
+	struct GpuMesh
+	{
+		std::string name;
+		AllocatedBuffer vertex_buffer;
+		AllocatedBuffer index_buffer;
+		uint32_t vertex_count;
+		uint32_t index_count;
+	};
+}
@@ -0,0 +1,37 @@
+# Turns compiled SPIR-V into a header of constexpr word arrays plus a registry keyed by shader name
+# Run in script mode: cmake -DSPIRV_FILES=<a.spv|b.spv> -DOUTPUT=<header> -P EmbedSpirv.cmake
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+
+set(ARRAYS "")
+set(REGISTRY "")
+list(LENGTH SPIRV_FILES SHADER_COUNT)
+
+foreach(SPIRV_FILE ${SPIRV_FILES})
+	get_filename_component(SHADER_NAME ${SPIRV_FILE} NAME_WE)
+
+	file(READ ${SPIRV_FILE} SPIRV_HEX HEX)
+	string(LENGTH "${SPIRV_HEX}" HEX_LENGTH)
+	math(EXPR WORD_COUNT "${HEX_LENGTH} / 8")
+
+	# SPIR-V is little endian, reorder every 4 bytes into one word
+	string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1," SPIRV_WORDS "${SPIRV_HEX}")
+	# Break the line every 8 words, CMake regexes have no repetition counts
+	string(REPEAT "0x[0-9a-f]+," 8 EIGHT_WORDS)
+	string(REGEX REPLACE "(${EIGHT_WORDS})" "\\1\n\t\t" SPIRV_WORDS "${SPIRV_WORDS}")
+
+	string(APPEND ARRAYS "\tinline constexpr std::array<uint32_t, ${WORD_COUNT}> SPIRV_${SHADER_NAME} =\n\t{\n\t\t${SPIRV_WORDS}\n\t};\n\n")
+	string(APPEND REGISTRY "\t\tEmbeddedShader{ \"${SHADER_NAME}\", SPIRV_${SHADER_NAME} },\n")
+endforeach()
+
+set(HEADER "// Generated by Shaders/EmbedSpirv.cmake, do not edit\n")
+string(APPEND HEADER "#pragma once\n#include <array>\n#include <cstdint>\n#include <span>\n#include <string_view>\n\n")
+string(APPEND HEADER "namespace OB3D::EmbeddedShaders\n{\n")
+string(APPEND HEADER "\tstruct EmbeddedShader\n\t{\n\t\tstd::string_view name;\n\t\tstd::span<const uint32_t> code;\n\t};\n\n")
+string(APPEND HEADER "${ARRAYS}")
+string(APPEND HEADER "\tinline constexpr std::array<EmbeddedShader, ${SHADER_COUNT}> REGISTRY =\n\t{\n${REGISTRY}\t};\n}\n")
+
+# Only touch the header when a shader changed so dependents don't rebuild needlessly
+file(WRITE "${OUTPUT}.tmp" "${HEADER}")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
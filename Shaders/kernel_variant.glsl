@@ -0,0 +1,9 @@
+// Specialization constants shared by the per device kernel variants, matches KernelSpecConstant in compute_variants.h
+// The engine picks the workgroup shape and subgroup size per device, from the auto tuner when it has run
+
+layout (local_size_x_id = 0, local_size_y_id = 1) in;
+
+// Subgroup size the pipeline was created with, 0 when the driver chose it
+layout (constant_id = 2) const uint PINNED_SUBGROUP_SIZE = 0;
+// Kernel specific feature bits, branches on them fold away when the pipeline is compiled
+layout (constant_id = 3) const uint KERNEL_FEATURES = 0;
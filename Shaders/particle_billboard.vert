@@ -0,0 +1,42 @@
+//GLSL version to use
+#version 460
+
+// Expands each live particle into a quad, one instance per particle and no vertex buffers
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+#include "particle_common.glsl"
+
+layout(buffer_reference, std430) readonly buffer ParticleBuffer
+{
+	Particle particles[];
+};
+
+layout(push_constant) uniform ParticleDrawConstants
+{
+	mat4 view_proj;
+	ParticleBuffer particles;
+} pc;
+
+layout(location = 0) out vec4 out_color;
+layout(location = 1) out vec2 out_uv;
+
+const vec2 QUAD_CORNERS[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main()
+{
+	Particle particle = pc.particles.particles[gl_InstanceIndex];
+	vec2 corner = QUAD_CORNERS[gl_VertexIndex];
+
+	// Shrink and fade out over the particle's life
+	float life_ratio = clamp(particle.life / particle.max_life, 0.0, 1.0);
+	vec2 world_pos = particle.pos + corner * particle.size * mix(0.4, 1.0, life_ratio);
+
+	gl_Position = pc.view_proj * vec4(world_pos, 0.0, 1.0);
+	out_color = vec4(particle.color.rgb, life_ratio);
+	out_uv = corner;
+}
@@ -0,0 +1,40 @@
+// Shared by the particle shaders, included after #version
+// Layouts match the Gpu* structs in particle_system.h
+
+struct Particle
+{
+	vec2 pos;
+	vec2 vel;
+	vec4 color;
+	float life;
+	float max_life;
+	float size;
+	float pad;
+};
+
+struct ParticleEmitter
+{
+	vec2 pos;
+	float speed;
+	float life;
+	vec4 color;
+	uint first;
+	uint count;
+	uint seed;
+	float size;
+};
+
+// PCG hash, stateless so every thread can derive its randoms from its index
+uint Hash(uint value)
+{
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// Uniform in [0, 1)
+float Random(inout uint seed)
+{
+	seed = Hash(seed);
+	return float(seed >> 8) / 16777216.0;
+}
@@ -0,0 +1,49 @@
+// Buffers and push constants of the particle compute passes, included after #version
+
+#extension GL_EXT_buffer_reference : require
+
+#include "particle_common.glsl"
+
+const uint SIMULATE_WORKGROUP_SIZE = 64;
+
+layout(buffer_reference, std430) buffer ParticleBuffer
+{
+	Particle particles[];
+};
+
+layout(buffer_reference, std430) readonly buffer EmitterBuffer
+{
+	ParticleEmitter emitters[];
+};
+
+// Also the source of the indirect dispatch and draw arguments
+layout(buffer_reference, std430) buffer CounterBuffer
+{
+	uint alive_count[2];
+	uint dropped;
+	uint pad0;
+	uint dispatch_x;
+	uint dispatch_y;
+	uint dispatch_z;
+	uint pad1;
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+
+layout(push_constant) uniform ParticleComputeConstants
+{
+	ParticleBuffer src_particles;
+	ParticleBuffer dst_particles;
+	CounterBuffer counters;
+	EmitterBuffer emitters;
+	uint capacity;
+	uint emitter_count;
+	uint emit_total;
+	uint src_slot;
+	uint dst_slot;
+	float dt;
+	float gravity;
+	float drag;
+} pc;
@@ -0,0 +1,15 @@
+//GLSL version to use
+#version 460
+
+// Soft round sprite, blended additively into the HDR draw image
+
+layout(location = 0) in vec4 in_color;
+layout(location = 1) in vec2 in_uv;
+
+layout(location = 0) out vec4 out_color;
+
+void main()
+{
+	float falloff = 1.0 - clamp(dot(in_uv, in_uv), 0.0, 1.0);
+	out_color = vec4(in_color.rgb, in_color.a * falloff * falloff);
+}
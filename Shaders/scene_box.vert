@@ -0,0 +1,32 @@
+//GLSL version to use
+#version 460
+
+// Stretches the unit cube over each instance's box, used by the shadow, depth prepass and opaque pipelines
+
+#extension GL_GOOGLE_include_directive : require
+
+#include "scene_common.glsl"
+
+// The prepass and the opaque pass must land on exactly the same depth for the EQUAL test
+invariant gl_Position;
+
+layout(location = 0) out vec3 out_world_pos;
+layout(location = 1) out vec3 out_normal;
+layout(location = 2) out vec4 out_color;
+
+void main()
+{
+	SceneInstance instance = pc.instances.instances[gl_InstanceIndex];
+
+	uint base = uint(gl_VertexIndex) * 6;
+	vec3 position = vec3(pc.vertices.values[base], pc.vertices.values[base + 1], pc.vertices.values[base + 2]);
+	vec3 normal = vec3(pc.vertices.values[base + 3], pc.vertices.values[base + 4], pc.vertices.values[base + 5]);
+
+	// The unit cube spans -0.5 to 0.5, boxes are axis aligned so the normals don't change
+	vec3 world_pos = instance.center.xyz + position * 2.0 * instance.half_extent.xyz;
+
+	gl_Position = pc.view_proj * vec4(world_pos, 1.0);
+	out_world_pos = world_pos;
+	out_normal = normal;
+	out_color = instance.color;
+}
@@ -0,0 +1,49 @@
+// Shared by the scene shaders, included after #version
+// Layouts match GpuSceneInstance, GpuSceneFrame and ScenePushConstants in scene_renderer.h
+
+#extension GL_EXT_buffer_reference : require
+
+const uint SHADOW_CASCADE_COUNT = 4;
+
+struct SceneInstance
+{
+	vec4 center;
+	vec4 half_extent;
+	// HDR albedo, a is the share of it that is emitted instead of lit
+	vec4 color;
+};
+
+// Position and normal, 6 floats per vertex
+layout(buffer_reference, std430) readonly buffer VertexBuffer
+{
+	float values[];
+};
+
+layout(buffer_reference, std430) readonly buffer InstanceBuffer
+{
+	SceneInstance instances[];
+};
+
+layout(buffer_reference, std430) readonly buffer SceneFrameBuffer
+{
+	mat4 cascade_view_proj[SHADOW_CASCADE_COUNT];
+	vec4 cascade_splits;
+	vec4 cascade_texel_sizes;
+	// xyz points towards the light
+	vec4 light_dir;
+	// rgb light color, a ambient share
+	vec4 light_color;
+	vec4 camera_pos;
+	vec4 camera_forward;
+	// x is one shadow map texel in uv
+	vec4 shadow_params;
+};
+
+layout(push_constant) uniform ScenePushConstants
+{
+	// The cascade's projection in the shadow pass, the camera's otherwise
+	mat4 view_proj;
+	VertexBuffer vertices;
+	InstanceBuffer instances;
+	SceneFrameBuffer frame;
+} pc;
@@ -0,0 +1,70 @@
+//GLSL version to use
+#version 460
+
+// Lambert lighting with cascaded shadows, emissive objects skip the light
+
+#extension GL_GOOGLE_include_directive : require
+
+#include "scene_common.glsl"
+
+layout(set = 0, binding = 0) uniform sampler2DArrayShadow shadow_map;
+
+layout(location = 0) in vec3 in_world_pos;
+layout(location = 1) in vec3 in_normal;
+layout(location = 2) in vec4 in_color;
+
+layout(location = 0) out vec4 out_color;
+
+uint SelectCascade(float view_depth)
+{
+	for(uint i = 0; i < SHADOW_CASCADE_COUNT - 1; i++)
+	{
+		if(view_depth < pc.frame.cascade_splits[i])
+		{
+			return i;
+		}
+	}
+	return SHADOW_CASCADE_COUNT - 1;
+}
+
+float SampleShadow(vec3 world_pos, vec3 normal, float n_dot_l)
+{
+	float view_depth = dot(world_pos - pc.frame.camera_pos.xyz, pc.frame.camera_forward.xyz);
+	uint cascade = SelectCascade(view_depth);
+
+	// Pushing the lookup out along the normal by about a texel hides acne on surfaces facing away from the light
+	float texel_size = pc.frame.cascade_texel_sizes[cascade];
+	vec3 offset_pos = world_pos + normal * texel_size * (1.5 - n_dot_l);
+
+	vec4 light_pos = pc.frame.cascade_view_proj[cascade] * vec4(offset_pos, 1.0);
+	vec2 uv = light_pos.xy * 0.5 + 0.5;
+	if(any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0))) || light_pos.z > 1.0)
+	{
+		return 1.0;
+	}
+
+	// 3x3 PCF on top of the hardware's 2x2 compare filter
+	float texel = pc.frame.shadow_params.x;
+	float lit = 0.0;
+	for(int y = -1; y <= 1; y++)
+	{
+		for(int x = -1; x <= 1; x++)
+		{
+			lit += texture(shadow_map, vec4(uv + vec2(x, y) * texel, float(cascade), light_pos.z));
+		}
+	}
+	return lit / 9.0;
+}
+
+void main()
+{
+	vec3 normal = normalize(in_normal);
+	vec3 light_dir = pc.frame.light_dir.xyz;
+	float n_dot_l = max(dot(normal, light_dir), 0.0);
+
+	float shadow = n_dot_l > 0.0 ? SampleShadow(in_world_pos, normal, n_dot_l) : 0.0;
+	float ambient = pc.frame.light_color.a;
+	vec3 lit = in_color.rgb * (pc.frame.light_color.rgb * n_dot_l * shadow + ambient);
+
+	out_color = vec4(mix(lit, in_color.rgb, in_color.a), 1.0);
+}
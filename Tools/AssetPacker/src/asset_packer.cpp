@@ -0,0 +1,346 @@
+// Offline tool that bundles levels, meshes and compiled shaders into one asset pack
+// Usage: AssetPacker <output> level:<name>=<file.txt> mesh:<name>=<file.obj> shader:<name>=<file.spv> ...
+#include "asset_pack_format.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <fmt/core.h>
+
+using namespace OB3D;
+
+struct PackInput
+{
+	std::string name;
+	PackEntryType type;
+	std::vector<uint8_t> blob;
+};
+
+static bool ReadFile(const std::string& path, std::string& out_contents)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	out_contents = contents.str();
+	return true;
+}
+
+template<typename T>
+static void AppendBytes(std::vector<uint8_t>& blob, const T* data, size_t count)
+{
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	blob.insert(blob.end(), bytes, bytes + count * sizeof(T));
+}
+
+// One row of bricks per line, a digit is the brick's hit points and '.' an empty cell
+// Lines starting with '#' are comments
+static bool PackLevel(const std::string& source, std::vector<uint8_t>& out_blob)
+{
+	std::vector<std::string> rows;
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		if (!rows.empty() && line.size() != rows[0].size())
+		{
+			fmt::println("Level rows must all have the same width");
+			return false;
+		}
+		rows.push_back(line);
+	}
+
+	if (rows.empty())
+	{
+		fmt::println("Level has no rows");
+		return false;
+	}
+
+	PackLevelHeader header = {};
+	header.columns = uint32_t(rows[0].size());
+	header.rows = uint32_t(rows.size());
+	AppendBytes(out_blob, &header, 1);
+
+	for (const std::string& row : rows)
+	{
+		for (char cell : row)
+		{
+			if (cell == '.')
+			{
+				out_blob.push_back(0);
+			}
+			else if (cell >= '0' && cell <= '9')
+			{
+				out_blob.push_back(uint8_t(cell - '0'));
+			}
+			else
+			{
+				fmt::println("Unexpected level character '{}'", cell);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Wavefront OBJ subset: v, vn and polygonal f, faces are triangulated as fans
+static bool PackMesh(const std::string& source, std::vector<uint8_t>& out_blob)
+{
+	std::vector<std::array<float, 3>> positions;
+	std::vector<std::array<float, 3>> normals;
+	std::vector<PackVertex> vertices;
+	std::vector<uint32_t> indices;
+	// Corners sharing position and normal become one vertex
+	std::map<std::tuple<int, int>, uint32_t> vertex_lookup;
+
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		std::istringstream tokens(line);
+		std::string keyword;
+		tokens >> keyword;
+
+		if (keyword == "v")
+		{
+			std::array<float, 3> position = {};
+			tokens >> position[0] >> position[1] >> position[2];
+			positions.push_back(position);
+		}
+		else if (keyword == "vn")
+		{
+			std::array<float, 3> normal = {};
+			tokens >> normal[0] >> normal[1] >> normal[2];
+			normals.push_back(normal);
+		}
+		else if (keyword == "f")
+		{
+			std::vector<uint32_t> face;
+			std::string corner;
+			while (tokens >> corner)
+			{
+				// v, v/vt, v//vn or v/vt/vn, 1 based
+				int position_idx = std::atoi(corner.c_str()) - 1;
+				size_t last_slash = corner.rfind('/');
+				int normal_idx = (last_slash != std::string::npos && std::count(corner.begin(), corner.end(), '/') == 2)
+								 ? std::atoi(corner.c_str() + last_slash + 1) - 1
+								 : -1;
+
+				if (position_idx < 0 || position_idx >= int(positions.size()) || normal_idx >= int(normals.size()))
+				{
+					fmt::println("Face references a missing vertex: {:s}", corner);
+					return false;
+				}
+
+				auto [it, is_new] = vertex_lookup.try_emplace({ position_idx, normal_idx }, uint32_t(vertices.size()));
+				if (is_new)
+				{
+					PackVertex vertex = {};
+					std::copy_n(positions[position_idx].begin(), 3, vertex.position);
+					if (normal_idx >= 0)
+					{
+						std::copy_n(normals[normal_idx].begin(), 3, vertex.normal);
+					}
+					vertices.push_back(vertex);
+				}
+				face.push_back(it->second);
+			}
+
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				indices.push_back(face[0]);
+				indices.push_back(face[i - 1]);
+				indices.push_back(face[i]);
+			}
+		}
+	}
+
+	PackMeshHeader header = {};
+	header.vertex_count = uint32_t(vertices.size());
+	header.index_count = uint32_t(indices.size());
+	header.vertex_stride = sizeof(PackVertex);
+	header.index_offset = uint32_t(sizeof(PackMeshHeader) + vertices.size() * sizeof(PackVertex));
+
+	AppendBytes(out_blob, &header, 1);
+	AppendBytes(out_blob, vertices.data(), vertices.size());
+	AppendBytes(out_blob, indices.data(), indices.size());
+	return true;
+}
+
+static bool PackShader(const std::string& source, std::vector<uint8_t>& out_blob)
+{
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+	uint32_t magic = 0;
+	if (source.size() < sizeof(magic) || source.size() % sizeof(uint32_t) != 0)
+	{
+		fmt::println("Shader is not SPIR-V");
+		return false;
+	}
+
+	memcpy(&magic, source.data(), sizeof(magic));
+	if (magic != SPIRV_MAGIC)
+	{
+		fmt::println("Shader is not SPIR-V");
+		return false;
+	}
+
+	out_blob.assign(source.begin(), source.end());
+	return true;
+}
+
+static bool ParseInput(std::string_view arg, PackInput& out_input, std::string& out_path)
+{
+	size_t colon = arg.find(':');
+	size_t equals = arg.find('=');
+	if (colon == std::string_view::npos || equals == std::string_view::npos || equals < colon)
+	{
+		return false;
+	}
+
+	std::string_view type = arg.substr(0, colon);
+	out_input.name = arg.substr(colon + 1, equals - colon - 1);
+	out_path = arg.substr(equals + 1);
+
+	if (out_input.name.empty() || out_input.name.size() >= PACK_NAME_SIZE)
+	{
+		return false;
+	}
+
+	if (type == "level")
+	{
+		out_input.type = PackEntryType::PACK_LEVEL;
+	}
+	else if (type == "mesh")
+	{
+		out_input.type = PackEntryType::PACK_MESH;
+	}
+	else if (type == "shader")
+	{
+		out_input.type = PackEntryType::PACK_SHADER;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fmt::println("Usage: {:s} <output> level:<name>=<file.txt> mesh:<name>=<file.obj> shader:<name>=<file.spv> ...", argv[0]);
+		return 1;
+	}
+
+	std::vector<PackInput> inputs;
+	for (int i = 2; i < argc; i++)
+	{
+		PackInput input = {};
+		std::string path;
+		if (!ParseInput(argv[i], input, path))
+		{
+			fmt::println("Invalid input {:s}, expected <type>:<name>=<path> with a name under {} characters", argv[i], PACK_NAME_SIZE);
+			return 1;
+		}
+
+		std::string source;
+		if (!ReadFile(path, source))
+		{
+			fmt::println("Failed to read {:s}", path);
+			return 1;
+		}
+
+		bool is_packed = false;
+		switch (input.type)
+		{
+			case PackEntryType::PACK_LEVEL: is_packed = PackLevel(source, input.blob); break;
+			case PackEntryType::PACK_MESH: is_packed = PackMesh(source, input.blob); break;
+			case PackEntryType::PACK_SHADER: is_packed = PackShader(source, input.blob); break;
+		}
+
+		if (!is_packed)
+		{
+			fmt::println("Failed to pack {:s}", path);
+			return 1;
+		}
+
+		inputs.push_back(std::move(input));
+	}
+
+	// The engine binary searches the table of contents by name
+	std::sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b)
+		{
+			return std::tie(a.name, a.type) < std::tie(b.name, b.type);
+		});
+
+	for (size_t i = 1; i < inputs.size(); i++)
+	{
+		if (inputs[i].name == inputs[i - 1].name && inputs[i].type == inputs[i - 1].type)
+		{
+			fmt::println("Duplicate entry {:s}", inputs[i].name);
+			return 1;
+		}
+	}
+
+	PackHeader header = {};
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entry_count = uint32_t(inputs.size());
+	header.toc_offset = sizeof(PackHeader);
+
+	std::vector<PackEntry> entries(inputs.size());
+	uint64_t offset = PackAlignUp(header.toc_offset + entries.size() * sizeof(PackEntry), PACK_BLOB_ALIGNMENT);
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		PackEntry& entry = entries[i];
+		memcpy(entry.name, inputs[i].name.data(), inputs[i].name.size());
+		entry.type = inputs[i].type;
+		entry.checksum = PackChecksum(inputs[i].blob.data(), inputs[i].blob.size());
+		entry.offset = offset;
+		entry.size = inputs[i].blob.size();
+		offset = PackAlignUp(offset + entry.size, PACK_BLOB_ALIGNMENT);
+	}
+
+	header.file_size = offset;
+	header.toc_checksum = PackChecksum(reinterpret_cast<const uint8_t*>(entries.data()), entries.size() * sizeof(PackEntry));
+
+	std::vector<uint8_t> pack(size_t(header.file_size), 0);
+	memcpy(pack.data(), &header, sizeof(header));
+	memcpy(pack.data() + header.toc_offset, entries.data(), entries.size() * sizeof(PackEntry));
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		memcpy(pack.data() + entries[i].offset, inputs[i].blob.data(), inputs[i].blob.size());
+	}
+
+	std::ofstream output(argv[1], std::ios::binary | std::ios::trunc);
+	if (!output.write(reinterpret_cast<const char*>(pack.data()), std::streamsize(pack.size())))
+	{
+		fmt::println("Failed to write {:s}", argv[1]);
+		return 1;
+	}
+
+	fmt::println("Packed {} entries into {:s}, {} bytes", inputs.size(), argv[1], pack.size());
+	return 0;
+}